@@ -0,0 +1,160 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// alloc.cc: memory resource selection and allocation accounting
+// hooks
+// -----------------------------------
+
+#include <new>
+#include "alloc.h"
+
+namespace sigen
+{
+   namespace alloc_priv {
+      std::atomic<AllocObserver*> observer(nullptr);
+
+      // per-thread resource set by MemoryScope
+      thread_local std::pmr::memory_resource* resource = nullptr;
+
+      // saved ahead of objects allocated by allocateObject()
+      struct ObjHeader {
+         std::pmr::memory_resource* resource;
+         std::size_t bytes;
+      };
+      const std::size_t OBJ_HEADER_LEN =
+         ((sizeof(ObjHeader) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t)) *
+         alignof(std::max_align_t);
+   }
+
+   using namespace alloc_priv;
+
+   void setAllocObserver(AllocObserver* o)
+   {
+      observer.store(o);
+   }
+
+   AllocObserver* getAllocObserver()
+   {
+      return observer.load();
+   }
+
+   //
+   // memory resource selection
+   //
+   std::pmr::memory_resource* getMemoryResource()
+   {
+      return (resource ? resource : std::pmr::new_delete_resource());
+   }
+
+   MemoryScope::MemoryScope(std::pmr::memory_resource* r) :
+      prev(alloc_priv::resource)
+   {
+      alloc_priv::resource = r;
+   }
+
+   MemoryScope::~MemoryScope()
+   {
+      alloc_priv::resource = prev;
+   }
+
+
+   //
+   // allocation routines
+   //
+   void* allocate(AllocKind kind, std::size_t bytes, std::pmr::memory_resource* r)
+   {
+      void* p = r->allocate(bytes);
+
+      AllocObserver* o = observer.load(std::memory_order_relaxed);
+      if (o)
+         o->allocated(kind, bytes);
+      return p;
+   }
+
+   void deallocate(AllocKind kind, void* p, std::size_t bytes, std::pmr::memory_resource* r)
+   {
+      if (!p)
+         return;
+
+      AllocObserver* o = observer.load(std::memory_order_relaxed);
+      if (o)
+         o->released(kind, bytes);
+      r->deallocate(p, bytes);
+   }
+
+   void* allocateObject(AllocKind kind, std::size_t bytes, std::pmr::memory_resource* r)
+   {
+      ui8* p = static_cast<ui8*>(allocate(kind, bytes + OBJ_HEADER_LEN, r));
+
+      new (p) ObjHeader{ r, bytes + OBJ_HEADER_LEN };
+      return p + OBJ_HEADER_LEN;
+   }
+
+   void deallocateObject(AllocKind kind, void* p)
+   {
+      if (!p)
+         return;
+
+      ui8* base = static_cast<ui8*>(p) - OBJ_HEADER_LEN;
+      const ObjHeader* h = reinterpret_cast<const ObjHeader*>(base);
+      deallocate(kind, base, h->bytes, h->resource);
+   }
+
+
+   // --------------------------------
+   // allocation counter
+   //
+   void AllocCounter::allocated(AllocKind kind, std::size_t bytes)
+   {
+      Count& c = counts[idx(kind)];
+      c.allocs.fetch_add(1, std::memory_order_relaxed);
+      c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+   }
+
+   void AllocCounter::released(AllocKind kind, std::size_t)
+   {
+      counts[idx(kind)].frees.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   void AllocCounter::reset()
+   {
+      for (Count& c : counts) {
+         c.allocs = 0;
+         c.frees = 0;
+         c.bytes = 0;
+      }
+   }
+
+   ui32 AllocCounter::allocations() const
+   {
+      ui32 n = 0;
+      for (const Count& c : counts)
+         n += c.allocs;
+      return n;
+   }
+
+   std::size_t AllocCounter::bytes() const
+   {
+      std::size_t n = 0;
+      for (const Count& c : counts)
+         n += c.bytes;
+      return n;
+   }
+
+} // namespace sigen
@@ -0,0 +1,234 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// alloc.h: memory resource selection and allocation accounting
+// hooks used by the sections, tables and descriptors
+// -----------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <vector>
+#include <memory_resource>
+#include "types.h"
+
+namespace sigen {
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \enum AllocKind
+    *
+    * \brief Identifies what an allocation made by the library is for.
+    */
+   enum class AllocKind {
+      SECTION,                 //!< Section objects and TStream list nodes.
+      SECTION_DATA,            //!< Section data buffers.
+      TABLE_ITEM,              //!< Table loop entries (services, events, etc.) and their list nodes.
+      DESCRIPTOR,              //!< Descriptor objects.
+      DESC_NODE,               //!< List nodes holding a table's descriptors.
+      DESC_LOOP,               //!< Loop entries inside descriptors (text, time offsets, etc.).
+      NUM_KINDS
+   };
+
+   /*!
+    * \brief Interface for receiving notification of every allocation
+    * and release made by the library.
+    *
+    * Install one with setAllocObserver(). Calls are made from the
+    * allocating thread so implementations must be thread-safe if
+    * tables are built concurrently.
+    */
+   class AllocObserver
+   {
+   public:
+      virtual ~AllocObserver() {}
+
+      virtual void allocated(AllocKind kind, std::size_t bytes) = 0;
+      virtual void released(AllocKind kind, std::size_t bytes) = 0;
+   };
+
+   /*!
+    * \brief Installs the allocation observer. Pass `nullptr` to remove it.
+    * \param observer Observer to notify. Not owned by the library.
+    */
+   void setAllocObserver(AllocObserver* observer);
+   //! \brief Returns the installed observer or `nullptr`.
+   AllocObserver* getAllocObserver();
+
+   /*!
+    * \brief Observer that counts allocations by kind. Useful for
+    * checking allocation budgets in tests.
+    */
+   class AllocCounter : public AllocObserver
+   {
+   public:
+      AllocCounter() { reset(); }
+
+      virtual void allocated(AllocKind kind, std::size_t bytes);
+      virtual void released(AllocKind kind, std::size_t bytes);
+
+      //! \brief Clears all counters.
+      void reset();
+
+      //! \brief Number of allocations made of the given kind.
+      ui32 allocations(AllocKind kind) const { return counts[idx(kind)].allocs; }
+      //! \brief Number of releases made of the given kind.
+      ui32 releases(AllocKind kind) const { return counts[idx(kind)].frees; }
+      //! \brief Total bytes allocated of the given kind.
+      std::size_t bytes(AllocKind kind) const { return counts[idx(kind)].bytes; }
+      //! \brief Number of allocations of all kinds.
+      ui32 allocations() const;
+      //! \brief Total bytes allocated of all kinds.
+      std::size_t bytes() const;
+
+   private:
+      struct Count {
+         std::atomic<ui32> allocs;
+         std::atomic<ui32> frees;
+         std::atomic<std::size_t> bytes;
+      } counts[static_cast<int>(AllocKind::NUM_KINDS)];
+
+      static int idx(AllocKind k) { return static_cast<int>(k); }
+   };
+
+   /*!
+    * \brief Returns the memory resource tables, descriptors and
+    * streams created by the calling thread allocate from.
+    *
+    * Defaults to std::pmr::new_delete_resource(). Use MemoryScope to
+    * change it.
+    */
+   std::pmr::memory_resource* getMemoryResource();
+
+   /*!
+    * \brief Sets the calling thread's memory resource for the
+    * lifetime of the object.
+    *
+    * Tables, descriptors and streams constructed while the scope is
+    * active allocate all their storage (loop entries, descriptor
+    * nodes, sections) from the given resource, even after the scope
+    * ends. This allows building a complete SI cycle in a
+    * std::pmr::monotonic_buffer_resource and releasing it in one
+    * operation, or giving each builder thread its own pool:
+    *
+    * \code
+    *    std::pmr::monotonic_buffer_resource arena;
+    *    {
+    *       MemoryScope scope(&arena);
+    *       SDTActual sdt(0x20, 0x30, 0x01);
+    *       ...
+    *       TStream t;
+    *       sdt.buildSections(t);
+    *    } // tables & streams destroyed before the arena
+    *    arena.release();
+    * \endcode
+    *
+    * \attention All objects allocated from the resource must be
+    * destroyed before the resource is.
+    */
+   class MemoryScope
+   {
+   public:
+      //! \brief Constructor.
+      //! \param resource Resource to allocate from. Not owned.
+      explicit MemoryScope(std::pmr::memory_resource* resource);
+      ~MemoryScope();
+
+      MemoryScope(const MemoryScope&) = delete;
+      MemoryScope& operator=(const MemoryScope&) = delete;
+
+   private:
+      std::pmr::memory_resource* prev;
+   };
+
+   //! @}
+
+   // allocation routines used internally - these notify the
+   // observer, if one is installed
+   void* allocate(AllocKind kind, std::size_t bytes,
+                  std::pmr::memory_resource* r = getMemoryResource());
+   void deallocate(AllocKind kind, void* p, std::size_t bytes,
+                   std::pmr::memory_resource* r);
+
+   // for objects allocated with operator new. The resource and size
+   // are saved ahead of the object so delete can return it to the
+   // right place
+   void* allocateObject(AllocKind kind, std::size_t bytes,
+                        std::pmr::memory_resource* r = getMemoryResource());
+   void deallocateObject(AllocKind kind, void* p);
+
+   //
+   // standard allocator for the containers used by the library.
+   // Captures the current thread's memory resource when default
+   // constructed
+   //
+   template <class T, AllocKind K>
+   struct TrackedAllocator
+   {
+      typedef T value_type;
+
+      template <class U>
+      struct rebind { typedef TrackedAllocator<U, K> other; };
+
+      TrackedAllocator() : resource(getMemoryResource()) { }
+      TrackedAllocator(std::pmr::memory_resource* r) : resource(r) { }
+      template <class U>
+      TrackedAllocator(const TrackedAllocator<U, K>& a) : resource(a.resource) { }
+
+      T* allocate(std::size_t n) {
+         return static_cast<T*>(sigen::allocate(K, n * sizeof(T), resource));
+      }
+      void deallocate(T* p, std::size_t n) {
+         sigen::deallocate(K, p, n * sizeof(T), resource);
+      }
+
+      template <class U>
+      bool operator==(const TrackedAllocator<U, K>& a) const {
+         return resource == a.resource || resource->is_equal(*a.resource);
+      }
+      template <class U>
+      bool operator!=(const TrackedAllocator<U, K>& a) const { return !(*this == a); }
+
+      std::pmr::memory_resource* resource;
+   };
+
+   template <class T, AllocKind K>
+   using TrackedList = std::list<T, TrackedAllocator<T, K> >;
+
+   template <class T, AllocKind K>
+   using TrackedVector = std::vector<T, TrackedAllocator<T, K> >;
+
+} // sigen namespace
+
+// class-specific operator new / delete for the library's
+// heap-allocated object types
+#define SIGEN_TRACKED_NEW(kind)                                         \
+   static void* operator new(std::size_t sz) { return sigen::allocateObject(kind, sz); } \
+   static void* operator new(std::size_t sz, std::pmr::memory_resource* r) { \
+      return sigen::allocateObject(kind, sz, r);                        \
+   }                                                                    \
+   static void operator delete(void* p) { sigen::deallocateObject(kind, p); } \
+   static void operator delete(void* p, std::pmr::memory_resource*) {  \
+      sigen::deallocateObject(kind, p);                                 \
+   }
@@ -0,0 +1,638 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// async_writer.cc: asynchronous output to a file descriptor, with
+// io_uring or a writer thread
+// -----------------------------------
+
+#include "config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#include "async_writer.h"
+
+namespace sigen
+{
+   //
+   // interface to the mechanism doing the writes
+   //
+   class AsyncBackend
+   {
+   public:
+      enum : ui64 { CUR_POS = ~0ULL }; // write at the current position
+
+      struct Request {
+         ui16 buf;
+         const ui8 *data;
+         ui32 len;
+         ui64 offset;
+      };
+
+      struct Completion {
+         ui16 buf;
+         int res; // bytes written or -errno
+      };
+
+      virtual ~AsyncBackend() {}
+
+      // starts the writes. If linked, each only starts once the
+      // previous completed. Returns how many were started, the first
+      // ones; fewer than n on failure, with errno set
+      virtual ui16 submit(const Request *r, ui16 n, bool linked) = 0;
+      // collects up to max completions, waiting for one if asked to
+      virtual ui16 reap(Completion *c, ui16 max, bool wait) = 0;
+   };
+
+
+   namespace async_priv {
+
+      const ui32 POOL_ALIGN = 4096;
+
+      //
+      // writes a whole request with blocking calls
+      //
+      static int writeAll(int fd, const AsyncBackend::Request &r)
+      {
+         ui32 done = 0;
+         while (done < r.len) {
+            ssize_t w = (r.offset == AsyncBackend::CUR_POS) ?
+               ::write(fd, r.data + done, r.len - done) :
+               ::pwrite(fd, r.data + done, r.len - done, r.offset + done);
+            if (w < 0) {
+               if (errno == EINTR)
+                  continue;
+               return -errno;
+            }
+            if (w == 0)
+               return -EIO;
+            done += w;
+         }
+         return done;
+      }
+
+      //
+      // a thread that writes the requests in the order submitted
+      //
+      class ThreadBackend : public AsyncBackend
+      {
+      public:
+         ThreadBackend(int fd) : fd(fd), stop(false), worker(&ThreadBackend::run, this) {}
+
+         ~ThreadBackend() {
+            {
+               std::lock_guard<std::mutex> l(lock);
+               stop = true;
+            }
+            work.notify_one();
+            worker.join();
+         }
+
+         virtual ui16 submit(const Request *r, ui16 n, bool) {
+            {
+               std::lock_guard<std::mutex> l(lock);
+               requests.insert(requests.end(), r, r + n);
+            }
+            work.notify_one();
+            return n;
+         }
+
+         virtual ui16 reap(Completion *c, ui16 max, bool wait) {
+            std::unique_lock<std::mutex> l(lock);
+            if (wait)
+               done.wait(l, [this] { return !completions.empty(); });
+
+            ui16 n = std::min<std::size_t>(max, completions.size());
+            std::copy_n(completions.begin(), n, c);
+            completions.erase(completions.begin(), completions.begin() + n);
+            return n;
+         }
+
+      private:
+         void run() {
+            std::unique_lock<std::mutex> l(lock);
+            for (;;) {
+               work.wait(l, [this] { return stop || !requests.empty(); });
+               if (requests.empty())
+                  return;
+
+               Request r = requests.front();
+               requests.pop_front();
+
+               l.unlock();
+               int res = writeAll(fd, r);
+               l.lock();
+
+               completions.push_back({ r.buf, res });
+               done.notify_one();
+            }
+         }
+
+         int fd;
+         bool stop;
+         std::mutex lock;
+         std::condition_variable work, done;
+         std::deque<Request> requests;
+         std::deque<Completion> completions;
+         std::thread worker; // started last
+      };
+
+
+#ifdef HAVE_LINUX_IO_URING_H
+      static int sys_io_uring_setup(unsigned entries, io_uring_params *p) {
+         return syscall(__NR_io_uring_setup, entries, p);
+      }
+
+      static int sys_io_uring_enter(int ring, unsigned to_submit, unsigned min_complete,
+                                    unsigned flags) {
+         return syscall(__NR_io_uring_enter, ring, to_submit, min_complete, flags, nullptr, 0);
+      }
+
+      static int sys_io_uring_register(int ring, unsigned opcode, const void *arg, unsigned n) {
+         return syscall(__NR_io_uring_register, ring, opcode, arg, n);
+      }
+
+      //
+      // io_uring, driven with the raw system calls
+      //
+      class UringBackend : public AsyncBackend
+      {
+      public:
+         // returns nullptr if the kernel doesn't support io_uring
+         static UringBackend *create(int fd, ui16 entries) {
+            UringBackend *u = new UringBackend(fd);
+            if (!u->setup(entries)) {
+               delete u;
+               return nullptr;
+            }
+            return u;
+         }
+
+         ~UringBackend() {
+            if (sq_ring != MAP_FAILED)
+               munmap(sq_ring, sq_ring_size);
+            if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+               munmap(cq_ring, cq_ring_size);
+            if (sqes != MAP_FAILED)
+               munmap(sqes, sqes_size);
+            if (ring >= 0)
+               close(ring);
+         }
+
+         // registers the buffers for IORING_OP_WRITE_FIXED
+         bool registerBuffers(const std::vector<iovec> &iov) {
+            fixed = (sys_io_uring_register(ring, IORING_REGISTER_BUFFERS,
+                                           iov.data(), iov.size()) == 0);
+            return fixed;
+         }
+
+         virtual ui16 submit(const Request *r, ui16 n, bool linked) {
+            unsigned tail = *sq_tail;
+            for (ui16 i = 0; i < n; i++, tail++) {
+               unsigned idx = tail & sq_mask;
+               io_uring_sqe &sqe = sqes[idx];
+
+               memset(&sqe, 0, sizeof(sqe));
+               sqe.opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+               sqe.fd = fd;
+               sqe.addr = reinterpret_cast<ui64>(r[i].data);
+               sqe.len = r[i].len;
+               sqe.off = r[i].offset;
+               sqe.user_data = r[i].buf;
+               if (fixed)
+                  sqe.buf_index = r[i].buf;
+               if (linked && i + 1 < n)
+                  sqe.flags = IOSQE_IO_LINK;
+
+               sq_array[idx] = idx;
+            }
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+            // the kernel may take the entries in several goes. EBUSY
+            // (and EAGAIN) mean the completion ring is full, so it's
+            // emptied before trying again. The entries it didn't take
+            // are withdrawn from the ring if it fails
+            ui16 taken = 0;
+            while (taken < n) {
+               int ret = sys_io_uring_enter(ring, n - taken, 0, 0);
+               if (ret < 0) {
+                  if (errno == EINTR)
+                     continue;
+                  if ((errno == EAGAIN || errno == EBUSY) && stash())
+                     continue;
+                  break;
+               }
+               if (ret == 0) {
+                  errno = EIO;
+                  break;
+               }
+               taken += ret;
+               in_kernel += ret;
+            }
+
+            if (taken < n)
+               __atomic_store_n(sq_tail, tail - (n - taken), __ATOMIC_RELEASE);
+            return taken;
+         }
+
+         virtual ui16 reap(Completion *c, ui16 max, bool wait) {
+            ui16 n = 0;
+            for (; n < max && !stashed.empty(); n++) {
+               c[n] = stashed.front();
+               stashed.pop_front();
+            }
+            if (n > 0)
+               wait = false;
+
+            if (wait && *cq_head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+               waitOne();
+            return n + take(c + n, max - n);
+         }
+
+      private:
+         // moves up to max completions out of the ring
+         ui16 take(Completion *c, ui16 max) {
+            ui16 n = 0;
+            unsigned head = *cq_head;
+            unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            for (; n < max && head != tail; head++, n++) {
+               const io_uring_cqe &cqe = cqes[head & cq_mask];
+               c[n].buf = static_cast<ui16>(cqe.user_data);
+               c[n].res = cqe.res;
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            in_kernel -= n;
+            return n;
+         }
+
+         bool waitOne() {
+            int ret;
+            while ((ret = sys_io_uring_enter(ring, 0, 1, IORING_ENTER_GETEVENTS)) < 0 &&
+                   errno == EINTR)
+               ;
+            return ret >= 0;
+         }
+
+         // keeps the completions waiting in the ring for reap(),
+         // waiting for one if there are none but writes are in
+         // flight. False if nothing could be freed
+         bool stash() {
+            if (*cq_head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE) &&
+                (in_kernel == 0 || !waitOne()))
+               return false;
+
+            Completion c[64];
+            ui16 n, total = 0;
+            while ((n = take(c, 64)) > 0) {
+               stashed.insert(stashed.end(), c, c + n);
+               total += n;
+            }
+            return total > 0;
+         }
+
+         UringBackend(int fd) :
+            fd(fd), ring(-1), fixed(false), in_kernel(0),
+            sq_ring(MAP_FAILED), cq_ring(MAP_FAILED), sqes(static_cast<io_uring_sqe *>(MAP_FAILED)) {}
+
+         bool setup(ui16 entries) {
+            io_uring_params p;
+            memset(&p, 0, sizeof(p));
+            ring = sys_io_uring_setup(entries, &p);
+            if (ring < 0)
+               return false;
+
+            sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            if (p.features & IORING_FEAT_SINGLE_MMAP)
+               sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+            sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+            if (sq_ring == MAP_FAILED)
+               return false;
+
+            if (p.features & IORING_FEAT_SINGLE_MMAP)
+               cq_ring = sq_ring;
+            else {
+               cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+               if (cq_ring == MAP_FAILED)
+                  return false;
+            }
+
+            sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+            sqes = static_cast<io_uring_sqe *>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                                                    MAP_SHARED | MAP_POPULATE, ring,
+                                                    IORING_OFF_SQES));
+            if (sqes == MAP_FAILED)
+               return false;
+
+            ui8 *sq = static_cast<ui8 *>(sq_ring), *cq = static_cast<ui8 *>(cq_ring);
+            sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+            sq_mask = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+            cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+            cq_mask = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+            return true;
+         }
+
+         int fd, ring;
+         bool fixed;
+         unsigned in_kernel;                // submitted and not yet taken
+         std::deque<Completion> stashed;    // taken while submitting
+
+         void *sq_ring, *cq_ring;
+         std::size_t sq_ring_size, cq_ring_size, sqes_size;
+         io_uring_sqe *sqes;
+         unsigned *sq_tail, *sq_array, sq_mask;
+         unsigned *cq_head, *cq_tail, cq_mask;
+         io_uring_cqe *cqes;
+      };
+#endif
+   }
+
+   using namespace async_priv;
+
+
+   // --------------------------------
+   // asynchronous writer
+   //
+   AsyncWriter::AsyncWriter(int fd) : AsyncWriter(fd, Options()) {}
+
+   AsyncWriter::AsyncWriter(int f, const Options &o) :
+      fd(f), opts(o), kind(WRITER_THREAD), registered(false), seekable(false),
+      pool(nullptr), current(-1), in_flight(0), offset(0), next_seq(0),
+      bytes_written(0), err(0)
+   {
+      opts.num_buffers = std::max<ui16>(opts.num_buffers, 1);
+      opts.batch = std::clamp<ui16>(opts.batch, 1, opts.num_buffers);
+      opts.buffer_size = std::max<ui32>(opts.buffer_size, 1);
+
+      // regular files (not in append mode) are written at explicit
+      // offsets, everything else in order
+      struct stat st;
+      off_t pos = lseek(fd, 0, SEEK_CUR);
+      int flags = fcntl(fd, F_GETFL);
+      if (pos >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+          flags >= 0 && !(flags & O_APPEND)) {
+         seekable = true;
+         offset = pos;
+      }
+
+      // the pool, in one block
+      std::size_t pool_size = static_cast<std::size_t>(opts.buffer_size) * opts.num_buffers;
+      pool_size = (pool_size + POOL_ALIGN - 1) / POOL_ALIGN * POOL_ALIGN;
+      pool = static_cast<ui8 *>(::operator new(pool_size, std::align_val_t(POOL_ALIGN)));
+
+      std::vector<iovec> iov;
+      for (ui16 i = 0; i < opts.num_buffers; i++) {
+         buffers.push_back({ pool + i * opts.buffer_size, 0, 0, 0, 0 });
+         iov.push_back({ buffers.back().data, opts.buffer_size });
+      }
+
+      // handed out from the back, so in order
+      for (ui16 i = opts.num_buffers; i > 0; i--)
+         free_buffers.push_back(i - 1);
+
+#ifdef HAVE_LINUX_IO_URING_H
+      if (opts.use_io_uring) {
+         UringBackend *u = UringBackend::create(fd, opts.num_buffers);
+         if (u) {
+            if (opts.register_buffers)
+               registered = u->registerBuffers(iov);
+            io.reset(u);
+            kind = IO_URING;
+         }
+      }
+#endif
+      if (!io)
+         io.reset(new ThreadBackend(fd));
+   }
+
+   AsyncWriter::~AsyncWriter()
+   {
+      flush();
+      io.reset();
+      ::operator delete(pool, std::align_val_t(POOL_ALIGN));
+   }
+
+
+   //
+   // copies the data into the buffers, submitting them as they fill
+   //
+   bool AsyncWriter::write(const ui8 *data, std::size_t len)
+   {
+      while (len > 0 && !err) {
+         if (current < 0) {
+            // wait for a buffer to be freed
+            while (free_buffers.empty() && !err) {
+               submitReady();
+               poll(true);
+            }
+            if (err)
+               break;
+
+            current = free_buffers.back();
+            free_buffers.pop_back();
+            buffers[current].len = 0;
+         }
+
+         Buffer &b = buffers[current];
+         ui32 n = std::min<std::size_t>(len, opts.buffer_size - b.len);
+         memcpy(b.data + b.len, data, n);
+         b.len += n;
+         data += n;
+         len -= n;
+
+         if (b.len == opts.buffer_size) {
+            queue(current);
+            current = -1;
+            if (ready.size() >= opts.batch)
+               submitReady();
+         }
+      }
+
+      poll();
+      return !err;
+   }
+
+
+   //
+   // submits the partially filled buffer as well
+   //
+   bool AsyncWriter::submit()
+   {
+      if (current >= 0 && buffers[current].len > 0) {
+         queue(current);
+         current = -1;
+      }
+      submitReady();
+      return !err;
+   }
+
+
+   //
+   // waits for everything to be written. Seekable descriptors are
+   // left positioned after the data
+   //
+   bool AsyncWriter::flush()
+   {
+      submit();
+      while (in_flight > 0) {
+         poll(true);
+         submitReady();
+      }
+
+      if (seekable)
+         lseek(fd, offset, SEEK_SET);
+      return !err;
+   }
+
+
+   //
+   // collects the completions
+   //
+   ui16 AsyncWriter::poll(bool wait)
+   {
+      AsyncBackend::Completion c[64];
+      ui16 freed = free_buffers.size();
+
+      ui16 n = io->reap(c, 64, wait && in_flight > 0);
+      for (ui16 i = 0; i < n; i++)
+         complete(c[i].buf, c[i].res);
+
+      // resubmit anything left over, and for in-order descriptors the
+      // next batch once this one is done
+      submitReady();
+      return free_buffers.size() - freed;
+   }
+
+
+   //
+   // assigns the buffer its place in the output
+   //
+   void AsyncWriter::queue(ui16 i)
+   {
+      Buffer &b = buffers[i];
+      b.done = 0;
+      b.seq = next_seq++;
+      b.offset = offset;
+      if (seekable)
+         offset += b.len;
+      ready.push_back(i);
+   }
+
+   //
+   // puts back a buffer that wasn't completely written, keeping the
+   // ready list in output order
+   //
+   void AsyncWriter::requeue(ui16 i)
+   {
+      auto pos = std::find_if(ready.begin(), ready.end(),
+                              [&](ui16 r) { return buffers[r].seq > buffers[i].seq; });
+      ready.insert(pos, i);
+   }
+
+
+   //
+   // submits the buffers waiting in the ready list
+   //
+   bool AsyncWriter::submitReady()
+   {
+      if (err) {
+         // nothing more goes out after a failure
+         free_buffers.insert(free_buffers.end(), ready.begin(), ready.end());
+         ready.clear();
+         return false;
+      }
+
+      // in-order descriptors have one (linked) batch in flight at a
+      // time
+      if (ready.empty() || (!seekable && in_flight > 0))
+         return true;
+
+      std::vector<AsyncBackend::Request> reqs;
+      reqs.reserve(ready.size());
+      for (ui16 i : ready) {
+         const Buffer &b = buffers[i];
+         reqs.push_back({ i, b.data + b.done, b.len - b.done,
+                          seekable ? b.offset + b.done : static_cast<ui64>(AsyncBackend::CUR_POS) });
+      }
+
+      // only the buffers the backend took are in flight. The rest are
+      // reclaimed as failed
+      errno = 0;
+      ui16 sent = io->submit(reqs.data(), reqs.size(), !seekable);
+      in_flight += sent;
+      ready.erase(ready.begin(), ready.begin() + sent);
+
+      if (sent < reqs.size()) {
+         err = errno ? errno : EIO;
+         return submitReady();
+      }
+      return true;
+   }
+
+
+   //
+   // handles the result of a write. Short writes and writes cancelled
+   // because an earlier one in their chain was short are resubmitted
+   //
+   void AsyncWriter::complete(ui16 i, int res)
+   {
+      Buffer &b = buffers[i];
+      in_flight--;
+
+      if (res == -ECANCELED) {
+         requeue(i);
+         return;
+      }
+
+      if (res > 0) {
+         b.done += res;
+         bytes_written += res;
+         if (b.done < b.len) {
+            requeue(i);
+            return;
+         }
+      }
+      else if (b.len > 0 && !err)
+         err = (res < 0) ? -res : EIO;
+
+      free_buffers.push_back(i);
+      if (handler)
+         handler(b.done, (res < 0) ? -res : 0);
+   }
+
+} // namespace
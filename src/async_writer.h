@@ -0,0 +1,196 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// async_writer.h: asynchronous output to a file descriptor, with
+// io_uring or a writer thread
+// -----------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "types.h"
+#include "output.h"
+
+namespace sigen {
+
+   class AsyncBackend;
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \brief Asynchronous writes to a file, FIFO or any other file
+    * descriptor.
+    *
+    * Data (sections or the TS packets of an MpgPacketizer) is copied
+    * into a pool of fixed size buffers. Full buffers are submitted in
+    * batches to io_uring, when the kernel supports it, or otherwise
+    * to a dedicated writer thread. The pool bounds the data in
+    * flight: write() only blocks once every buffer is waiting to be
+    * written. Producers that must never block check writable() and
+    * call poll() to collect completions:
+    *
+    * \code
+    *    AsyncWriter out(fd);
+    *    MpgPacketizer pkt(out, 0);
+    *    ...
+    *    if (out.writable())
+    *       pkt.packetize(section, pid);
+    *    out.poll();
+    * \endcode
+    *
+    * Regular files are written at explicit offsets so the writes may
+    * complete in any order. Pipes, FIFOs and files opened with
+    * O_APPEND are written in order, one batch at a time.
+    *
+    * \attention Not thread-safe - a single thread writes and the
+    * completion handler is called from write(), poll() and flush().
+    */
+   class AsyncWriter : public OutputSink
+   {
+   public:
+      //! \brief The mechanism used to write the buffers.
+      enum Backend {
+         IO_URING,       //!< Submitted to an io_uring.
+         WRITER_THREAD   //!< Written by a thread owned by the AsyncWriter.
+      };
+
+      //! \brief Configuration.
+      struct Options {
+         ui32 buffer_size = 64 * 1024;  //!< Size of each buffer in the pool.
+         ui16 num_buffers = 8;          //!< Number of buffers in the pool.
+         ui16 batch = 4;                //!< Full buffers to collect before submitting them.
+         bool use_io_uring = true;      //!< `false` always uses the writer thread.
+         bool register_buffers = true;  //!< Register the pool with the io_uring.
+      };
+
+      /*!
+       * \brief Handler called as each buffer completes.
+       * \param bytes Bytes written from the buffer.
+       * \param error errno value if the write failed, otherwise 0.
+       */
+      typedef std::function<void(std::size_t bytes, int error)> CompletionHandler;
+
+      /*!
+       * \brief Constructor.
+       * \param fd Open file descriptor. Not closed by the writer.
+       */
+      explicit AsyncWriter(int fd);
+      /*!
+       * \brief Constructor.
+       * \param fd Open file descriptor. Not closed by the writer.
+       * \param options Configuration.
+       */
+      AsyncWriter(int fd, const Options &options);
+      //! \brief Destructor. Waits for all the data to be written.
+      ~AsyncWriter();
+
+      AsyncWriter(const AsyncWriter &) = delete;
+      AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+      using OutputSink::write;
+      /*!
+       * \brief Copy data into the buffers. Blocks if they are all in
+       * flight.
+       * \return `false` if a write has failed.
+       */
+      virtual bool write(const ui8 *data, std::size_t len);
+      /*!
+       * \brief Submit everything written so far and wait for it to
+       * complete.
+       * \return `false` if any write failed.
+       */
+      virtual bool flush();
+
+      /*!
+       * \brief Submit everything written so far, including a
+       * partially filled buffer, without waiting for it.
+       * \return `false` if a write has failed.
+       */
+      bool submit();
+      /*!
+       * \brief Collect completed writes.
+       * \param wait Wait for at least one to complete, if any are in
+       * flight.
+       * \return The number of buffers completed.
+       */
+      ui16 poll(bool wait = false);
+
+      //! \brief Returns `true` if write() can take data without blocking.
+      bool writable() const { return current >= 0 || !free_buffers.empty(); }
+      //! \brief Number of buffers available for new data.
+      ui16 freeBuffers() const { return free_buffers.size(); }
+      //! \brief Number of buffers submitted and not yet complete.
+      ui16 inFlight() const { return in_flight; }
+      //! \brief Total bytes written to the file descriptor.
+      std::size_t bytesWritten() const { return bytes_written; }
+      //! \brief The errno value of the first failed write, or 0.
+      int error() const { return err; }
+
+      //! \brief Returns the mechanism in use.
+      Backend backend() const { return kind; }
+      //! \brief Returns `true` if the pool is registered with the io_uring.
+      bool buffersRegistered() const { return registered; }
+
+      //! \brief Sets the handler called as buffers complete.
+      void setCompletionHandler(CompletionHandler h) { handler = std::move(h); }
+
+   private:
+      struct Buffer {
+         ui8 *data;
+         ui32 len;     // bytes filled
+         ui32 done;    // bytes written
+         ui64 seq;     // order filled
+         ui64 offset;  // file offset (seekable descriptors)
+      };
+
+      void queue(ui16 b);
+      void requeue(ui16 b);
+      bool submitReady();
+      void complete(ui16 b, int res);
+
+      int fd;
+      Options opts;
+      Backend kind;
+      bool registered;
+      bool seekable;
+      std::unique_ptr<AsyncBackend> io;
+
+      ui8 *pool;
+      std::vector<Buffer> buffers;
+      std::vector<ui16> free_buffers;
+      std::deque<ui16> ready;     // filled, waiting to be submitted
+      int current;                // buffer being filled or -1
+      ui16 in_flight;
+
+      ui64 offset;                // where the next buffer goes
+      ui64 next_seq;
+      std::size_t bytes_written;
+      int err;
+      CompletionHandler handler;
+   };
+
+   //! @}
+
+} // sigen namespace
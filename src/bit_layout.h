@@ -0,0 +1,101 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// bit_layout.h: compile-time layout of packed bit-field records
+// -----------------------------------
+
+#pragma once
+
+#include "types.h"
+#include "tstream.h"
+
+namespace sigen {
+
+   /*!
+    * \addtogroup utility
+    * @{
+    */
+
+   /*!
+    * \brief Fixed layout of a record of big-endian bit fields.
+    *
+    * The template arguments are the field widths, most significant
+    * first, and must add up to a whole number of bytes. The values are
+    * masked to their width and packed in one pass, so adjacent fields
+    * fold into whole-byte stores, and write() checks the section's
+    * capacity once for the record. E.g., for a TS packet header:
+    *
+    * \code
+    * BitLayout<8, 1, 1, 1, 13, 2, 2, 4>::pack(packet, 0x47, tei, pusi, tp,
+    *                                           pid, tsc, afc, cc);
+    * \endcode
+    */
+   template <unsigned... W>
+   class BitLayout
+   {
+   public:
+      enum : unsigned {
+         BITS = (W + ... + 0),  //!< Total bits in the record.
+         BYTES = BITS / 8       //!< Total bytes in the record.
+      };
+
+      static_assert(sizeof...(W) > 0, "layout needs at least one field");
+      static_assert(BITS % 8 == 0, "layout must be a whole number of bytes");
+      static_assert(((W > 0 && W <= 32) && ...), "field widths must be 1 to 32 bits");
+
+      /*!
+       * \brief Pack the values into BYTES bytes at out.
+       * \param out Destination - must have room for BYTES bytes.
+       * \param v One value per field.
+       */
+      template <class... V>
+      static constexpr void pack(ui8* out, V... v) {
+         static_assert(sizeof...(V) == sizeof...(W), "one value per field");
+
+         ui64 acc = 0;
+         unsigned bits = 0;
+         (put(out, acc, bits, W, static_cast<ui32>(v)), ...);
+      }
+
+      /*!
+       * \brief Pack the values and append them to the section.
+       * \param s Section to write to.
+       * \param v One value per field.
+       */
+      template <class... V>
+      static void write(Section& s, V... v) {
+         pack(s.reserve(BYTES), v...);
+      }
+
+   private:
+      // shifts a field into the accumulator and stores any whole
+      // bytes it completes
+      static constexpr void put(ui8*& out, ui64& acc, unsigned& bits, unsigned w, ui32 v) {
+         acc = (acc << w) | (v & static_cast<ui32>((ui64(1) << w) - 1));
+         bits += w;
+         while (bits >= 8) {
+            bits -= 8;
+            *out++ = static_cast<ui8>(acc >> bits);
+         }
+      }
+   };
+
+   //! @}
+
+} // namespace
@@ -0,0 +1,65 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// build_stats.cc: optional per-table build statistics
+// -----------------------------------
+
+#include "build_stats.h"
+
+#ifdef ENABLE_BUILD_STATS
+
+#include <numeric>
+#include "tstream.h"
+
+namespace sigen
+{
+   //
+   // sum of the unused space in all sections
+   ui32 BuildStats::totalSlack() const
+   {
+      return std::accumulate(slack.begin(), slack.end(), static_cast<ui32>(0));
+   }
+
+   //
+   // adds the section's counts to the totals
+   void BuildStats::record(const Section& s)
+   {
+      sections++;
+      bytes += s.length();
+      items += s.getItemCount();
+      descriptors += s.getDescCount();
+      slack.push_back(s.capacity() - s.length());
+   }
+
+   //
+   // timer for the build - counters are cleared when it starts
+   BuildStats::Scope::Scope(BuildStats& s) :
+      stats(s), start(std::chrono::steady_clock::now())
+   {
+      stats = BuildStats();
+   }
+
+   BuildStats::Scope::~Scope()
+   {
+      stats.wall_time = std::chrono::steady_clock::now() - start;
+   }
+
+} // namespace sigen
+
+#endif
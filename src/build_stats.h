@@ -0,0 +1,85 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// build_stats.h: optional per-table build statistics. Only compiled
+// in when ENABLE_BUILD_STATS is defined (--enable-build-stats)
+// -----------------------------------
+
+#pragma once
+
+#include "config.h"
+
+#ifdef ENABLE_BUILD_STATS
+
+#include <chrono>
+#include <vector>
+#include "types.h"
+
+namespace sigen {
+
+   class Section;
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \brief Counters recorded by a table's most recent call to
+    * buildSections().
+    *
+    * Accessible via STable::getBuildStats() when the library is
+    * configured with `--enable-build-stats`.
+    */
+   struct BuildStats
+   {
+      ui16 sections = 0;                     //!< Number of sections produced.
+      ui32 bytes = 0;                        //!< Bytes written to all sections (including CRCs).
+      ui32 items = 0;                        //!< Loop entries (services, events, etc.) written.
+      ui32 descriptors = 0;                  //!< Descriptors written.
+      std::vector<ui16> slack;               //!< Unused bytes in each section (capacity - length).
+      std::chrono::nanoseconds wall_time{0}; //!< Time spent in buildSections().
+
+      //! \brief Total unused bytes across all sections.
+      ui32 totalSlack() const;
+
+      //! \internal
+      //! \brief Adds the counts of a completed section.
+      void record(const Section& s);
+
+      //! \internal
+      //! \brief Resets the counters and times its lifetime.
+      class Scope {
+      public:
+         Scope(BuildStats& s);
+         ~Scope();
+
+      private:
+         BuildStats& stats;
+         std::chrono::steady_clock::time_point start;
+      };
+   };
+
+   //! @}
+
+} // sigen namespace
+
+  #define BUILD_STAT(x) x
+#else
+  #define BUILD_STAT(x) // compiled out
+#endif
@@ -42,9 +42,40 @@ namespace sigen
    }
 
    //
-   // writes the data to the stream
+   // the sections writeSection() will produce
+   void CAT::planSections(SectionPlan& plan) const
+   {
+      SectionPlanner p(plan, BASE_LENGTH, getMaxDataLen(), descriptors.begin());
+      for (auto d = descriptors.begin(); d != descriptors.end(); ++d) {
+         p.atDesc(d);
+         p.add((*d)->length());
+      }
+      p.finish();
+   }
+
    //
+   // a writer with its own context, from a planned section on
+   PSITable::SectionWriter CAT::sectionWriter(const SectionStart& at) const
+   {
+      Context start;
+      start.op_state = WRITE_HEAD;
+      start.d_iter = at.desc;
+
+      return [this, start](Section& s, ui8 cur_sec, ui16& sec_bytes) mutable {
+         return writeSection(s, cur_sec, sec_bytes, start);
+      };
+   }
+
+
    bool CAT::writeSection(Section& section, ui8 cur_sec, ui16 &sec_bytes) const
+   {
+      return writeSection(section, cur_sec, sec_bytes, run);
+   }
+
+   //
+   // writes the data to the stream
+   //
+   bool CAT::writeSection(Section& section, ui8 cur_sec, ui16 &sec_bytes, Context& run) const
    {
       bool done = false, exit = false;
 
@@ -61,14 +92,9 @@ namespace sigen
               // common data for every section
               // if table's length is > max_section_len, we'll
               // overwrite the section length later on
-              writeSectionHeader(section);
-
-              // section count information
-              section.set08Bits(cur_sec);
-
-              // we don't know the last section number yet, so
-              // for now set it to 0,
-              section.set08Bits(0);//last_sec_num);
+              // section count information. We don't know the last section
+              // number yet, so for now set it to 0
+              writeSectionHeader(section, cur_sec, 0);
 
               sec_bytes = BASE_LENGTH; // the minimum section size
               run.op_state = (!run.d ? GET_DESC : WRITE_DESC);
@@ -99,7 +125,7 @@ namespace sigen
 
            case WRITE_DESC:
               // add the network descriptor
-              run.d->buildSections(section);
+              run.d->encode(section);
               sec_bytes += run.d->length();
 
               // try to add another one
@@ -60,6 +60,17 @@ namespace sigen {
        * \param desc Descriptor to add.
        */
       bool addDesc(Descriptor& desc);
+      /*!
+       * \brief Construct a Descriptor of type T in the table's storage and
+       * add it to the descriptors loop.
+       * \param args Arguments forwarded to the T constructor.
+       */
+      template <class T, class... Args>
+      bool emplaceDesc(Args&&... args) {
+         return emplaceWith<T>(descriptors.resource(),
+                               [this](Descriptor& d) { return addDesc(d); },
+                               std::forward<Args>(args)...);
+      }
 
 #ifdef ENABLE_DUMP
       virtual void dump(std::ostream &) const;
@@ -74,17 +85,22 @@ namespace sigen {
       DescList descriptors;
 
       enum State_t { INIT, WRITE_HEAD, GET_DESC, WRITE_DESC };
-      mutable struct Context {
+      struct Context {
          Context() : d_done(false), op_state(INIT), d(nullptr) {}
 
          bool d_done;
          State_t op_state;
          const Descriptor *d;
-         std::list<std::unique_ptr<Descriptor> >::const_iterator d_iter;
-      } run;
+         DescList::const_iterator d_iter;
+      };
+      mutable Context run;
+
+      bool writeSection(Section&, ui8, ui16 &, Context& run) const;
 
    protected:
       virtual bool writeSection(Section&, ui8, ui16 &) const;
+      virtual void planSections(SectionPlan&) const;
+      virtual SectionWriter sectionWriter(const SectionStart&) const;
    };
    //! @}
    //! @}
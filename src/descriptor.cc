@@ -20,6 +20,7 @@
 // descriptor.c: base descriptor & stream descriptor classes
 // -----------------------------------
 
+#include <cstring>
 #include <iostream>
 #include <list>
 #include <string>
@@ -35,6 +36,7 @@ namespace sigen
    {
       s.set08Bits(tag);
       s.set08Bits(total_length - 2);
+      BUILD_STAT( s.countDesc() );
    }
 
 
@@ -73,21 +75,58 @@ namespace sigen
    //
    std::string Descriptor::incLength(const std::string& str)
    {
-      std::string new_str(str);
-      ui16 len = new_str.length();
+      return str.substr( 0, incLengthUpTo(str.length()) );
+   }
 
-      // determine if the current string can fit
+   //
+   // increments the descriptor length by len or, if it doesn't fit,
+   // by whatever free space is left. Returns the amount added
+   ui16 Descriptor::incLengthUpTo(ui16 len)
+   {
+      // determine if the full length can fit
       if ( !lengthFits(len) ) {
          // nope.. truncate it to the max size
-         ui16 free_space = CAPACITY - total_length;
-
-         new_str = new_str.substr( 0, free_space );
-         len = free_space;
+         len = CAPACITY - total_length;
       }
 
       // increment the descriptor's length
       total_length += len;
-      return new_str;
+      return len;
+   }
+
+
+   // ---------------------------------------
+   // inline data descriptor base class
+   //
+
+   //
+   // language codes are always written as 3 bytes, space-padded
+   void InlineDataDesc::put(const LanguageCode &code)
+   {
+      const std::string &c = code.str();
+      for (ui8 i = 0; i < LanguageCode::ISO_639_2_CODE_LENGTH; i++)
+         put08( i < c.length() ? c[i] : ' ' );
+   }
+
+   void InlineDataDesc::put(const ui8 *d, ui16 len)
+   {
+      memcpy(payload + payload_len, d, len);
+      payload_len += len;
+   }
+
+   //
+   // same rules as incLength(string) but copies straight into the
+   // payload instead of returning a resized string
+   void InlineDataDesc::putTruncated(const std::string &str)
+   {
+      put( reinterpret_cast<const ui8 *>(str.data()), incLengthUpTo(str.length()) );
+   }
+
+   void InlineDataDesc::putString(const std::string &str)
+   {
+      ui16 len = incLengthUpTo(str.length());
+      put08( len );
+      put( reinterpret_cast<const ui8 *>(str.data()), len );
    }
 
 
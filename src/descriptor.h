@@ -47,12 +47,20 @@ namespace sigen {
     * \warning Note that once added, the descriptor must not
     * be modified by the caller (in essence, the pointer is now
     * invalid).
+    *
+    * Descriptors whose data is fully given to their constructor can
+    * instead be constructed by the table itself with the
+    * `emplace...Desc<T>(args...)` methods (e.g.,
+    * SDT::emplaceServiceDesc()). These allocate it from the table's
+    * memory resource and delete it if it doesn't fit.
     */
    class Descriptor : public Table
    {
    public:
       virtual ~Descriptor() { }
 
+      SIGEN_TRACKED_NEW(AllocKind::DESCRIPTOR)
+
       //! \brief Returns the total length of the descriptor data.
       ui16 length() const { return total_length; }
 
@@ -60,6 +68,21 @@ namespace sigen {
       //! \brief  Write data bytes to the section. Used by the sectionizer.
       virtual void buildSections(Section &s) const;
 
+      //! \internal
+      //! \brief Write the descriptor to the section. Used by the
+      //! table writers: descriptors that keep their body in wire
+      //! format (InlineDataDesc subclasses, which can't override
+      //! buildSections()) are copied without a virtual call. All
+      //! others go through buildSections().
+      void encode(Section &s) const {
+         if (wire_payload) {
+            Descriptor::buildSections(s);
+            s.setBits( wire_payload, total_length - 2 );
+         }
+         else
+            buildSections(s);
+      }
+
       virtual ui32 type() const { return 0; } // 0 = standard data desc
 
    private:
@@ -67,6 +90,8 @@ namespace sigen {
 
    protected:
       const ui8 tag;
+      // set by descriptors whose body is kept in wire format
+      const ui8 *wire_payload = nullptr;
 
       enum { MAX_LEN = 255, CAPACITY = 257 };
 
@@ -86,6 +111,8 @@ namespace sigen {
       bool incLength(ui8 len);
       // increments the length of the desc based on the given string's length
       std::string incLength(const std::string &str);
+      // increments the length by up to len bytes, returning how many fit
+      ui16 incLengthUpTo(ui16 len);
    };
 
 
@@ -125,34 +152,70 @@ namespace sigen {
    };
 
 
+   // ---------------------------
+   // Inline Data Descriptor - for descriptors whose body is kept in
+   // its wire format in a fixed buffer inside the object, so
+   // populating one makes no allocations beyond the descriptor itself
+   // (which is placed in the current memory resource).  Derived
+   // classes must reserve space with incLength() before appending, and
+   // are written from the payload: they can't override buildSections()
+   //
+   class InlineDataDesc : public Descriptor
+   {
+   protected:
+      // constructor - base_len bytes of fixed fields must still be
+      // put by the derived class
+      InlineDataDesc(ui8 tag, ui8 base_len = 0) :
+         Descriptor(tag, base_len),
+         payload_len(0) {
+         wire_payload = payload;
+      }
+
+      // append to the payload
+      void put08(ui8 d) { payload[payload_len++] = d; }
+      void put(const LanguageCode &code);
+      void put(const ui8 *d, ui16 len);
+      // appends as much of str as fits, incrementing the length
+      void putTruncated(const std::string &str);
+      // as putTruncated() but preceded by its 8-bit length (which
+      // must be accounted for in the base length)
+      void putString(const std::string &str);
+
+      // payload accessors for the derived classes' dump()
+      const ui8 *payloadData() const { return payload; }
+      ui16 payloadLength() const { return payload_len; }
+
+      virtual void buildSections(Section &s) const final {
+         Descriptor::buildSections(s);
+         s.setBits( payload, payload_len );
+      }
+
+   private:
+      ui8 payload[ MAX_LEN ];
+      ui16 payload_len;
+   };
+
+
    // ---------------------------
    // String Data Descriptor - for descriptors that store data in a
    // variable length sequence of characsters
    //
-   class StringDataDesc : public Descriptor
+   class StringDataDesc : public InlineDataDesc
    {
    protected:
       // constructor
       StringDataDesc(ui8 tag, const std::string &str) :
-         Descriptor(tag, 0),
-         data( incLength(str) ) {
-      }
-
-      // utility functions
-      virtual void buildSections(Section &s) const {
-         Descriptor::buildSections(s);
-         s.setBits( data );
+         InlineDataDesc(tag) {
+         putTruncated(str);
       }
 
 #ifdef ENABLE_DUMP
       void dumpData(std::ostream &o, STRID desc_type, STRID data_type) const {
          dumpHeader( o, desc_type );
-         identStr(o, data_type, data );
+         identStr(o, data_type,
+                  std::string(reinterpret_cast<const char*>(payloadData()), payloadLength()) );
       }
 #endif
-
-   private:
-      std::string data;
    };
 
 
@@ -196,7 +259,7 @@ namespace sigen {
       };
 
       // descriptor data members begin here
-      std::list<Text> ml_text_list;
+      LoopList<Text> ml_text_list;
 
       // protected constructor - only derived classes can build this
       MultilingualTextDesc(ui8 tag, ui8 base_len = 0) : Descriptor(tag, base_len) {}
@@ -296,28 +296,17 @@ namespace sigen
    bool ServiceListDesc::addService(ui16 id, ui8 type)
    {
       // make sure we have room to add is
-      if ( !incLength( Service::BASE_LEN ) )
+      if ( !incLength( SERVICE_LEN ) )
          return false;
 
       // and then add it
-      service_list.emplace_back(id, type);
+      put08( id >> 8 );
+      put08( id & 0xff );
+      put08( type );
       return true;
    }
 
 
-   //
-   // write contents to a section
-   void ServiceListDesc::buildSections(Section &s) const
-   {
-      Descriptor::buildSections(s);
-
-      for (const auto &service : service_list) {
-         s.set16Bits( service.id );
-         s.set08Bits( service.type );
-      }
-   }
-
-
 #ifdef ENABLE_DUMP
    void ServiceListDesc::dump(std::ostream &o) const
    {
@@ -326,9 +315,10 @@ namespace sigen
       // dump the descriptor's data
       incOutLevel();
 
-      for (const auto &service : service_list) {
-         identStr(o, SERVICE_ID_S, service.id);
-         identStr(o, TYPE_S, service.type);
+      const ui8 *d = payloadData();
+      for (ui16 i = 0; i < payloadLength(); i += SERVICE_LEN) {
+         identStr(o, SERVICE_ID_S, static_cast<ui16>((d[i] << 8) | d[i + 1]));
+         identStr(o, TYPE_S, d[i + 2]);
       }
       decOutLevel();
    }
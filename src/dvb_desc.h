@@ -83,7 +83,7 @@ namespace sigen {
 #endif
 
    private:
-      std::list<ui16> id_list;
+      LoopList<ui16> id_list;
    };
 
 
@@ -120,7 +120,7 @@ namespace sigen {
    private:
       bool country_availability_flag;
 
-      std::list<LanguageCode> country_list;
+      LoopList<LanguageCode> country_list;
    };
 
 
@@ -247,7 +247,7 @@ namespace sigen {
          TimeOffset() = delete;
       };
 
-      std::list<TimeOffset> time_offset_list;
+      LoopList<TimeOffset> time_offset_list;
    };
 
 
@@ -357,13 +357,13 @@ namespace sigen {
    /*!
     * \brief Service List Descriptor.
     */
-   class ServiceListDesc : public Descriptor
+   class ServiceListDesc : public InlineDataDesc
    {
    public:
       enum { TAG = 0x41 };
 
       //! \brief Constructor.
-      ServiceListDesc() : Descriptor(TAG) { }
+      ServiceListDesc() : InlineDataDesc(TAG) { }
 
       /*!
        * \brief Add s service to the data loop.
@@ -372,26 +372,13 @@ namespace sigen {
        */
       bool addService(ui16 service_id, ui8 service_type);
 
-      virtual void buildSections(Section&) const;
-
 #ifdef ENABLE_DUMP
       virtual void dump(std::ostream&) const;
 #endif
 
    private:
-      // service structs for the list
-      struct Service : public STable::ListItem {
-         enum { BASE_LEN = 3 };
-
-         ui16 id;
-         ui8 type;
-
-         // constructors
-         Service(ui16 sid, ui8 stype) : id(sid), type(stype) {}
-         Service() = delete;
-      };
-
-      std::list<Service> service_list;
+      // each entry is the 2-byte service id + 1-byte type
+      enum { SERVICE_LEN = 3 };
    };
 
 
@@ -113,7 +113,7 @@ namespace sigen {
                  logical_channel_number : 10;
          };
 
-         std::list<LogicalChan> channel_list;
+         LoopList<LogicalChan> channel_list;
       };
 
       //! @}
@@ -28,6 +28,8 @@
 #include "table.h"
 #include "descriptor.h"
 #include "tstream.h"
+#include "bit_layout.h"
+#include "item_writer.h"
 #include "eit.h"
 
 namespace sigen
@@ -40,7 +42,7 @@ namespace sigen
    // adds an event to the passed list...
    // protected function to be used by the derived classes
    //
-   bool EIT::addEvent(std::list<ListItem*>& list, ui16 evid, const UTC& time, const BCDTime& dur, ui8 rs, bool fca)
+   bool EIT::addEvent(ItemList& list, ui16 evid, const UTC& time, const BCDTime& dur, ui8 rs, bool fca)
    {
 #ifdef CHECK_DUPLICATES
       if (contains(list, evid)) {
@@ -59,6 +61,27 @@ namespace sigen
       return true;
    }
 
+   //
+   // adds a batch of events to the passed list
+   //
+   bool EIT::addEvents(ItemList& list, const EventSpec* specs, size_t count)
+   {
+#ifdef CHECK_DUPLICATES
+      checkDuplicates(list, specs, count,
+                      [](const EventSpec& e) { return e.event_id; }, "event with id");
+#endif
+
+      if ( !reserveItems(list, count, Event::BASE_LEN) )
+         return false;
+
+      for (size_t i = 0; i < count; i++) {
+         const EventSpec& e = specs[i];
+         list.push_back(new Event(e.event_id, e.start_time, e.duration,
+                                  e.running_status, e.free_CA_mode));
+      }
+      return true;
+   }
+
 #ifdef ENABLE_DUMP
    //
    // debug
@@ -78,7 +101,7 @@ namespace sigen
    //
    // dumps the passed event list
    //
-   void EIT::dumpEventList(std::ostream &o, const std::list<ListItem*>& list) const
+   void EIT::dumpEventList(std::ostream &o, const ItemList& list) const
    {
       // display the event list
       incOutLevel();
@@ -115,7 +138,7 @@ namespace sigen
    // we call this writeSection() from there and don't have to worry about
    // anybody calling the other one
    //
-   bool EIT::writeSection(Section& section, const std::list<ListItem*>& list,
+   bool EIT::writeSection(Section& section, const ItemList& list,
                           ui8 last_tid, ui8 cur_sec, ui8 last_sec_num, ui8 segm_last_sec_num,
                           ui16& sec_bytes) const
    {
@@ -133,21 +156,14 @@ namespace sigen
               // common data for every section
               // if table's length is > available space, we'll
               // overwrite the section length later on
-              writeSectionHeader(section);
-
-              // section count information
-              section.set08Bits(cur_sec);
-
-              // we don't know the last section number yet, so
-              // for now set it to 0,
-              section.set08Bits(last_sec_num);
-
-              section.set16Bits(xport_stream_id);
-              section.set16Bits(original_network_id);
+              writeSectionHeader(section, cur_sec, last_sec_num);
 
               // standard calls for set values for these on PF
-              section.set08Bits( segm_last_sec_num ); // segment last section num
-              section.set08Bits( last_tid );          // last_table_id
+              BitLayout<16, 16, 8, 8>::write(section,
+                                             xport_stream_id,
+                                             original_network_id,
+                                             segm_last_sec_num, // segment last section num
+                                             last_tid);         // last_table_id
 
               sec_bytes = BASE_LENGTH; // the minimum section size
               run.op_state = (!run.event ? GET_EVENT : WRITE_EVENT);
@@ -193,7 +209,7 @@ namespace sigen
 
            case WRITE_EVENT:
               // try to write it
-              if (!(*run.event).write_section(section, getMaxDataLen(), sec_bytes)) {
+              if (!(*run.event).write_section<Event>(section, getMaxDataLen(), sec_bytes, run.item)) {
                  run.op_state = WRITE_HEAD;
                  exit = true;
                  break;
@@ -211,19 +227,16 @@ namespace sigen
    //
    ui8 EIT::Event::write_header(Section& section) const
    {
-      // write the event data
-      section.set16Bits(id);
-
-      // start utc
-      section.set16Bits(utc.mjd);
-      section.set08Bits(utc.time.getBCDHour());
-      section.set08Bits(utc.time.getBCDMinute());
-      section.set08Bits(utc.time.getBCDSecond());
-
-      // duration
-      section.set08Bits(duration.getBCDHour());
-      section.set08Bits(duration.getBCDMinute());
-      section.set08Bits(duration.getBCDSecond());
+      // event id, start utc and duration
+      BitLayout<16, 16, 8, 8, 8, 8, 8, 8>::write(section,
+                                                 id,
+                                                 utc.mjd,
+                                                 utc.time.getBCDHour(),
+                                                 utc.time.getBCDMinute(),
+                                                 utc.time.getBCDSecond(),
+                                                 duration.getBCDHour(),
+                                                 duration.getBCDMinute(),
+                                                 duration.getBCDSecond());
 
       return EIT::Event::BASE_LEN - 2;
    }
@@ -247,22 +260,38 @@ namespace sigen
    //
    void PF_EIT::buildSections(TStream& strm) const
    {
-      ui16 sec_bytes;
+      BUILD_STAT( BuildStats::Scope stats_scope(build_stats) );
+      newBuild();
 
       // build the present & following sections
-      for (ui8 cur_sec = 0, last_sec = 1; cur_sec <= 1; cur_sec++) {
-         // allocate space for the section (use getMaxSectionLen() to include
-         // room for CRC)
-         Section *s = strm.getNewSection(getMaxSectionLen());
-
-         // write the section
-         writeSection(*s, items[cur_sec], getId(), // id is table_id
-                      cur_sec, last_sec, last_sec, sec_bytes);
-
-         // adjust the length, and calculate the crc
-         s->set16Bits(1, buildLengthData(sec_bytes));
-         s->calcCrc();
-      }
+      for (ui8 cur_sec = 0; cur_sec <= 1; cur_sec++)
+         buildSection(strm, cur_sec, 1);
+   }
+
+   ui16 PF_EIT::startBuild() const
+   {
+      newBuild();
+      BUILD_STAT( build_stats = BuildStats() );
+      return 2;
+   }
+
+   void PF_EIT::buildSection(TStream& strm, ui8 cur_sec, ui8 last_sec) const
+   {
+      ui16 sec_bytes;
+
+      // allocate space for the section (use getMaxSectionLen() to include
+      // room for CRC)
+      Section *s = strm.getNewSection(getMaxSectionLen());
+
+      // write the section
+      writeSection(*s, items[cur_sec], getId(), // id is table_id
+                   cur_sec, last_sec, last_sec, sec_bytes);
+
+      // adjust the length, and calculate the crc
+      s->set16Bits(1, buildLengthData(sec_bytes));
+      s->calcCrc();
+      BUILD_STAT( build_stats.record(*s) );
+      strm.shrinkToFit(*s);
    }
 
 
@@ -24,6 +24,7 @@
 
 #include <memory>
 #include <list>
+#include <vector>
 #include "table.h"
 #include "utc.h"
 
@@ -45,6 +46,18 @@ namespace sigen {
          PID = 0x12                                    //!< Packet PID for transmission.
       };
 
+      /*!
+       * \brief Event entry for batch insertion. Fields are as per the
+       * single event add methods' arguments.
+       */
+      struct EventSpec {
+         ui16 event_id;
+         UTC start_time;
+         BCDTime duration;
+         ui8 running_status;
+         bool free_CA_mode;
+      };
+
       // utility
       virtual void buildSections(TStream& ts) const = 0;
 
@@ -63,7 +76,7 @@ namespace sigen {
       { }
 
       // the private event class
-      struct Event : public ExtPSITable::ListItem {
+      struct Event final : public ExtPSITable::ListItem {
          enum { BASE_LEN = 12 };
 
          // instance variables
@@ -84,7 +97,7 @@ namespace sigen {
          Event() = delete;
 
          virtual ui16 length() const { return 12; }
-         virtual bool equals(ui16 ev_id) const { return ev_id == id; }
+         virtual ui16 key() const { return id; }
 
          // writes item header bytes, returns num bytes written
          virtual ui8 write_header(Section& sec) const;
@@ -97,10 +110,11 @@ namespace sigen {
       ui16 original_network_id;
 
       // event/descriptor add routines
-      bool addEvent(std::list<ListItem*>& list, ui16 id, const UTC& st, const BCDTime& d, ui8 rs, bool fca);
+      bool addEvent(ItemList& list, ui16 id, const UTC& st, const BCDTime& d, ui8 rs, bool fca);
+      bool addEvents(ItemList& list, const EventSpec* specs, size_t count);
 
       // table builder routines
-      bool writeSection(Section& s, const std::list<ListItem*>& list,
+      bool writeSection(Section& s, const ItemList& list,
                         ui8 last_tid,
                         ui8 cur_sec, ui8 last_sec_num, ui8 segm_last_sec_num,
                         ui16& sec_bytes) const;
@@ -108,13 +122,14 @@ namespace sigen {
 #ifdef ENABLE_DUMP
       virtual void dumpHeader(std::ostream& o) const = 0;
       virtual void dumpEvents(std::ostream& o) const = 0;
-      void dumpEventList(std::ostream& o, const std::list<ListItem*>& list) const;
+      void dumpEventList(std::ostream& o, const ItemList& list) const;
 #endif
 
-      // dummy function - we use a different writeSection for EIT's,
-      // but we need this one to satisfy inheritance from PSITable..
-      // this one is never called
+      // dummy functions - we use a different writeSection for EIT's,
+      // but we need these to satisfy inheritance from PSITable..
+      // these are never called
       bool writeSection(Section& s, ui8, ui16& sec_bytes) const { return false; }
+      void planSections(SectionPlan&) const { }
 
    private:
       enum State_t { INIT, WRITE_HEAD, GET_EVENT, WRITE_EVENT };
@@ -123,7 +138,8 @@ namespace sigen {
 
          State_t op_state;
          const ListItem* event;
-         std::list<ListItem*>::const_iterator ev_iter;
+         ItemList::const_iterator ev_iter;
+         ListItem::Context item;
       } run;
    };
 
@@ -136,8 +152,8 @@ namespace sigen {
       enum Type { ACTUAL = 0x4e, OTHER = 0x4f };
 
    private:
-      std::list<ListItem*>& present;
-      std::list<ListItem*>& following;
+      ItemList& present;
+      ItemList& following;
 
    public:
       /*!
@@ -152,6 +168,19 @@ namespace sigen {
                            ui8 running_status, bool free_CA_mode) {
          return addEvent(present, ev_id, start_time, duration, running_status, free_CA_mode);
       }
+      /*!
+       * \brief Add a batch of present events. The length is checked once
+       * for all of them and nothing is added if they don't fit.
+       * \param specs Array of events to add.
+       * \param count Number of entries in specs.
+       */
+      bool addPresentEvents(const EventSpec* specs, size_t count) {
+         return addEvents(present, specs, count);
+      }
+      //! \brief Add a batch of present events. See addPresentEvents(const EventSpec*, size_t).
+      bool addPresentEvents(const std::vector<EventSpec>& specs) {
+         return addEvents(present, specs.data(), specs.size());
+      }
       /*!
        * \brief Add a Descriptor to the last added present event.
        * \param desc Descriptor to add.
@@ -165,6 +194,15 @@ namespace sigen {
       bool addPresentEventDesc(ui16 ev_id, Descriptor& desc) {
          return addItemDesc(present, ev_id, desc);
       }
+      /*!
+       * \brief Construct a Descriptor of type T in the table's storage and
+       * add it to the last added present event.
+       * \param args Arguments forwarded to the T constructor.
+       */
+      template <class T, class... Args>
+      bool emplacePresentEventDesc(Args&&... args) {
+         return emplaceItemDesc<T>(present, std::forward<Args>(args)...);
+      }
       /*!
        * \brief Add a following event.
        * \param ev_id Unique id of the event within the service.
@@ -177,6 +215,19 @@ namespace sigen {
                              ui8 running_status, bool free_CA_mode) {
          return addEvent(following, ev_id, start_time, duration, running_status, free_CA_mode);
       }
+      /*!
+       * \brief Add a batch of following events. The length is checked once
+       * for all of them and nothing is added if they don't fit.
+       * \param specs Array of events to add.
+       * \param count Number of entries in specs.
+       */
+      bool addFollowingEvents(const EventSpec* specs, size_t count) {
+         return addEvents(following, specs, count);
+      }
+      //! \brief Add a batch of following events. See addFollowingEvents(const EventSpec*, size_t).
+      bool addFollowingEvents(const std::vector<EventSpec>& specs) {
+         return addEvents(following, specs.data(), specs.size());
+      }
       /*!
        * \brief Add a Descriptor to the last added following event.
        * \param desc Descriptor to add.
@@ -190,11 +241,24 @@ namespace sigen {
       bool addFollowingEventDesc(ui16 ev_id, Descriptor& desc) {
          return addItemDesc(following, ev_id, desc);
       }
+      /*!
+       * \brief Construct a Descriptor of type T in the table's storage and
+       * add it to the last added following event.
+       * \param args Arguments forwarded to the T constructor.
+       */
+      template <class T, class... Args>
+      bool emplaceFollowingEventDesc(Args&&... args) {
+         return emplaceItemDesc<T>(following, std::forward<Args>(args)...);
+      }
 
       // top-level table builder
       void buildSections(TStream& ts) const;
 
    protected:
+      // always two sections: present and following
+      virtual ui16 startBuild() const;
+      virtual void buildSection(TStream& strm, ui8 sec_num, ui8 last_sec_num) const;
+
       // protected constructor
       PF_EIT(ui16 sid, ui16 xsid, ui16 onid, PF_EIT::Type type, ui8 ver,
              bool cni = true)
@@ -84,29 +84,16 @@ namespace sigen
    bool ContentDesc::addContent(ui8 nl1, ui8 nl2, ui8 un1, ui8 un2)
    {
       // check if we can add another to the loop
-      if ( !incLength( Content::BASE_LEN ) )
+      if ( !incLength( CONTENT_LEN ) )
          return false;
 
-      // create an entry and add it
-      content_list.emplace_back(nl1, nl2, un1, un2);
+      // write the entry to the payload
+      put08( ((nl1 & 0x0f) << 4) | (nl2 & 0x0f) );
+      put08( ((un1 & 0x0f) << 4) | (un2 & 0x0f) );
       return true;
    }
 
 
-   //
-   // write the binary data
-   //
-   void ContentDesc::buildSections(Section &s) const
-   {
-      Descriptor::buildSections(s);
-
-      for (const auto &content : content_list) {
-         s.set08Bits( (content.nibble_level_1 << 4) | content.nibble_level_2 );
-         s.set08Bits( (content.user_nibble_1 << 4) | content.user_nibble_2 );
-      }
-   }
-
-
 #ifdef ENABLE_DUMP
    //
    // debug
@@ -115,11 +102,12 @@ namespace sigen
       dumpHeader(o, CONTENT_D_S);
 
       incOutLevel();
-      for (const auto &content : content_list) {
-         identStr(o, CONTENT_NL_1, content.nibble_level_1);
-         identStr(o, CONTENT_NL_2, content.nibble_level_2);
-         identStr(o, USER_NL_1, content.user_nibble_1);
-         identStr(o, USER_NL_2, content.user_nibble_2);
+      const ui8 *d = payloadData();
+      for (ui16 i = 0; i < payloadLength(); i += CONTENT_LEN) {
+         identStr(o, CONTENT_NL_1, static_cast<ui8>(d[i] >> 4));
+         identStr(o, CONTENT_NL_2, static_cast<ui8>(d[i] & 0x0f));
+         identStr(o, USER_NL_1, static_cast<ui8>(d[i + 1] >> 4));
+         identStr(o, USER_NL_2, static_cast<ui8>(d[i + 1] & 0x0f));
       }
       decOutLevel();
    }
@@ -260,27 +248,16 @@ namespace sigen
    bool ParentalRatingDesc::addRating(const std::string &code, ui8 rating)
    {
       // can we add it?
-      if ( !incLength( Rating::BASE_LEN ) )
+      if ( !incLength( RATING_LEN ) )
          return false;
 
       // add it
-      rating_list.emplace_back(code, rating);
+      put( LanguageCode(code) );
+      put08( rating );
       return true;
    }
 
 
-   //
-   // builds the section data
-   void ParentalRatingDesc::buildSections(Section &s) const
-   {
-      Descriptor::buildSections(s);
-
-      for (const auto &rating : rating_list) {
-         s.setBits( rating.country_code );
-         s.set08Bits( rating.value );
-      }
-   }
-
 #ifdef ENABLE_DUMP
    //
    // debug
@@ -289,9 +266,11 @@ namespace sigen
       dumpHeader(o, PARENTAL_RATING_D_S);
 
       incOutLevel();
-      for (const auto &rating : rating_list) {
-         identStr(o, CODE_S, rating.country_code);
-         identStr(o, RATING_S, static_cast<ui16>(rating.value));
+      const ui8 *d = payloadData();
+      for (ui16 i = 0; i < payloadLength(); i += RATING_LEN) {
+         identStr(o, CODE_S, LanguageCode(std::string(reinterpret_cast<const char *>(d + i),
+                                                       LanguageCode::ISO_639_2_CODE_LENGTH)));
+         identStr(o, RATING_S, static_cast<ui16>(d[i + 3]));
       }
       decOutLevel();
    }
@@ -307,8 +286,8 @@ namespace sigen
    {
       Descriptor::buildSections(s);
 
-      s.setBits( rbits(0xf00000) |
-                 programme_identification_label );
+      s.set24Bits( rbits(0xf00000) |
+                   programme_identification_label );
    }
 
 #ifdef ENABLE_DUMP
@@ -327,27 +306,11 @@ namespace sigen
    // ---------------------------------------
    ShortEventDesc::ShortEventDesc(const std::string &code, const std::string &ev_name,
                                   const std::string &ev_text) :
-      Descriptor(TAG, 5),
-      language_code(code), name( incLength(ev_name) ),
-      text( incLength(ev_text) )
+      InlineDataDesc(TAG, 5)
    {
-   }
-
-
-   //
-   // build the secion data
-   //
-   void ShortEventDesc::buildSections(Section &s) const
-   {
-      Descriptor::buildSections(s);
-
-      s.setBits( language_code );
-
-      s.set08Bits( name.length() );
-      s.setBits( name );
-
-      s.set08Bits( text.length() );
-      s.setBits( text );
+      put( LanguageCode(code) );
+      putString( ev_name );
+      putString( ev_text );
    }
 
 
@@ -358,11 +321,15 @@ namespace sigen
    {
       dumpHeader(o, SHORT_EVENT_D_S);
 
-      identStr(o, CODE_S, language_code);
-      identStr(o, EVENT_NAME_LEN_S, name.length());
-      identStr(o, EVENT_NAME_S, name);
-      identStr(o, TEXT_LEN_S, text.length());
-      identStr(o, TEXT_S, text);
+      const char *d = reinterpret_cast<const char *>(payloadData());
+      ui8 name_len = d[3];
+      ui8 text_len = d[4 + name_len];
+
+      identStr(o, CODE_S, LanguageCode(std::string(d, LanguageCode::ISO_639_2_CODE_LENGTH)));
+      identStr(o, EVENT_NAME_LEN_S, name_len);
+      identStr(o, EVENT_NAME_S, std::string(d + 4, name_len));
+      identStr(o, TEXT_LEN_S, text_len);
+      identStr(o, TEXT_S, std::string(d + 5 + name_len, text_len));
    }
 #endif
 
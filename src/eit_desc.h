@@ -63,40 +63,25 @@ namespace sigen {
    // ---------------------------
    // Content Descriptor
    //
-   class ContentDesc : public Descriptor
+   class ContentDesc : public InlineDataDesc
    {
    public:
       enum { TAG = 0x54 };
 
       // constructor
-      ContentDesc() : Descriptor(TAG) { }
+      ContentDesc() : InlineDataDesc(TAG) { }
 
       // utility
       bool addContent(ui8 nl1, ui8 nl2, ui8 un1, ui8 un2);
-      virtual void buildSections(Section&) const;
 
 #ifdef ENABLE_DUMP
       virtual void dump(std::ostream&) const;
 #endif
 
    private:
-      // content data struct
-      struct Content : public STable::ListItem {
-         enum { BASE_LEN = 2 };
-
-         ui8 nibble_level_1 : 4,
-            nibble_level_2 : 4,
-            user_nibble_1 : 4,
-            user_nibble_2 : 4;
-
-         // constructor
-         Content(ui8 nl1, ui8 nl2, ui8 un1, ui8 un2) :
-            nibble_level_1(nl1), nibble_level_2(nl2),
-            user_nibble_1(un1), user_nibble_2(un2) { }
-         Content() = delete;
-      };
-
-      std::list<Content> content_list;
+      // each content entry is 2 bytes:
+      // nibble_level_1 : 4, nibble_level_2 : 4, user_nibble_1 : 4, user_nibble_2 : 4
+      enum { CONTENT_LEN = 2 };
    };
 
 
@@ -152,7 +137,7 @@ namespace sigen {
       };
 
       // descriptor data begins here
-      std::list<std::unique_ptr<Item> > item_list;
+      LoopList<std::unique_ptr<Item> > item_list;
       LanguageCode language_code;
       std::string text;
       ui8 descriptor_number : 4,
@@ -197,38 +182,24 @@ namespace sigen {
    // ---------------------------
    // Parental Rating Descriptor
    //
-   class ParentalRatingDesc : public Descriptor
+   class ParentalRatingDesc : public InlineDataDesc
    {
    public:
       enum { TAG = 0x55 };
 
       // constructor
-      ParentalRatingDesc() : Descriptor(TAG) { }
+      ParentalRatingDesc() : InlineDataDesc(TAG) { }
 
       // utility
       bool addRating(const std::string& code, ui8 r);
-      virtual void buildSections(Section&) const;
 
 #ifdef ENABLE_DUMP
       virtual void dump(std::ostream&) const;
 #endif
 
    private:
-      // rating data struct
-      struct Rating : public STable::ListItem {
-         enum { BASE_LEN = 4 };
-
-         LanguageCode country_code;
-         ui8 value;
-
-         // constructor
-         Rating(const std::string& code, ui8 r) :
-            country_code(code), value(r) { }
-         Rating() = delete;
-      };
-
-      // descriptor data beings here
-      std::list<Rating> rating_list;
+      // each rating entry is a 3-byte country code + 1-byte rating
+      enum { RATING_LEN = 4 };
    };
 
 
@@ -264,7 +235,7 @@ namespace sigen {
    // ---------------------------
    // Short Event Descriptor
    //
-   class ShortEventDesc : public Descriptor
+   class ShortEventDesc : public InlineDataDesc
    {
    public:
       enum { TAG = 0x4d };
@@ -274,17 +245,9 @@ namespace sigen {
                      const std::string& text);
       ShortEventDesc() = delete;
 
-      // utility
-      virtual void buildSections(Section&) const;
-
 #ifdef ENABLE_DUMP
       virtual void dump(std::ostream&) const;
 #endif
-
-   private:
-      LanguageCode language_code;
-      std::string name;
-      std::string text;
    };
 
 
@@ -0,0 +1,141 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// item_writer.h: the ExtPSITable item writer, templated on the item
+// type so tables with final item types avoid virtual calls per item.
+// Internal - only included by the table sources
+// -----------------------------------
+
+#pragma once
+
+#include "table.h"
+#include "descriptor.h"
+#include "tstream.h"
+
+namespace sigen {
+
+   //
+   // write section data for the item
+   template <class Item>
+   bool ExtPSITable::ListItem::write_section(Section& section, ui16 max_data_len,
+                                             ui16& sec_bytes, Context& run,
+                                             ui16* loop_len_ptr) const
+   {
+      ui8 header_len;
+      ui8* desc_loop_len_pos = 0;
+      ui16 d_len, desc_loop_len = 0;
+      bool exit = false, done = false;
+
+      // calls through item are resolved statically when Item is final
+      const Item* item = static_cast<const Item*>(this);
+
+      while (!exit)
+      {
+         switch (run.op_state)
+         {
+           case INIT:
+              // set the descriptor iterator
+              run.d_iter = descriptors.begin();
+              run.op_state = WRITE_HEAD;
+
+           case WRITE_HEAD:
+              header_len = item->write_header(section) + 2;
+              BUILD_STAT( section.countItem() );
+
+              // save the position for the desc loop len.. we'll update it later
+              desc_loop_len_pos = section.getCurDataPosition();
+              section.set16Bits( 0 );
+
+              // increment the byte count
+              sec_bytes += header_len;
+              if (loop_len_ptr)
+                 *loop_len_ptr += header_len;
+
+              run.op_state = (!run.d ? GET_DESC : WRITE_DESC);
+              break;
+
+           case GET_DESC:
+              // if we have descriptors available..
+              if (run.d_iter != descriptors.end()) {
+                 run.d = (*run.d_iter++).get();
+
+                 // make sure we can fit the next one
+                 if ( (sec_bytes + run.d->length()) > max_data_len ) {
+                    run.op_state = WRITE_HEAD;
+                    exit = true;
+                    break;
+                 }
+                 run.op_state = WRITE_DESC;
+              }
+              else {
+                 // no more descriptors.. done writing this xport stream,
+                 run = Context();
+                 exit = done = true;
+                 break;
+              }
+              break;
+
+           case WRITE_DESC:
+              run.d->encode(section);
+
+              // increment all byte counts
+              d_len = run.d->length();
+              sec_bytes += d_len;
+              if (loop_len_ptr)
+                 *loop_len_ptr += d_len;
+              desc_loop_len += d_len;
+
+              // try to get another one
+              run.op_state = GET_DESC;
+              break;
+         }
+      }
+      // write the desc loop length
+      item->write_desc_loop_len(section, desc_loop_len_pos, desc_loop_len);
+
+      return done;
+   }
+
+   //
+   // the item is started in a new section unless its header and first
+   // descriptor fit, and continued in the next one (with its header
+   // repeated) at the first descriptor that doesn't
+   inline void ExtPSITable::ListItem::plan_section(SectionPlanner& p, size_t index) const
+   {
+      ui16 head = length(), total = head + descriptors.loop_length();
+      p.atItem(index);
+      if (p.fits(total)) {
+         p.put(total);
+         return;
+      }
+
+      if (!p.fits(head + (descriptors.empty() ? 0 : descriptors.front()->length())))
+         p.next();
+      p.put(head);
+      for (auto d = descriptors.begin(); d != descriptors.end(); ++d) {
+         if (!p.fits((*d)->length())) {
+            p.atItemDesc(d);
+            p.next();
+            p.put(head);
+         }
+         p.put((*d)->length());
+      }
+   }
+
+} // namespace
@@ -110,7 +110,7 @@ namespace sigen {
       network_id(net_id),
       initial_service_id(init_serv_id)
    {
-      incLength(3);
+      incLength(1); // hand_over_type | reserved | origin_type
 
       if (hand_over_type != MobileHandoverLinkageDesc::HO_RESERVED)
          incLength( sizeof(network_id) );
@@ -190,30 +190,16 @@ namespace sigen
    bool ISO639LanguageDesc::addLanguage(const LanguageCode& code, ui8 audio_type)
    {
       // check if we can fit it
-      if ( !incLength( Language::BASE_LEN ) )
+      if ( !incLength( LANGUAGE_LEN ) )
          return false;
 
-      // add it to the list (passing the string invokes the LanguageCode
-      // single-arg convert constructor automatically)
-      language_list.emplace_back(code, audio_type);
+      // append it to the payload
+      put( code );
+      put08( audio_type );
       return true;
    }
 
 
-   //
-   // writes to the stream
-   void ISO639LanguageDesc::buildSections(Section &s) const
-   {
-      Descriptor::buildSections(s);
-
-      // write the language codes
-      for (const auto& lang : language_list) {
-         s.setBits( lang.code );
-         s.set08Bits( lang.audio_type );
-      }
-   }
-
-
 #ifdef ENABLE_DUMP
    //
    //
@@ -222,9 +208,11 @@ namespace sigen
       dumpHeader(o, ISO_639_LANG_D_S);
 
       incOutLevel();
-      for (const auto& lang : language_list) {
-         identStr(o, LANGUAGE_CODE_S, lang.code);
-         identStr(o, AUDIO_TYPE_S, lang.audio_type);
+      const ui8 *d = payloadData();
+      for (ui16 i = 0; i < payloadLength(); i += LANGUAGE_LEN) {
+         identStr(o, LANGUAGE_CODE_S, LanguageCode(std::string(reinterpret_cast<const char *>(d + i),
+                                                               LanguageCode::ISO_639_2_CODE_LENGTH)));
+         identStr(o, AUDIO_TYPE_S, d[i + 3]);
       }
       decOutLevel();
    }
@@ -252,7 +252,7 @@ namespace sigen {
    /*!
     * \brief ISO 639 Language Descriptor - ISO/IEC 13818-1 (1996).
     */
-   class ISO639LanguageDesc : public Descriptor
+   class ISO639LanguageDesc : public InlineDataDesc
    {
    public:
       enum { TAG = 10 };
@@ -268,7 +268,7 @@ namespace sigen {
       };
 
       //! \brief Constructor.
-      ISO639LanguageDesc() : Descriptor(TAG) {}
+      ISO639LanguageDesc() : InlineDataDesc(TAG) {}
 
       /*!
        * \brief Add a language to the descriptor loop.
@@ -277,24 +277,13 @@ namespace sigen {
        */
       bool addLanguage(const LanguageCode& code, ui8 audio_type);
 
-      virtual void buildSections(Section&) const;
-
 #ifdef ENABLE_DUMP
       virtual void dump(std::ostream&) const;
 #endif
 
    private:
-      struct Language : public STable::ListItem {
-         enum { BASE_LEN = LanguageCode::ISO_639_2_CODE_LENGTH + 1 };
-
-         LanguageCode code;
-         ui8 audio_type;
-
-         Language( const LanguageCode& lc, ui8 at ) : code(lc), audio_type(at) { }
-         Language() = delete;
-      };
-
-      std::list<Language> language_list;
+      // each entry is the 3-byte code + 1-byte audio type
+      enum { LANGUAGE_LEN = LanguageCode::ISO_639_2_CODE_LENGTH + 1 };
    };
 
    /*!
@@ -30,6 +30,7 @@
 #include "descriptor.h"
 #include "util_desc.h"
 #include "tstream.h"
+#include "item_writer.h"
 #include "nit_bat.h"
 
 namespace sigen
@@ -71,11 +72,75 @@ namespace sigen
       return true;
    }
 
+   //
+   // adds a batch of transport stream entries
+   //
+   bool NIT_BAT::addXportStreams(const XportStreamSpec* specs, size_t count)
+   {
+#ifdef CHECK_DUPLICATES
+      checkDuplicates(xs_list, specs, count,
+                      [](const XportStreamSpec& s) { return s.xport_stream_id; },
+                      "transport stream with id");
+#endif
+
+      if ( !reserveItems(xs_list, count, XportStream::BASE_LEN) )
+         return false;
+
+      for (size_t i = 0; i < count; i++)
+         xs_list.push_back(new XportStream(specs[i].xport_stream_id, specs[i].original_network_id));
+      return true;
+   }
+
+   //
+   // the sections writeSection() will produce
+   void NIT_BAT::planSections(SectionPlan& plan) const
+   {
+      SectionPlanner p(plan, BASE_LENGTH, getMaxDataLen(), descriptors.begin());
+      for (auto d = descriptors.begin(); d != descriptors.end(); ++d) {
+         // a section end mark is not written, only breaks the section
+         if ((*d)->type() == UtilityDesc::SECTION_END_MARK) {
+            p.atDesc(std::next(d));
+            p.next();
+         }
+         else {
+            p.atDesc(d);
+            p.add((*d)->length());
+         }
+      }
+      p.atDesc(descriptors.end());
+      planItems(p, xs_list);
+      p.finish();
+   }
+
+   //
+   // a writer with its own context, from a planned section on
+   PSITable::SectionWriter NIT_BAT::sectionWriter(const SectionStart& at) const
+   {
+      Context start;
+      start.op_state = WRITE_HEAD;
+      start.nd_iter = at.desc;
+      start.ts_iter = writeOrder(xs_list).begin() + at.item;
+      if (at.split) {
+         start.ts = *start.ts_iter++;
+         start.item = ListItem::Context(at.item_desc);
+      }
+
+      return [this, start](Section& s, ui8 cur_sec, ui16& sec_bytes) mutable {
+         return writeSection(s, cur_sec, sec_bytes, start);
+      };
+   }
+
+
+   bool NIT_BAT::writeSection(Section& section, ui8 cur_sec, ui16& sec_bytes) const
+   {
+      return writeSection(section, cur_sec, sec_bytes, run);
+   }
+
    //
    // handles writing the data to the stream. return true if the table
    // is done (all sections are completed)
    //
-   bool NIT_BAT::writeSection(Section& section, ui8 cur_sec, ui16& sec_bytes) const
+   bool NIT_BAT::writeSection(Section& section, ui8 cur_sec, ui16& sec_bytes, Context& run) const
    {
       ui8 *nd_loop_len_pos = 0, *ts_loop_len_pos = 0;
       ui16 d_len, net_desc_len = 0, ts_loop_len = 0;
@@ -89,21 +154,16 @@ namespace sigen
               // associate the iterators to the lists.. once they reach the
               // end, they'll take care to reset themselves
               run.nd_iter = descriptors.begin();
-              run.ts_iter = xs_list.begin();
+              run.ts_iter = writeOrder(xs_list).begin();
               run.op_state = WRITE_HEAD;
 
            case WRITE_HEAD:
               // common data for every section
               // if table's length is > max_section_len, we'll
               // overwrite the section length later on
-              writeSectionHeader(section);
-
-              // section count information
-              section.set08Bits(cur_sec);
-
-              // we don't know the last section number yet, so
-              // for now set it to 0,
-              section.set08Bits(0);//last_sec_num);
+              // section count information. We don't know the last section
+              // number yet, so for now set it to 0
+              writeSectionHeader(section, cur_sec, 0);
 
               // save the position for the descriptors_loop_len
               nd_loop_len_pos = section.getCurDataPosition();
@@ -132,7 +192,7 @@ namespace sigen
                     // either a forced break or we can't fit the
                     // descriptor in this section
                     if (run.nd->type() == UtilityDesc::SECTION_END_MARK ||
-                        (sec_bytes + run.nd->length() > getMaxDataLen())) {
+                        (sec_bytes + run.nd->length() > getPlannedDataLen(cur_sec))) {
                        // if the section is filled with net
                        // descriptors, we must sitll write an empty XS
                        // loop length!
@@ -169,7 +229,7 @@ namespace sigen
 
            case WRITE_NET_DESC:
               // add the network descriptor
-              run.nd->buildSections(section);
+              run.nd->encode(section);
 
               d_len = run.nd->length();
               sec_bytes += d_len;
@@ -194,7 +254,7 @@ namespace sigen
            case GET_XPORT_STREAM:
 
               // fetch a transport stream
-              if (run.ts_iter != xs_list.end()) {
+              if (run.ts_iter != writeOrder(xs_list).end()) {
                  run.ts = *(run.ts_iter++);
 
                  // first, check if it has any descriptors.. we'll try to fit
@@ -202,7 +262,7 @@ namespace sigen
                  if (!run.ts->descriptors.empty()) {
                     // check the size with the descriptor
                     if ( (sec_bytes + XportStream::BASE_LEN + run.ts->descriptors.front()->length()) >
-                         getMaxDataLen() ) {
+                         getPlannedDataLen(cur_sec) ) {
                        // won't fit.. wait until the next section
                        run.op_state = WRITE_HEAD;
                        exit = true;
@@ -211,7 +271,7 @@ namespace sigen
                  }
                  else {
                     // check if this XS with no descs will fit here
-                    if ( (sec_bytes + XportStream::BASE_LEN) > getMaxDataLen() ) {
+                    if ( (sec_bytes + XportStream::BASE_LEN) > getPlannedDataLen(cur_sec) ) {
                        // nope.. wait also
                        run.op_state = WRITE_HEAD;
                        exit = true;
@@ -232,7 +292,7 @@ namespace sigen
 
            case WRITE_XPORT_STREAM:
               // finally write it
-              if (!(*run.ts).write_section(section, getMaxDataLen(), sec_bytes, &ts_loop_len)) {
+              if (!(*run.ts).write_section<XportStream>(section, getPlannedDataLen(cur_sec), sec_bytes, run.item, &ts_loop_len)) {
                  run.op_state = WRITE_HEAD;
                  exit = true;
                  break;
@@ -24,6 +24,7 @@
 
 #include <memory>
 #include <list>
+#include <vector>
 #include "table.h"
 
 namespace sigen {
@@ -50,6 +51,15 @@ namespace sigen {
       // classes as addNetworkDesc() and addBouquetDesc()
       // respectively.
       bool addDesc(Descriptor &);
+      // as addDesc() but constructs the descriptor in the table's
+      // storage. Aliased as emplaceNetworkDesc() and
+      // emplaceBouquetDesc()
+      template <class T, class... Args>
+      bool emplaceDesc(Args&&... args) {
+         return emplaceWith<T>(descriptors.resource(),
+                               [this](Descriptor& d) { return addDesc(d); },
+                               std::forward<Args>(args)...);
+      }
 
       /*!
        * \brief Add a transport stream to table.
@@ -57,6 +67,27 @@ namespace sigen {
        * \param on_id Id of the originating network.
        */
       bool addXportStream(ui16 xs_id, ui16 on_id);
+
+      /*!
+       * \brief Transport stream entry for batch insertion with
+       * addXportStreams().
+       */
+      struct XportStreamSpec {
+         ui16 xport_stream_id;       //!< Unique id of the transport stream.
+         ui16 original_network_id;   //!< Id of the originating network.
+      };
+      /*!
+       * \brief Add a batch of transport streams. The length is
+       * checked once for all of them and nothing is added if they
+       * don't fit.
+       * \param specs Array of transport streams to add.
+       * \param count Number of entries in specs.
+       */
+      bool addXportStreams(const XportStreamSpec* specs, size_t count);
+      //! \brief Add a batch of transport streams. See addXportStreams(const XportStreamSpec*, size_t).
+      bool addXportStreams(const std::vector<XportStreamSpec>& specs) {
+         return addXportStreams(specs.data(), specs.size());
+      }
       /*!
        * \brief Add a Descriptor to last added transport stream.
        * \param desc Descriptor to add.
@@ -68,12 +99,25 @@ namespace sigen {
        * \param desc Descriptor to add.
        */
       bool addXportStreamDesc(ui16 xs_id, Descriptor& desc) { return addItemDesc(xs_list, xs_id, desc); }
+      /*!
+       * \brief Construct a Descriptor of type T in the table's storage and
+       * add it to the last added transport stream.
+       * \param args Arguments forwarded to the T constructor.
+       */
+      template <class T, class... Args>
+      bool emplaceXportStreamDesc(Args&&... args) {
+         return emplaceItemDesc<T>(xs_list, std::forward<Args>(args)...);
+      }
 
       [[deprecated("replaced by addXportStreamDesc(xs_id, Descriptor&)")]]
       bool addXportStreamDesc(ui16 xs_id, ui16 on_id, Descriptor& desc) {
          return addXportStreamDesc(xs_id, desc);
       }
 
+      //! \brief See ExtPSITable::setPacking().
+      using ExtPSITable::setPacking;
+      using ExtPSITable::getPacking;
+
 #ifdef ENABLE_DUMP
       virtual void dump(std::ostream &) const;
 #endif
@@ -82,7 +126,7 @@ namespace sigen {
       enum { MAX_SEC_LEN = 1024 };
 
       // the transport stream struct - public as the BAT uses it too
-      struct XportStream : public ExtPSITable::ListItem
+      struct XportStream final : public ExtPSITable::ListItem
       {
          enum { BASE_LEN = 6 };
 
@@ -95,7 +139,7 @@ namespace sigen {
          XportStream() = delete;
 
          virtual ui16 length() const { return 6; }
-         virtual bool equals(ui16 tsid) const { return (tsid == id); }
+         virtual ui16 key() const { return id; }
 
          // writes item header bytes, returns num bytes written
          virtual ui8 write_header(Section& sec) const;
@@ -103,10 +147,12 @@ namespace sigen {
 
       // NIT members
       DescList descriptors;
-      std::list<ListItem*>& xs_list;
+      ItemList& xs_list;
 
       // private methods
       virtual bool writeSection(Section& , ui8, ui16 &) const;
+      virtual void planSections(SectionPlan&) const;
+      virtual SectionWriter sectionWriter(const SectionStart&) const;
 
 #ifdef ENABLE_DUMP
       void dumpXportStreams(std::ostream &) const;
@@ -115,7 +161,7 @@ namespace sigen {
       // section building state tracking
       enum State_t { INIT, WRITE_HEAD, GET_NET_DESC, WRITE_NET_DESC, WRITE_XPORT_LOOP_LEN,
                      GET_XPORT_STREAM, WRITE_XPORT_STREAM };
-      mutable struct Context {
+      struct Context {
          Context() :
             nd_done(false), op_state(INIT), nd(nullptr), ts(nullptr)
          {}
@@ -124,10 +170,14 @@ namespace sigen {
          State_t op_state;
 
          const Descriptor *nd;
-         std::list<std::unique_ptr<Descriptor> >::const_iterator nd_iter;
+         DescList::const_iterator nd_iter;
          const ListItem *ts;
-         std::list<ListItem*>::const_iterator ts_iter;
-      } run;
+         ItemList::const_iterator ts_iter;
+         ListItem::Context item;
+      };
+      mutable Context run;
+
+      bool writeSection(Section&, ui8, ui16 &, Context& run) const;
 
    protected:
       // protected constructor - type refers to ACTUAL or OTHER,
@@ -152,6 +202,15 @@ namespace sigen {
        * \param desc Descriptor to add.
        */
       bool addNetworkDesc(Descriptor& desc) { return addDesc(desc); }
+      /*!
+       * \brief Construct a Descriptor of type T in the table's storage and
+       * add it to the Network Descriptors loop.
+       * \param args Arguments forwarded to the T constructor.
+       */
+      template <class T, class... Args>
+      bool emplaceNetworkDesc(Args&&... args) {
+         return emplaceDesc<T>(std::forward<Args>(args)...);
+      }
 
    protected:
       // protected constructor - type refers to ACTUAL or OTHER,
@@ -226,6 +285,15 @@ namespace sigen {
        * \param desc Descriptor to add.
        */
       bool addBouquetDesc(Descriptor& desc) { return addDesc(desc); }
+      /*!
+       * \brief Construct a Descriptor of type T in the table's storage and
+       * add it to the Bouquet Descriptors loop.
+       * \param args Arguments forwarded to the T constructor.
+       */
+      template <class T, class... Args>
+      bool emplaceBouquetDesc(Args&&... args) {
+         return emplaceDesc<T>(std::forward<Args>(args)...);
+      }
    };
 
    //! @}
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include "descriptor.h"
 #include "tstream.h"
+#include "bit_layout.h"
 #include "nit_desc.h"
 
 namespace sigen
@@ -110,10 +111,10 @@ namespace sigen
    {
       Descriptor::buildSections(s);
 
-      s.set32Bits( frequency );
-      s.set16Bits( 0xfff0 | fec_outer );
-      s.set08Bits( modulation );
-      s.set32Bits( (symbol_rate << 4) | fec_inner );
+      // frequency, reserved_future_use, FEC_outer, modulation,
+      // symbol_rate, FEC_inner
+      BitLayout<32, 12, 4, 8, 28, 4>::write(s, frequency, 0xfff, fec_outer,
+                                            modulation, symbol_rate, fec_inner);
    }
 
 
@@ -372,14 +373,16 @@ namespace sigen
    {
       Descriptor::buildSections(s);
 
-      s.set32Bits( frequency );
-      s.set16Bits( orbital_position );
-      s.set08Bits( (west_east << 7) |
-                   (polarisation << 5) |
-                   (roll_off << 3) |
-                   (modulation_system << 2) |
-                   (modulation_type) );
-      s.set32Bits( (symbol_rate << 4) | fec_inner );
+      BitLayout<32, 16, 1, 2, 2, 1, 2, 28, 4>::write(s,
+                                                     frequency,
+                                                     orbital_position,
+                                                     west_east,
+                                                     polarisation,
+                                                     roll_off,
+                                                     modulation_system,
+                                                     modulation_type,
+                                                     symbol_rate,
+                                                     fec_inner);
    }
 
 
@@ -412,21 +415,21 @@ namespace sigen
    {
       Descriptor::buildSections(s);
 
-      s.set32Bits( ctr_frequency );
-      s.set08Bits( (bandwidth << 5) |
-                   (priority << 4) |
-                   (time_slicing_indicator << 3) |
-                   (MPE_FEC_indicator << 2) |
-                   rbits(0x3) );
-      s.set08Bits( (constellation << 6) |
-                   (hierarchy_info << 3) |
-                   cr_HP_stream );
-      s.set08Bits( (cr_LP_stream << 5) |
-                   (guard_interval << 3) |
-                   (transmission_mode << 1) |
-                   other_freq_flag );
-
-      s.set32Bits( rbits(0xffffffff) );
+      BitLayout<32, 3, 1, 1, 1, 2, 2, 3, 3, 3, 2, 2, 1, 32>::write(s,
+                                                                  ctr_frequency,
+                                                                  bandwidth,
+                                                                  priority,
+                                                                  time_slicing_indicator,
+                                                                  MPE_FEC_indicator,
+                                                                  rbits(0x3),
+                                                                  constellation,
+                                                                  hierarchy_info,
+                                                                  cr_HP_stream,
+                                                                  cr_LP_stream,
+                                                                  guard_interval,
+                                                                  transmission_mode,
+                                                                  other_freq_flag,
+                                                                  rbits(0xffffffff));
    }
 
 
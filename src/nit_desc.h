@@ -363,7 +363,7 @@ namespace sigen {
 
       // descriptor data members
       ui16 announcement_support_indicator;
-      std::list<Announcement> announcement_list;
+      LoopList<Announcement> announcement_list;
    };
 
 
@@ -433,7 +433,7 @@ namespace sigen {
 
          ui16 cell_id;
          ui32 frequency;
-         std::list<SubCell> subcell_list;
+         LoopList<SubCell> subcell_list;
 
          // constructor
          Link(ui16 c_id, ui32 freq) :
@@ -446,7 +446,7 @@ namespace sigen {
       };
 
       // descriptor data members
-      std::list<Link> cflink_list;
+      LoopList<Link> cflink_list;
 
    protected:
       bool add_subcell(Link& l, ui8 cid_ext, ui32 xposer_freq);
@@ -543,7 +543,7 @@ namespace sigen {
          ui32 extend_of_latitude : 12,
               extend_of_longitude : 12;
 
-         std::list<SubCell> subcell_list;
+         LoopList<SubCell> subcell_list;
 
          // constructor
          Cell(ui16 c_id, ui16 lat, ui16 lon, ui16 ext_lat, ui16 ext_lon) :
@@ -559,7 +559,7 @@ namespace sigen {
       };
 
       // descriptor data members
-      std::list<Cell> cell_list;
+      LoopList<Cell> cell_list;
 
    protected:
       bool add_subcell(Cell& cell, ui8 cid_ext, ui16 sc_lat, ui16 sc_lon,
@@ -609,7 +609,7 @@ namespace sigen {
 #endif
 
    private:
-      std::list<ui32> frequency_list;
+      LoopList<ui32> frequency_list;
       ui8 coding_type : 2;
    };
 
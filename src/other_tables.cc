@@ -53,6 +53,8 @@ namespace sigen
    // table builder function
    void RST::buildSections(TStream& strm) const
    {
+      BUILD_STAT( BuildStats::Scope stats_scope(build_stats) );
+      newBuild();
       Section *s = strm.getNewSection( getMaxSectionLen() );
 
       STable::buildSections(*s);
@@ -64,7 +66,10 @@ namespace sigen
          s->set16Bits(xs.service_id);
          s->set16Bits(xs.event_id);
          s->set08Bits( rbits(0xf8) | (xs.running_status & 0x7) );
+         BUILD_STAT( s->countItem() );
       }
+      BUILD_STAT( build_stats.record(*s) );
+      strm.shrinkToFit(*s);
    }
 
 
@@ -112,11 +117,15 @@ namespace sigen
    //
    void Stuffing::buildSections(TStream& strm) const
    {
+      BUILD_STAT( BuildStats::Scope stats_scope(build_stats) );
+      newBuild();
       Section *s = strm.getNewSection( getMaxSectionLen() );
 
       STable::buildSections(*s);
 
       s->setBits( data );
+      BUILD_STAT( build_stats.record(*s) );
+      strm.shrinkToFit(*s);
    }
 
 
@@ -91,7 +91,7 @@ namespace sigen {
       };
 
       // the list of transport streams
-      std::list<XportStream> xport_stream_list;
+      TrackedList<XportStream, AllocKind::TABLE_ITEM> xport_stream_list;
    };
 
 
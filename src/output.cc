@@ -0,0 +1,81 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// output.cc: destinations for section and TS packet data
+// -----------------------------------
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "output.h"
+#include "tstream.h"
+
+namespace sigen
+{
+   //
+   // writes each section in turn
+   //
+   bool OutputSink::write(const TStream &t)
+   {
+      for (const TStream::SectionPtr &s : t.section_list) {
+         if (!write(s->getBinaryData(), s->length()))
+            return false;
+      }
+      return true;
+   }
+
+
+   // --------------------------------
+   // file descriptor sink
+   //
+   FdSink::FdSink(const std::string &file_name) :
+      fd( ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) ),
+      owned(true)
+   {
+   }
+
+   FdSink::~FdSink()
+   {
+      if (owned && fd >= 0)
+         ::close(fd);
+   }
+
+   //
+   // writes all the data, resuming short writes
+   //
+   bool FdSink::write(const ui8 *data, std::size_t len)
+   {
+      while (len > 0) {
+         ssize_t w = ::write(fd, data, len);
+         if (w < 0) {
+            if (errno == EINTR)
+               continue;
+            return false;
+         }
+         if (w == 0) {
+            errno = EIO;
+            return false;
+         }
+         data += w;
+         len -= w;
+      }
+      return true;
+   }
+
+} // namespace
@@ -0,0 +1,124 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// output.h: destinations for section and TS packet data
+// -----------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace sigen {
+
+   class TStream;
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \brief Destination for section or TS packet data.
+    *
+    * MpgPacketizer writes the packets it builds to a sink, and any
+    * sink can be given a whole TStream. Implementations decide when
+    * the data reaches its destination; flush() waits for it.
+    */
+   class OutputSink
+   {
+   public:
+      virtual ~OutputSink() {}
+
+      /*!
+       * \brief Write a block of data.
+       * \param data Data to write. Only needs to be valid for the
+       * duration of the call.
+       * \param len Length of the data in bytes.
+       * \return `false` on error.
+       */
+      virtual bool write(const ui8 *data, std::size_t len) = 0;
+
+      /*!
+       * \brief Write the data of all the sections in a stream.
+       * \param t Stream to write.
+       * \return `false` on error.
+       */
+      virtual bool write(const TStream &t);
+
+      /*!
+       * \brief Wait until all the data written has reached its
+       * destination.
+       * \return `false` if any of it couldn't be written.
+       */
+      virtual bool flush() { return true; }
+   };
+
+   /*!
+    * \brief Blocking writes to a file descriptor.
+    */
+   class FdSink : public OutputSink
+   {
+   public:
+      /*!
+       * \brief Constructor.
+       * \param fd Open file descriptor. Not closed by the sink.
+       */
+      explicit FdSink(int fd) : fd(fd), owned(false) {}
+      /*!
+       * \brief Constructor. Creates (or truncates) the file.
+       * \param file_name Name of the file to write to.
+       */
+      explicit FdSink(const std::string &file_name);
+      ~FdSink();
+
+      FdSink(const FdSink &) = delete;
+      FdSink &operator=(const FdSink &) = delete;
+
+      //! \brief Returns `true` if the file descriptor is valid.
+      bool isOpen() const { return fd >= 0; }
+
+      using OutputSink::write;
+      virtual bool write(const ui8 *data, std::size_t len);
+
+   private:
+      int fd;
+      bool owned;
+   };
+
+   /*!
+    * \brief Collects the data in memory.
+    */
+   class BufferSink : public OutputSink
+   {
+   public:
+      using OutputSink::write;
+      virtual bool write(const ui8 *data, std::size_t len) {
+         buffer.insert(buffer.end(), data, data + len);
+         return true;
+      }
+
+      //! \brief The data written.
+      std::vector<ui8> buffer;
+   };
+
+   //! @}
+
+} // sigen namespace
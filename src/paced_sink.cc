@@ -0,0 +1,202 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// paced_sink.cc: constant bitrate TS packet output
+// -----------------------------------
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <time.h>
+#include "paced_sink.h"
+
+namespace sigen
+{
+   namespace paced_priv {
+
+      const ui8 NULL_PACKET_HEADER[] = { 0x47, 0x1f, 0xff, 0x10 };
+
+      static ui64 now_ns()
+      {
+         timespec ts;
+         clock_gettime(CLOCK_MONOTONIC, &ts);
+         return static_cast<ui64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+      }
+
+      static void sleep_until(ui64 t)
+      {
+         timespec ts;
+         ts.tv_sec = t / 1000000000;
+         ts.tv_nsec = t % 1000000000;
+         while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+            ;
+      }
+   }
+
+   using namespace paced_priv;
+
+   // --------------------------------
+   // statistics
+   //
+   std::chrono::nanoseconds PacedSink::Stats::meanLate() const
+   {
+      if (!batches)
+         return std::chrono::nanoseconds(0);
+      return std::chrono::nanoseconds( static_cast<ui64>(sum_late / batches) );
+   }
+
+   std::chrono::nanoseconds PacedSink::Stats::jitter() const
+   {
+      if (!batches)
+         return std::chrono::nanoseconds(0);
+
+      double mean = sum_late / batches;
+      double var = std::max(0.0, sum_late_sq / batches - mean * mean);
+      return std::chrono::nanoseconds( static_cast<ui64>(std::sqrt(var)) );
+   }
+
+
+   // --------------------------------
+   // paced output
+   //
+   PacedSink::PacedSink(OutputSink &o) : PacedSink(o, Options()) {}
+
+   PacedSink::PacedSink(OutputSink &o, const Options &options) :
+      out(o), opts(options), queue_head(0), started(false), start(0), batch_num(0)
+   {
+      opts.bitrate = std::max<ui32>(opts.bitrate, 1);
+      opts.burst = std::max<ui16>(opts.burst, 1);
+      interval_ns = opts.burst * PACKET_SIZE * 8 * 1e9 / opts.bitrate;
+
+      // the null packets are written in place of missing data
+      batch.resize(opts.burst * PACKET_SIZE);
+   }
+
+   std::chrono::nanoseconds PacedSink::interval() const
+   {
+      return std::chrono::nanoseconds( static_cast<ui64>(interval_ns) );
+   }
+
+
+   //
+   // queues the data. Bytes short of a whole packet stay at the end
+   // of the queue until the rest arrives
+   //
+   bool PacedSink::write(const ui8 *data, std::size_t len)
+   {
+      // drop what's been sent before growing the queue
+      if (queue_head > 0 && queue_head >= queue.size() / 2) {
+         queue.erase(queue.begin(), queue.begin() + queue_head);
+         queue_head = 0;
+      }
+      queue.insert(queue.end(), data, data + len);
+
+      while (queued() > opts.max_queue) {
+         if (!emit())
+            return false;
+      }
+      return true;
+   }
+
+   bool PacedSink::flush()
+   {
+      while (queued() > 0) {
+         if (!emit())
+            return false;
+      }
+      return out.flush();
+   }
+
+   bool PacedSink::run(std::chrono::nanoseconds d)
+   {
+      ui64 end = now_ns() + d.count();
+      while (now_ns() < end) {
+         if (!emit())
+            return false;
+      }
+      return true;
+   }
+
+
+   //
+   // sleeps until shortly before t then spins until it
+   //
+   void PacedSink::waitUntil(ui64 t) const
+   {
+      ui64 now = now_ns();
+      if (now >= t)
+         return;
+
+      if (t - now > opts.spin_ns)
+         sleep_until(t - opts.spin_ns);
+      while (now_ns() < t)
+         ;
+   }
+
+
+   //
+   // sends the next batch at its time
+   //
+   bool PacedSink::emit()
+   {
+      if (!started) {
+         start = now_ns();
+         batch_num = 0;
+         started = true;
+      }
+
+      ui64 due = start + static_cast<ui64>(batch_num * interval_ns);
+      waitUntil(due);
+
+      ui64 sent = now_ns();
+      ui64 late = sent - due;
+
+      // fill the batch from the queue, then with null packets
+      std::size_t n = std::min<std::size_t>(queued(), opts.burst);
+      memcpy(batch.data(), queue.data() + queue_head, n * PACKET_SIZE);
+      queue_head += n * PACKET_SIZE;
+
+      for (std::size_t i = n; i < opts.burst; i++) {
+         ui8 *p = batch.data() + i * PACKET_SIZE;
+         memcpy(p, NULL_PACKET_HEADER, sizeof(NULL_PACKET_HEADER));
+         memset(p + sizeof(NULL_PACKET_HEADER), 0xff, PACKET_SIZE - sizeof(NULL_PACKET_HEADER));
+      }
+
+      bool ok = out.write(batch.data(), batch.size());
+
+      stats.batches++;
+      stats.packets += opts.burst;
+      stats.null_packets += opts.burst - n;
+      stats.max_late = std::max(stats.max_late, std::chrono::nanoseconds(late));
+      stats.sum_late += late;
+      stats.sum_late_sq += static_cast<double>(late) * late;
+
+      // too far behind to catch up without a burst - start over
+      if (late > interval_ns) {
+         start = sent;
+         batch_num = 0;
+         stats.slips++;
+      }
+      batch_num++;
+
+      return ok;
+   }
+
+} // namespace
@@ -0,0 +1,164 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// paced_sink.h: constant bitrate TS packet output
+// -----------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+#include "types.h"
+#include "output.h"
+
+namespace sigen {
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \brief Writes TS packets to another sink at a constant bitrate.
+    *
+    * Packets are queued as they are written and sent downstream in
+    * batches of a fixed number of packets, each batch at its
+    * scheduled time. Batches are padded with null packets (PID
+    * 0x1fff) when the queue runs short, so the output never stops:
+    *
+    * \code
+    *    FdSink fifo(fd);
+    *    PacedSink::Options opts;
+    *    opts.bitrate = 1500000;
+    *    PacedSink paced(fifo, opts);
+    *    MpgPacketizer pkt(paced, 0);
+    *
+    *    for (;;) {
+    *       pkt.packetize(section, pid);   // queue a cycle of SI
+    *       paced.run(std::chrono::milliseconds(100));
+    *    }
+    * \endcode
+    *
+    * The schedule is kept in absolute CLOCK_MONOTONIC time, so the
+    * rate doesn't drift. Each wait sleeps with clock_nanosleep() and
+    * then spins on the clock (read through the vDSO, from the TSC on
+    * most systems) for the last few microseconds. A batch that is
+    * more than one batch interval late restarts the schedule rather
+    * than bursting to catch up.
+    */
+   class PacedSink : public OutputSink
+   {
+   public:
+      enum { PACKET_SIZE = 188 };
+
+      //! \brief Configuration.
+      struct Options {
+         ui32 bitrate = 1500000;  //!< Output rate in bits/s.
+         ui16 burst = 7;          //!< Packets per batch.
+         ui32 max_queue = 1024;   //!< Packets queued before write() waits for them to be sent.
+         ui32 spin_ns = 20000;    //!< Spin for the last part of each wait instead of sleeping.
+      };
+
+      //! \brief Output statistics.
+      struct Stats {
+         ui64 batches = 0;        //!< Batches sent.
+         ui64 packets = 0;        //!< Packets sent, including null packets.
+         ui64 null_packets = 0;   //!< Null packets sent.
+         ui64 slips = 0;          //!< Times the schedule was restarted.
+         std::chrono::nanoseconds max_late{0}; //!< Latest a batch was sent.
+
+         //! \brief Mean time batches were sent after their scheduled time.
+         std::chrono::nanoseconds meanLate() const;
+         //! \brief Standard deviation of the send times from the schedule.
+         std::chrono::nanoseconds jitter() const;
+
+         double sum_late = 0;     // ns
+         double sum_late_sq = 0;  // ns^2
+      };
+
+      /*!
+       * \brief Constructor.
+       * \param out Sink to write the batches to.
+       */
+      explicit PacedSink(OutputSink &out);
+      /*!
+       * \brief Constructor.
+       * \param out Sink to write the batches to.
+       * \param options Configuration.
+       */
+      PacedSink(OutputSink &out, const Options &options);
+
+      PacedSink(const PacedSink &) = delete;
+      PacedSink &operator=(const PacedSink &) = delete;
+
+      using OutputSink::write;
+      /*!
+       * \brief Queue TS packets. Sends batches (waiting for their
+       * time) while more than Options::max_queue packets are queued.
+       * \return `false` if writing downstream failed.
+       */
+      virtual bool write(const ui8 *data, std::size_t len);
+      /*!
+       * \brief Send batches until the queue is empty, then flush the
+       * downstream sink.
+       */
+      virtual bool flush();
+
+      /*!
+       * \brief Wait for the next batch time and send a batch.
+       * \return `false` if writing downstream failed.
+       */
+      bool emit();
+      /*!
+       * \brief Send batches for the given time.
+       * \param d How long to run for.
+       * \return `false` if writing downstream failed.
+       */
+      bool run(std::chrono::nanoseconds d);
+
+      //! \brief Number of whole packets waiting to be sent.
+      std::size_t queued() const { return (queue.size() - queue_head) / PACKET_SIZE; }
+      //! \brief Time between batches.
+      std::chrono::nanoseconds interval() const;
+
+      //! \brief Returns the statistics.
+      const Stats &getStats() const { return stats; }
+      //! \brief Clears the statistics.
+      void resetStats() { stats = Stats(); }
+
+   private:
+      void waitUntil(ui64 t) const;
+
+      OutputSink &out;
+      Options opts;
+      double interval_ns;
+
+      std::vector<ui8> queue;
+      std::size_t queue_head;   // first byte not sent
+      std::vector<ui8> batch;
+
+      bool started;
+      ui64 start;               // schedule origin, ns
+      ui64 batch_num;           // batches since start
+      Stats stats;
+   };
+
+   //! @}
+
+} // sigen namespace
@@ -0,0 +1,91 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// packet_cache.cc: cache of the TS packets of unchanged tables
+// -----------------------------------
+
+#include "descriptor.h"
+#include "packet_cache.h"
+#include "output.h"
+#include "packetizer.h"
+#include "table.h"
+#include "tstream.h"
+
+namespace sigen
+{
+   namespace packet_cache_priv {
+
+      enum { PACKET_SIZE = 188 };
+
+      // the version the cached packets were built with
+      static ui8 versionOf(const STable &table)
+      {
+         const PSITable *psi = dynamic_cast<const PSITable *>(&table);
+         return psi ? psi->getVersionNumber() : 0;
+      }
+   }
+
+   using namespace packet_cache_priv;
+
+   //
+   // rebuilds the entry if it's stale, then writes the packets with
+   // their continuity_counter nibble rewritten in place
+   //
+   bool PacketCache::emit(const STable &table, ui16 pid, ui8 &cc, OutputSink &out)
+   {
+      Entry &e = entries[ Key{ &table, pid } ];
+
+      if (e.build_id == 0 || e.build_id != table.getBuildId() ||
+          e.version != versionOf(table)) {
+         TStream t;
+         table.buildSections(t);
+
+         BufferSink packets;
+         MpgPacketizer pkt(packets, 0);
+         for (const TStream::SectionPtr &s : t.section_list)
+            pkt.packetize(*s, pid);
+
+         e.build_id = table.getBuildId();
+         e.version = versionOf(table);
+         e.packets = std::move(packets.buffer);
+         miss_count++;
+      }
+      else
+         hit_count++;
+
+      for (ui8 *p = e.packets.data(), *end = p + e.packets.size(); p < end; p += PACKET_SIZE) {
+         p[3] = (p[3] & 0xf0) | (cc & 0x0f);
+         cc = (cc + 1) & 0x0f;
+      }
+
+      return out.write(e.packets.data(), e.packets.size());
+   }
+
+
+   void PacketCache::invalidate(const STable &table)
+   {
+      for (auto i = entries.begin(); i != entries.end(); ) {
+         if (i->first.table == &table)
+            i = entries.erase(i);
+         else
+            ++i;
+      }
+   }
+
+} // namespace
@@ -0,0 +1,113 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// packet_cache.h: cache of the TS packets of unchanged tables
+// -----------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include "types.h"
+
+namespace sigen {
+
+   class STable;
+   class OutputSink;
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \brief Keeps the TS packets of tables that are sent repeatedly.
+    *
+    * A carousel sends the same PAT, PMT, NIT, SDT, etc. over and over.
+    * The first emit() of a table on a PID builds its sections and
+    * packetizes them. Later ones write the same packets again, only
+    * rewriting their continuity_counter:
+    *
+    * \code
+    *    PacketCache cache;
+    *    ui8 cc = 0;   // the PID's continuity counter
+    *    for (;;)
+    *       cache.emit(pat, 0x00, cc, out);
+    * \endcode
+    *
+    * Entries are keyed by the table object and PID. An entry is
+    * replaced when the table has been rebuilt since it was cached
+    * (STable::getBuildId()) or, for PSI tables, when its version
+    * changed. Tables modified without either (e.g., a TDT) must be
+    * rebuilt or invalidate()d to be sent with their new data.
+    */
+   class PacketCache
+   {
+   public:
+      /*!
+       * \brief Write the table's TS packets.
+       * \param table Table to send.
+       * \param pid PID to send it on.
+       * \param cc Continuity counter of the PID - used for the first
+       * packet and left at the value for the next.
+       * \param out Sink to write the packets to.
+       * \return `false` if the sink failed.
+       */
+      bool emit(const STable &table, ui16 pid, ui8 &cc, OutputSink &out);
+
+      //! \brief Drops the table's entries (on all PIDs).
+      void invalidate(const STable &table);
+      //! \brief Drops all entries.
+      void clear() { entries.clear(); }
+
+      //! \brief Number of cached tables.
+      std::size_t size() const { return entries.size(); }
+      //! \brief Number of emit() calls that used cached packets.
+      ui64 hits() const { return hit_count; }
+      //! \brief Number of emit() calls that built the packets.
+      ui64 misses() const { return miss_count; }
+
+   private:
+      struct Key {
+         const STable *table;
+         ui16 pid;
+
+         bool operator==(const Key &k) const { return table == k.table && pid == k.pid; }
+      };
+
+      struct KeyHash {
+         std::size_t operator()(const Key &k) const {
+            return std::hash<const void *>()(k.table) ^ k.pid;
+         }
+      };
+
+      struct Entry {
+         ui64 build_id;
+         ui8 version;
+         std::vector<ui8> packets;
+      };
+
+      std::unordered_map<Key, Entry, KeyHash> entries;
+      ui64 hit_count = 0;
+      ui64 miss_count = 0;
+   };
+
+   //! @}
+
+} // sigen namespace
@@ -20,13 +20,11 @@
 // packetizer.cc: class definition for mpeg packetizer
 // -----------------------------------
 
-#include <iostream>
-#include <iomanip>
-#include <fstream>
 #include <string>
 #include "types.h"
 #include "packetizer.h"
 #include "tstream.h"
+#include "bit_layout.h"
 
 namespace sigen
 {
@@ -35,15 +33,26 @@ namespace sigen
    //
    //
    MpgPacketizer::MpgPacketizer(const std::string &out_file, ui8 cont_count) :
-      filename(out_file),
+      file(new FdSink(out_file)),
+      sink(*file),
+      write_failed(!static_cast<FdSink &>(*file).isOpen()),
+      transport_error_indicator(false),
+      transport_priority(false),
+      continuity_count(cont_count),
+      transport_scrambling_control(MpgPacketizer::NOT_SCRAMBLED),
+      adaptation_field_control(MpgPacketizer::NO_ADAPTATION_FIELD)
+   {
+   }
+
+   MpgPacketizer::MpgPacketizer(OutputSink &out, ui8 cont_count) :
+      sink(out),
+      write_failed(false),
       transport_error_indicator(false),
       transport_priority(false),
       continuity_count(cont_count),
       transport_scrambling_control(MpgPacketizer::NOT_SCRAMBLED),
       adaptation_field_control(MpgPacketizer::NO_ADAPTATION_FIELD)
    {
-      // open the file to create it (empty) - we'll append to it below
-      std::ofstream tfile( filename.c_str(), std::ios::out );
    }
 
 
@@ -54,19 +63,24 @@ namespace sigen
    {
       bool payload_unit_start_indicator = true;
       ui16 cur_section_size, this_section_size;
-      ui8 header_size, packet_size;
-      ui8 packet[PACKET_SIZE], *tptr;
-      std::ofstream packetfile(filename.c_str(), std::ios::app);
+      ui8 header_size;
+      ui8 packets[MAX_PACKETS * PACKET_SIZE], *packet = packets, *tptr;
 
       const ui8 *section_data = section.getBinaryData();
 
       cur_section_size = this_section_size = section.length();
 
       header_size = HEADER_SIZE;
-      packet_size = PACKET_SIZE - header_size;
 
       // start
       while (cur_section_size > 0) {
+         // hand over a full batch before longer sections overrun it
+         if (packet == packets + sizeof(packets)) {
+            if (!sink.write(packets, sizeof(packets)))
+               write_failed = true;
+            packet = packets;
+         }
+
          // fill packet with pad val for short packets
          for (int i = 0; i < PACKET_SIZE; i++)
             packet[i] = 0xff;
@@ -96,9 +110,11 @@ namespace sigen
          // clear unit start so only first packet of section is unit start
          payload_unit_start_indicator = false;
 
-         for (int i = 0; i < PACKET_SIZE; i++)
-            packetfile << packet[i];
+         packet += PACKET_SIZE;
       }
+
+      if (!sink.write(packets, packet - packets))
+         write_failed = true;
       return continuity_count;
    }
 
@@ -109,45 +125,30 @@ namespace sigen
                                  bool payload_unit_start_indicator,
                                  ui16 pid)
    {
-      *(packet++) = SYNC_BYTE;
+      // sync_byte, transport_error_indicator,
+      // payload_unit_start_indicator, transport_priority, PID,
+      // transport_scrambling_control, adaptation_field_control,
+      // continuity_counter
+      typedef BitLayout<8, 1, 1, 1, 13, 2, 2, 4> Header;
 
       if (!section_data) {
-         std::cout << "byte: " << std::hex
-                   << static_cast<ui16>( (transport_error_indicator << 7) |
-                                         (payload_unit_start_indicator << 6) |
-                                         (transport_priority << 5) |
-                                         ((pid >> 8) & 0x1f) )
-                   << std::endl;
-
-         *(packet++) = static_cast<ui8>( (transport_error_indicator << 7) |
-                                         (payload_unit_start_indicator << 6) |
-                                         (transport_priority << 5) |
-                                         ((pid >> 8) & 0x1f) );
-         *(packet++) = static_cast<ui8>(pid & 0xff);
-         *(packet)   = static_cast<ui8>( (transport_scrambling_control << 6) |
-                                         (adaptation_field_control << 4) |
-                                         (continuity_count & 0xf) );
-
-         std::cerr << "tsc: " << static_cast<ui16>(transport_scrambling_control)
-                   << ", afc: " << static_cast<ui16>(adaptation_field_control)
-                   << ", cc: " << static_cast<ui16>(continuity_count)
-                   << std::endl;
+         Header::pack(packet, SYNC_BYTE,
+                      transport_error_indicator,
+                      payload_unit_start_indicator,
+                      transport_priority,
+                      pid,
+                      transport_scrambling_control,
+                      adaptation_field_control,
+                      continuity_count);
 
          // only increment CC based on value of AFC
          if ( (adaptation_field_control != MpgPacketizer::RESERVED) &&
               (adaptation_field_control != MpgPacketizer::ADAPTATION_FIELD_ONLY) )
             continuity_count++;
       }
-      else {
-         *(packet++) = static_cast<ui8>( (0 << 7) |
-                                         (0 << 6) |
-                                         (0 << 5) |
-                                         (0x1f) );
-         *(packet++) = static_cast<ui8>( 0xff );
-         *(packet)   = static_cast<ui8>( (0 << 6) |
-                                         (1 << 4) |
-                                         0 );
-      }
+      else
+         Header::pack(packet, SYNC_BYTE, 0, 0, 0, 0x1fff, 0,
+                      MpgPacketizer::NO_ADAPTATION_FIELD, 0);
    }
 
 } // namespace
@@ -22,8 +22,10 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 #include "types.h"
+#include "output.h"
 
 namespace sigen {
 
@@ -43,8 +45,10 @@ namespace sigen {
          ADAPTATION_FIELD_AND_PAYLOAD = 0x4
       };
 
-      // constructor
+      // constructors - packets are written to the file (created
+      // empty) or to the sink
       MpgPacketizer(const std::string &out_file, ui8 cont_count);
+      MpgPacketizer(OutputSink &out, ui8 cont_count);
       // prohibit
       MpgPacketizer() = delete;
       MpgPacketizer(const MpgPacketizer &) = delete;
@@ -57,8 +61,16 @@ namespace sigen {
          transport_priority = transport_pri;
       }
 
+      // writes the section's packets to the output in a single
+      // write. Returns the continuity_counter
       int packetize(const Section &section, ui16 pid);
 
+      // false once the output couldn't be opened or a write to it
+      // failed, until clearError(). The continuity_counter still
+      // advances for the packets lost
+      bool good() const { return !write_failed; }
+      void clearError() { write_failed = false; }
+
    protected:
       void getHeader(ui8 *packet, const ui8 *section_data,
                      bool payload_unit_start_indicator, ui16 pid);
@@ -69,12 +81,18 @@ namespace sigen {
          HEADER_SIZE   = 4,
          PKT_DATA_SIZE = 184,
          PACKET_SIZE   = PKT_DATA_SIZE + 4,
+         // packets written to the sink at once: enough for the longest
+         // private section (4096 bytes) plus the pointer_field. Longer
+         // sections are written in several batches
+         MAX_PACKETS   = (4096 + 1 + PKT_DATA_SIZE - 1) / PKT_DATA_SIZE,
       };
 
       // data
-      std::string filename;
+      std::unique_ptr<OutputSink> file; // set if writing to a file
+      OutputSink &sink;
 
-      bool transport_error_indicator,
+      bool write_failed,
+           transport_error_indicator,
            transport_priority;
       ui8 continuity_count,
           transport_scrambling_control : 2,
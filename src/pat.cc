@@ -41,10 +41,54 @@ namespace sigen
       return true;
    }
 
+   //
+   // add a batch of programs
+   bool PAT::addPrograms(const ProgramSpec* specs, size_t count)
+   {
+      // make sure they all fit
+      if ( count > MAX_TABLE_LEN || !incLength(count * Program::BASE_LEN) )
+         return false;
+
+      for (size_t i = 0; i < count; i++)
+         program_list.emplace_back(specs[i].program_number, specs[i].program_map_pid);
+      return true;
+   }
+
 
    //
-   // writes to the stream
+   // the sections writeSection() will produce
+   void PAT::planSections(SectionPlan& plan) const
+   {
+      SectionPlanner p(plan, BASE_LENGTH, getMaxDataLen());
+      for (size_t i = 0; i < program_list.size(); i++) {
+         p.atItem(i);
+         p.add(Program::BASE_LEN);
+      }
+      p.finish();
+   }
+
+   //
+   // a writer with its own context, from a planned section on
+   PSITable::SectionWriter PAT::sectionWriter(const SectionStart& at) const
+   {
+      Context start;
+      start.op_state = WRITE_HEAD;
+      start.p_iter = std::next(program_list.begin(), at.item);
+
+      return [this, start](Section& s, ui8 cur_sec, ui16& sec_bytes) mutable {
+         return writeSection(s, cur_sec, sec_bytes, start);
+      };
+   }
+
+
    bool PAT::writeSection(Section& section, ui8 cur_sec, ui16 &sec_bytes) const
+   {
+      return writeSection(section, cur_sec, sec_bytes, run);
+   }
+
+   //
+   // writes to the stream
+   bool PAT::writeSection(Section& section, ui8 cur_sec, ui16 &sec_bytes, Context& run) const
    {
       bool done = false;
       bool exit = false;
@@ -62,14 +106,9 @@ namespace sigen
               // common data for every section
               // if table's length is > available space, we'll
               // overwrite the section length later on
-              writeSectionHeader(section);
-
-              // section count information
-              section.set08Bits(cur_sec);
-
-              // we don't know the last section number yet, so
-              // for now set it to 0,
-              section.set08Bits(0);
+              // section count information. We don't know the last section
+              // number yet, so for now set it to 0
+              writeSectionHeader(section, cur_sec, 0);
 
               sec_bytes = BASE_LENGTH; // the minimum section size
               run.op_state = (!run.p ? GET_PROGRAM : WRITE_PROGRAM);
@@ -101,6 +140,7 @@ namespace sigen
            case WRITE_PROGRAM:
               section.set16Bits(run.p->number);
               section.set16Bits( rbits(0xe000) | run.p->pid );
+              BUILD_STAT( section.countItem() );
 
               sec_bytes += Program::BASE_LEN;
               run.op_state = GET_PROGRAM;
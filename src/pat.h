@@ -23,6 +23,7 @@
 #pragma once
 
 #include <list>
+#include <vector>
 #include "table.h"
 
 namespace sigen {
@@ -61,6 +62,25 @@ namespace sigen {
        */
       bool addProgram(ui16 program_number, ui16 program_map_pid);
 
+      /*!
+       * \brief Program entry for batch insertion with addPrograms().
+       */
+      struct ProgramSpec {
+         ui16 program_number;        //!< Identifes the program.
+         ui16 program_map_pid;       //!< PID of the packets carrying the program's PMT.
+      };
+      /*!
+       * \brief Add a batch of programs. The length is checked once
+       * for all of them and nothing is added if they don't fit.
+       * \param specs Array of programs to add.
+       * \param count Number of entries in specs.
+       */
+      bool addPrograms(const ProgramSpec* specs, size_t count);
+      //! \brief Add a batch of programs. See addPrograms(const ProgramSpec*, size_t).
+      bool addPrograms(const std::vector<ProgramSpec>& specs) {
+         return addPrograms(specs.data(), specs.size());
+      }
+
       /*!
        * \brief Convenience method to add a network pid (setting
        *        program number as 0).
@@ -92,19 +112,25 @@ namespace sigen {
       };
 
       // the list of program / pids
-      std::list<Program> program_list;
+      typedef TrackedList<Program, AllocKind::TABLE_ITEM> ProgramList;
+      ProgramList program_list;
 
       enum State_t { INIT, WRITE_HEAD, GET_PROGRAM, WRITE_PROGRAM };
-      mutable struct Context {
+      struct Context {
          Context() : op_state(INIT), p(nullptr) {}
 
          State_t op_state;
          const Program *p;
-         std::list<Program>::const_iterator p_iter;
-      } run;
+         ProgramList::const_iterator p_iter;
+      };
+      mutable Context run;
+
+      bool writeSection(Section&, ui8, ui16 &, Context& run) const;
 
    protected:
       virtual bool writeSection(Section&, ui8, ui16 &) const;
+      virtual void planSections(SectionPlan&) const;
+      virtual SectionWriter sectionWriter(const SectionStart&) const;
    };
    //! @}
    //! @}
@@ -11,6 +11,7 @@
 #include "pmt.h"
 #include "descriptor.h"
 #include "tstream.h"
+#include "item_writer.h"
 
 namespace sigen
 {
@@ -47,9 +48,65 @@ namespace sigen
    }
 
    //
-   // writes the data to the stream
+   // add a batch of elementary streams
+   bool PMT::addElemStreams(const ElemStreamSpec* specs, size_t count)
+   {
+#ifdef CHECK_DUPLICATES
+      checkDuplicates(es_list, specs, count,
+                      [](const ElemStreamSpec& s) { return s.elem_pid; },
+                      "elemtary stream with pid");
+#endif
+
+      if ( !reserveItems(es_list, count, ElementaryStream::BASE_LEN) )
+         return false;
+
+      for (size_t i = 0; i < count; i++)
+         es_list.push_back(new ElementaryStream(specs[i].elem_pid, specs[i].type));
+      return true;
+   }
+
+   //
+   // the sections writeSection() will produce
+   void PMT::planSections(SectionPlan& plan) const
+   {
+      SectionPlanner p(plan, BASE_LENGTH, getMaxDataLen(), prog_desc.begin());
+      for (auto d = prog_desc.begin(); d != prog_desc.end(); ++d) {
+         p.atDesc(d);
+         p.add((*d)->length());
+      }
+      p.atDesc(prog_desc.end());
+      planItems(p, es_list);
+      p.finish();
+   }
+
    //
+   // a writer with its own context, from a planned section on
+   PSITable::SectionWriter PMT::sectionWriter(const SectionStart& at) const
+   {
+      Context start;
+      start.op_state = WRITE_HEAD;
+      start.pd_iter = at.desc;
+      start.es_iter = writeOrder(es_list).begin() + at.item;
+      if (at.split) {
+         start.es = *start.es_iter++;
+         start.item = ListItem::Context(at.item_desc);
+      }
+
+      return [this, start](Section& s, ui8 cur_sec, ui16& sec_bytes) mutable {
+         return writeSection(s, cur_sec, sec_bytes, start);
+      };
+   }
+
+
    bool PMT::writeSection(Section& section, ui8 cur_sec, ui16 &sec_bytes) const
+   {
+      return writeSection(section, cur_sec, sec_bytes, run);
+   }
+
+   //
+   // writes the data to the stream
+   //
+   bool PMT::writeSection(Section& section, ui8 cur_sec, ui16 &sec_bytes, Context& run) const
    {
       ui8 *prog_info_len_pos = 0;
       ui16 d_len, prog_info_len = 0;
@@ -62,21 +119,16 @@ namespace sigen
            case INIT:
               // associate the iterators to the list
               run.pd_iter = prog_desc.begin();
-              run.es_iter = es_list.begin();
+              run.es_iter = writeOrder(es_list).begin();
               run.op_state = WRITE_HEAD;
 
            case WRITE_HEAD:
               // common data for every section
               // if table's length is > max_section_len, we'll
               // overwrite the section length later on
-              writeSectionHeader(section);
-
-              // section count information
-              section.set08Bits(cur_sec);
-
-              // we don't know the last section number yet, so
-              // for now set it to 0,
-              section.set08Bits(0);//last_sec_num);
+              // section count information. We don't know the last section
+              // number yet, so for now set it to 0
+              writeSectionHeader(section, cur_sec, 0);
 
               section.set16Bits( rbits(0xe000) | pcr_pid );
 
@@ -104,7 +156,7 @@ namespace sigen
                     run.pd = (*run.pd_iter++).get();
 
                     // check if we can fit it in this section
-                    if (sec_bytes + run.pd->length() > getMaxDataLen()) {
+                    if (sec_bytes + run.pd->length() > getPlannedDataLen(cur_sec)) {
                        // we can't.. return so we can get a new section
                        // we'll add it when we come back
                        run.op_state = WRITE_HEAD;
@@ -128,7 +180,7 @@ namespace sigen
 
            case WRITE_PROG_DESC:
               // add the network descriptor
-              run.pd->buildSections(section);
+              run.pd->encode(section);
 
               d_len = run.pd->length();
               sec_bytes += d_len;
@@ -140,7 +192,7 @@ namespace sigen
 
            case GET_XPORT_STREAM:
               // fetch a transport stream
-              if (run.es_iter != es_list.end()) {
+              if (run.es_iter != writeOrder(es_list).end()) {
                  run.es = (*run.es_iter++);
 
                  // first, check if it has any descriptors.. we'll try to fit
@@ -150,7 +202,7 @@ namespace sigen
 
                     // check the size with the descriptor
                     if ( (sec_bytes + PMT::ElementaryStream::BASE_LEN + d->length()) >
-                         getMaxDataLen() ) {
+                         getPlannedDataLen(cur_sec) ) {
                        // won't fit.. wait until the next section
                        run.op_state = WRITE_HEAD;
                        exit = true;
@@ -159,7 +211,7 @@ namespace sigen
                  }
                  else {
                     // check if this XS with no descs will fit here
-                    if ( (sec_bytes + PMT::ElementaryStream::BASE_LEN) > getMaxDataLen() ) {
+                    if ( (sec_bytes + PMT::ElementaryStream::BASE_LEN) > getPlannedDataLen(cur_sec) ) {
                        // nope.. wait also
                        run.op_state = WRITE_HEAD;
                        exit = true;
@@ -180,7 +232,7 @@ namespace sigen
 
            case WRITE_XPORT_STREAM:
               // finally write it
-              if (!(*run.es).write_section(section, getMaxDataLen(), sec_bytes)) {
+              if (!(*run.es).write_section<ElementaryStream>(section, getPlannedDataLen(cur_sec), sec_bytes, run.item)) {
                  run.op_state = WRITE_HEAD;
                  exit = true;
                  break;
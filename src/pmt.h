@@ -24,6 +24,7 @@
 
 #include <memory>
 #include <list>
+#include <vector>
 #include "table.h"
 
 namespace sigen {
@@ -92,12 +93,44 @@ namespace sigen {
        * \param desc Descriptor to add.
        */
       bool addProgramDesc(Descriptor& desc);
+      /*!
+       * \brief Construct a Descriptor of type T in the table's storage and
+       * add it to the Program Descriptors loop.
+       * \param args Arguments forwarded to the T constructor.
+       */
+      template <class T, class... Args>
+      bool emplaceProgramDesc(Args&&... args) {
+         return emplaceWith<T>(prog_desc.resource(),
+                               [this](Descriptor& d) { return addProgramDesc(d); },
+                               std::forward<Args>(args)...);
+      }
       /*!
        * \brief Add an elementary stream to table.
        * \param type Stream type. See PMT::esTypes.
        * \param elem_pid PID to carry the stream packets.
        */
       bool addElemStream(ui8 type, ui16 elem_pid);
+
+      /*!
+       * \brief Elementary stream entry for batch insertion with
+       * addElemStreams().
+       */
+      struct ElemStreamSpec {
+         ui8 type;                   //!< Stream type. See PMT::esTypes.
+         ui16 elem_pid;              //!< PID to carry the stream packets.
+      };
+      /*!
+       * \brief Add a batch of elementary streams. The length is
+       * checked once for all of them and nothing is added if they
+       * don't fit.
+       * \param specs Array of elementary streams to add.
+       * \param count Number of entries in specs.
+       */
+      bool addElemStreams(const ElemStreamSpec* specs, size_t count);
+      //! \brief Add a batch of elementary streams. See addElemStreams(const ElemStreamSpec*, size_t).
+      bool addElemStreams(const std::vector<ElemStreamSpec>& specs) {
+         return addElemStreams(specs.data(), specs.size());
+      }
       /*!
        * \brief Add a Descriptor to the last added elementary stream.
        * \param desc Descriptor to add.
@@ -109,6 +142,19 @@ namespace sigen {
        * \param desc Descriptor to add.
        */
       bool addElemStreamDesc(ui16 elem_pid, Descriptor& desc) { return addItemDesc(es_list, elem_pid, desc); }
+      /*!
+       * \brief Construct a Descriptor of type T in the table's storage and
+       * add it to the last added elementary stream.
+       * \param args Arguments forwarded to the T constructor.
+       */
+      template <class T, class... Args>
+      bool emplaceElemStreamDesc(Args&&... args) {
+         return emplaceItemDesc<T>(es_list, std::forward<Args>(args)...);
+      }
+
+      //! \brief See ExtPSITable::setPacking().
+      using ExtPSITable::setPacking;
+      using ExtPSITable::getPacking;
 
 #ifdef ENABLE_DUMP
       virtual void dump(std::ostream &) const;
@@ -120,7 +166,7 @@ namespace sigen {
              MAX_SEC_LEN = 1024 };
 
       // the stream holder struct - private to the pmt
-      struct ElementaryStream : public ExtPSITable::ListItem {
+      struct ElementaryStream final : public ExtPSITable::ListItem {
          enum { BASE_LEN = 5 };
 
          ui16 elementary_pid : 13;
@@ -133,7 +179,7 @@ namespace sigen {
          ElementaryStream() = delete;
 
          virtual ui16 length() const { return 5; }
-         virtual bool equals(ui16 pid) const { return pid == elementary_pid; }
+         virtual ui16 key() const { return elementary_pid; }
 
          // writes item header bytes, returns num bytes written
          virtual ui8 write_header(Section& sec) const;
@@ -143,23 +189,29 @@ namespace sigen {
       ui16 program_info_length;
       ui16 pcr_pid : 13;
       DescList prog_desc;
-      std::list<ListItem*>& es_list;
+      ItemList& es_list;
 
       enum State_t { INIT, WRITE_HEAD, GET_PROG_DESC, WRITE_PROG_DESC,
                      GET_XPORT_STREAM, WRITE_XPORT_STREAM };
-      mutable struct Context {
+      struct Context {
          Context() : d_done(false), op_state(INIT), pd(nullptr), es(nullptr) {}
 
          bool d_done;
          State_t op_state;
          const Descriptor* pd;
          const ListItem* es;
-         std::list<std::unique_ptr<Descriptor> >::const_iterator pd_iter;
-         std::list<ListItem*>::const_iterator es_iter;
-      } run;
+         DescList::const_iterator pd_iter;
+         ItemList::const_iterator es_iter;
+         ListItem::Context item;
+      };
+      mutable Context run;
+
+      bool writeSection(Section&, ui8, ui16 &, Context& run) const;
 
    protected:
       virtual bool writeSection(Section&, ui8, ui16 &) const;
+      virtual void planSections(SectionPlan&) const;
+      virtual SectionWriter sectionWriter(const SectionStart&) const;
    };
    //! @}
    //! @}
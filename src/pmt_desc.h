@@ -382,7 +382,7 @@ namespace sigen {
          Subtitling() = delete;
       };
 
-      std::list<Subtitling> subtitling_list;
+      LoopList<Subtitling> subtitling_list;
    };
 
    /*!
@@ -442,7 +442,7 @@ namespace sigen {
          Teletext() = delete;
       };
 
-      std::list<Teletext> teletext_list;
+      LoopList<Teletext> teletext_list;
    };
    //! @}
 } // sigen namespace
@@ -28,6 +28,7 @@
 #include "table.h"
 #include "descriptor.h"
 #include "tstream.h"
+#include "item_writer.h"
 #include "sdt.h"
 
 namespace sigen
@@ -53,10 +54,64 @@ namespace sigen
       return true;
    }
 
+   //
+   // adds a batch of services
+   //
+   bool SDT::addServices(const ServiceSpec* specs, size_t count)
+   {
+#ifdef CHECK_DUPLICATES
+      checkDuplicates(serv_list, specs, count,
+                      [](const ServiceSpec& s) { return s.service_id; }, "service with id");
+#endif
+
+      if ( !reserveItems(serv_list, count, Service::BASE_LEN) )
+         return false;
+
+      for (size_t i = 0; i < count; i++) {
+         const ServiceSpec& s = specs[i];
+         serv_list.push_back(new Service(s.service_id, s.eit_schedule_flag,
+                                         s.eit_present_following_flag,
+                                         s.running_status, s.free_CA_mode));
+      }
+      return true;
+   }
+
+   //
+   // the sections writeSection() will produce
+   void SDT::planSections(SectionPlan& plan) const
+   {
+      SectionPlanner p(plan, BASE_LENGTH, getMaxDataLen());
+      planItems(p, serv_list);
+      p.finish();
+   }
+
+   //
+   // a writer with its own context, from a planned section on
+   PSITable::SectionWriter SDT::sectionWriter(const SectionStart& at) const
+   {
+      Context start;
+      start.op_state = WRITE_HEAD;
+      start.s_iter = writeOrder(serv_list).begin() + at.item;
+      if (at.split) {
+         start.serv = *start.s_iter++;
+         start.item = ListItem::Context(at.item_desc);
+      }
+
+      return [this, start](Section& s, ui8 cur_sec, ui16& sec_bytes) mutable {
+         return writeSection(s, cur_sec, sec_bytes, start);
+      };
+   }
+
+
    //
    // write to the stream
    //
    bool SDT::writeSection(Section& section, ui8 cur_sec, ui16 &sec_bytes) const
+   {
+      return writeSection(section, cur_sec, sec_bytes, run);
+   }
+
+   bool SDT::writeSection(Section& section, ui8 cur_sec, ui16 &sec_bytes, Context& run) const
    {
       bool done = false, exit = false;
 
@@ -65,21 +120,16 @@ namespace sigen
          switch (run.op_state)
          {
            case INIT:
-              run.s_iter = serv_list.begin();
+              run.s_iter = writeOrder(serv_list).begin();
               run.op_state = WRITE_HEAD;
 
            case WRITE_HEAD:
               // common data for every section
               // if table's length is > available space, we'll
               // overwrite the section length later on
-              writeSectionHeader(section);
-
-              // section count information
-              section.set08Bits(cur_sec);
-
-              // we don't know the last section number yet, so
-              // for now set it to 0,
-              section.set08Bits(0);
+              // section count information. We don't know the last section
+              // number yet, so for now set it to 0
+              writeSectionHeader(section, cur_sec, 0);
 
               section.set16Bits(original_network_id);
               section.set08Bits( rbits(0xff) ); // reserved (8)
@@ -90,7 +140,7 @@ namespace sigen
 
            case GET_SERVICE:
               // fetch the next service
-              if (run.s_iter != serv_list.end()) {
+              if (run.s_iter != writeOrder(serv_list).end()) {
                  run.serv = (*run.s_iter++);
 
                  if (!run.serv->descriptors.empty()) {
@@ -98,7 +148,7 @@ namespace sigen
 
                     // check if we can fit it with at least one descriptor
                     if (sec_bytes + Service::BASE_LEN + d->length() >
-                        getMaxDataLen()) {
+                        getPlannedDataLen(cur_sec)) {
                        // we can't, so let's get another section to write
                        // this service to
                        run.op_state = WRITE_HEAD;
@@ -108,7 +158,7 @@ namespace sigen
                  }
                  else {
                     // no descriptors.. can we add the empty service?
-                    if ( (sec_bytes + Service::BASE_LEN) > getMaxDataLen() ) {
+                    if ( (sec_bytes + Service::BASE_LEN) > getPlannedDataLen(cur_sec) ) {
                        run.op_state = WRITE_HEAD;
                        exit = true;
                        break;
@@ -127,7 +177,7 @@ namespace sigen
 
            case WRITE_SERVICE:
               // try to write it
-              if (!(*run.serv).write_section(section, getMaxDataLen(), sec_bytes)) {
+              if (!(*run.serv).write_section<Service>(section, getPlannedDataLen(cur_sec), sec_bytes, run.item)) {
                  run.op_state = WRITE_HEAD;
                  exit = true;
                  break;
@@ -24,6 +24,7 @@
 
 #include <memory>
 #include <list>
+#include <vector>
 #include "table.h"
 
 namespace sigen {
@@ -55,6 +56,29 @@ namespace sigen {
        */
       bool addService(ui16 service_id, bool eit_schedule_flag, bool eit_present_following_flag,
                       ui8  running_status, bool free_CA_mode);
+
+      /*!
+       * \brief Service entry for batch insertion with addServices().
+       * Fields are as per the addService() arguments.
+       */
+      struct ServiceSpec {
+         ui16 service_id;
+         bool eit_schedule_flag;
+         bool eit_present_following_flag;
+         ui8  running_status;
+         bool free_CA_mode;
+      };
+      /*!
+       * \brief Add a batch of services. The length is checked once
+       * for all of them and nothing is added if they don't fit.
+       * \param specs Array of services to add.
+       * \param count Number of entries in specs.
+       */
+      bool addServices(const ServiceSpec* specs, size_t count);
+      //! \brief Add a batch of services. See addServices(const ServiceSpec*, size_t).
+      bool addServices(const std::vector<ServiceSpec>& specs) {
+         return addServices(specs.data(), specs.size());
+      }
       /*!
        * \brief Add a Descriptor to the most recently added service.
        * \param desc Descriptor to add.
@@ -66,6 +90,19 @@ namespace sigen {
        * \param desc Descriptor to add.
        */
       bool addServiceDesc(ui16 service_id, Descriptor& desc) { return addItemDesc(serv_list, service_id, desc); }
+      /*!
+       * \brief Construct a Descriptor of type T in the table's storage and
+       * add it to the most recently added service.
+       * \param args Arguments forwarded to the T constructor.
+       */
+      template <class T, class... Args>
+      bool emplaceServiceDesc(Args&&... args) {
+         return emplaceItemDesc<T>(serv_list, std::forward<Args>(args)...);
+      }
+
+      //! \brief See ExtPSITable::setPacking().
+      using ExtPSITable::setPacking;
+      using ExtPSITable::getPacking;
 
 #ifdef ENABLE_DUMP
       virtual void dump(std::ostream &) const;
@@ -75,7 +112,7 @@ namespace sigen {
       enum { MAX_SEC_LEN = 1024 };
 
       // the service holder class - private to the sdt
-      struct Service : public ExtPSITable::ListItem {
+      struct Service final : public ExtPSITable::ListItem {
          enum { BASE_LEN = 5 };
 
          ui16 id;
@@ -92,7 +129,7 @@ namespace sigen {
          Service() = delete;
 
          virtual ui16 length() const { return 5; }
-         virtual bool equals(ui16 sid) const { return sid == id; }
+         virtual ui16 key() const { return id; }
 
          // writes item header bytes, returns num bytes written
          virtual ui8 write_header(Section& sec) const;
@@ -102,16 +139,20 @@ namespace sigen {
 
       // sdt data members begin here
       ui16 original_network_id;
-      std::list<ListItem*>& serv_list;
+      ItemList& serv_list;
 
       enum State_t { INIT, WRITE_HEAD, GET_SERVICE, WRITE_SERVICE };
-      mutable struct Context {
+      struct Context {
          Context() : op_state(INIT), serv(nullptr) {}
          
          State_t op_state;
          const ListItem* serv;
-         std::list<ListItem*>::const_iterator s_iter;
-      } run;
+         ItemList::const_iterator s_iter;
+         ListItem::Context item;
+      };
+      mutable Context run;
+
+      bool writeSection(Section&, ui8, ui16 &, Context& run) const;
 
    protected:
       // constructor
@@ -123,6 +164,8 @@ namespace sigen {
       { }
 
       virtual bool writeSection(Section&, ui8, ui16 &) const;
+      virtual void planSections(SectionPlan&) const;
+      virtual SectionWriter sectionWriter(const SectionStart&) const;
    };
    //! @}
 
@@ -86,7 +86,7 @@ namespace sigen {
       };
 
       // the list of language structs
-      std::list<Language> language_list;
+      LoopList<Language> language_list;
    };
 
    /*!
@@ -129,7 +129,7 @@ namespace sigen {
       };
 
       // the list of ident structs
-      std::list<Ident> ident_list;
+      LoopList<Ident> ident_list;
    };
 
 
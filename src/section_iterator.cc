@@ -0,0 +1,62 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// section_iterator.cc: builds a table one section at a time
+// -----------------------------------
+
+#include "section_iterator.h"
+#include "descriptor.h"
+#include "table.h"
+
+namespace sigen
+{
+   SectionIterator::SectionIterator(const STable &t, std::pmr::memory_resource* r) :
+      table(t), strm(r), count(t.startBuild()), built(count == 0)
+   {
+      if (built) {
+         table.buildSections(strm);
+         count = strm.section_list.size();
+      }
+   }
+
+   SectionIterator::~SectionIterator()
+   {
+      if (!built && cur > 0 && !done())
+         table.cancelBuild(cur);
+   }
+
+   //
+   // the section is built into the iterator's stream and taken out of
+   // it
+   //
+   TStream::SectionPtr SectionIterator::next()
+   {
+      if (done())
+         return nullptr;
+
+      if (!built)
+         table.buildSection(strm, cur, count - 1);
+      cur++;
+
+      TStream::SectionPtr s = std::move(strm.section_list.front());
+      strm.section_list.pop_front();
+      return s;
+   }
+
+} // namespace
@@ -0,0 +1,105 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// section_iterator.h: builds a table one section at a time
+// -----------------------------------
+
+#pragma once
+
+#include "types.h"
+#include "alloc.h"
+#include "tstream.h"
+
+namespace sigen {
+
+   class STable;
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \brief Builds the sections of a table one at a time, as they're
+    * asked for.
+    *
+    * STable::buildSections() builds all of a table's sections before
+    * returning. An iterator instead builds the next section on each
+    * call to next(), so the consumer decides when the work is done
+    * and how many sections are held at once, e.g., sending each
+    * section before the next one is built:
+    *
+    * \code
+    *    SectionIterator it(sdt);
+    *    while (TStream::SectionPtr s = it.next()) {
+    *       mux.queue(0x11, *s);
+    *       mux.mux(max_packets);
+    *    }
+    * \endcode
+    *
+    * The number of sections, and so the last_section_number they
+    * carry, is worked out when the iterator is constructed. PSI tables
+    * plan them from the lengths tracked as items and descriptors are
+    * added. Tables that don't support it (e.g., the TDT and TOT,
+    * which are a single section) are built whole by the constructor.
+    *
+    * The table must not be modified or built in any other way while
+    * it is being iterated. An iterator destroyed before the end
+    * finishes the build without keeping the sections.
+    */
+   class SectionIterator
+   {
+   public:
+      /*!
+       * \brief Constructor.
+       * \param table Table to build.
+       * \param r Memory resource to allocate the sections from.
+       */
+      SectionIterator(const STable &table,
+                      std::pmr::memory_resource* r = getMemoryResource());
+
+      ~SectionIterator();
+
+      SectionIterator(const SectionIterator &) = delete;
+      SectionIterator &operator=(const SectionIterator &) = delete;
+
+      //! \brief Total number of sections the table is built as.
+      ui16 size() const { return count; }
+      //! \brief Number of sections not returned yet.
+      ui16 remaining() const { return count - cur; }
+      //! \brief Returns `true` once all the sections have been returned.
+      bool done() const { return cur == count; }
+
+      /*!
+       * \brief Build the next section.
+       * \return The section, owned by the caller, or nullptr once all
+       * have been returned.
+       */
+      TStream::SectionPtr next();
+
+   private:
+      const STable &table;
+      TStream strm;     // built sections not yet returned, and spare buffers
+      ui16 count;
+      ui16 cur = 0;
+      bool built;       // all built by the constructor
+   };
+
+   //! @}
+
+} // sigen namespace
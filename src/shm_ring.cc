@@ -0,0 +1,302 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// shm_ring.cc: TS packet ring in POSIX shared memory
+// -----------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shm_ring.h"
+
+namespace sigen
+{
+   namespace shm_ring_priv {
+      enum : ui32 {
+         CACHE_LINE = 64,
+         MAGIC      = 0x53475252, // "SGRR"
+         VERSION    = 1,
+         MAX_CAPACITY = 1u << 31   // in packets, a power of 2
+      };
+
+      inline bool validCapacity(ui32 cap) {
+         return cap > 0 && cap <= MAX_CAPACITY && (cap & (cap - 1)) == 0;
+      }
+   }
+
+   using namespace shm_ring_priv;
+
+   //
+   // the start of the shared memory. Each index has a cache line of
+   // its own so the writer and reader don't contend for it
+   //
+   struct ShmRingHeader
+   {
+      std::atomic<ui32> magic;  // set once the rest is initialized
+      ui32 version;
+      ui32 packet_size;
+      ui32 capacity;
+      alignas(CACHE_LINE) std::atomic<ui64> head;  // written by the writer
+      alignas(CACHE_LINE) std::atomic<ui64> tail;  // written by the reader
+   };
+
+   static_assert(std::atomic<ui64>::is_always_lock_free,
+                 "the ring indices must be lock-free to be shared between processes");
+
+   // the packets follow the header, on a cache line boundary
+   static const std::size_t PACKETS_OFFSET =
+      (sizeof(ShmRingHeader) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+
+
+   // --------------------------------
+   // common
+   //
+   ShmRing::~ShmRing()
+   {
+      if (hdr)
+         munmap(hdr, map_size);
+   }
+
+   ui32 ShmRing::size() const
+   {
+      if (!hdr)
+         return 0;
+      return hdr->head.load(std::memory_order_acquire) - hdr->tail.load(std::memory_order_acquire);
+   }
+
+
+   // --------------------------------
+   // writer
+   //
+   ShmRingWriter::ShmRingWriter(const std::string &n, ui32 count) :
+      name(n), head(0), cached_tail(0), timeout(std::chrono::seconds(1)), partial_len(0)
+   {
+      // larger rings would wrap the capacity
+      if (count > MAX_CAPACITY)
+         return;
+
+      cap = 1;
+      while (cap < count)
+         cap <<= 1;
+      map_size = PACKETS_OFFSET + static_cast<std::size_t>(cap) * PACKET_SIZE;
+
+      int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+      if (fd < 0)
+         return;
+
+      void *m = MAP_FAILED;
+      if (ftruncate(fd, map_size) == 0)
+         m = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (m == MAP_FAILED)
+         return;
+
+      hdr = static_cast<ShmRingHeader *>(m);
+      packets = static_cast<ui8 *>(m) + PACKETS_OFFSET;
+
+      // readers check the magic last
+      hdr->magic.store(0, std::memory_order_relaxed);
+      hdr->version = VERSION;
+      hdr->packet_size = PACKET_SIZE;
+      hdr->capacity = cap;
+      hdr->head.store(0, std::memory_order_relaxed);
+      hdr->tail.store(0, std::memory_order_relaxed);
+      hdr->magic.store(MAGIC, std::memory_order_release);
+   }
+
+   ShmRingWriter::~ShmRingWriter()
+   {
+      if (hdr)
+         shm_unlink(name.c_str());
+   }
+
+   //
+   // copies the packets that fit and publishes them
+   //
+   std::size_t ShmRingWriter::tryWrite(const ui8 *data, std::size_t count)
+   {
+      if (!hdr)
+         return 0;
+
+      std::size_t room = cap - (head - cached_tail);
+      if (room < count) {
+         cached_tail = hdr->tail.load(std::memory_order_acquire);
+         room = cap - (head - cached_tail);
+      }
+
+      std::size_t n = std::min(count, room);
+      std::size_t idx = head & (cap - 1);
+      std::size_t first = std::min<std::size_t>(n, cap - idx);
+
+      memcpy(packets + idx * PACKET_SIZE, data, first * PACKET_SIZE);
+      memcpy(packets, data + first * PACKET_SIZE, (n - first) * PACKET_SIZE);
+
+      head += n;
+      hdr->head.store(head, std::memory_order_release);
+      return n;
+   }
+
+   //
+   // publishes whole packets, waiting for the reader when the ring is
+   // full, for up to the timeout each time it makes no room
+   //
+   bool ShmRingWriter::write(const ui8 *data, std::size_t len)
+   {
+      if (!hdr)
+         return false;
+
+      typedef std::chrono::steady_clock clock;
+      clock::time_point stalled;
+      auto wait = [&]() {
+         clock::time_point now = clock::now();
+         if (stalled == clock::time_point())
+            stalled = now;
+         if (now - stalled >= timeout)
+            return false;
+         sched_yield();
+         return true;
+      };
+
+      // complete a packet started by the last write
+      if (partial_len > 0) {
+         std::size_t n = std::min<std::size_t>(len, PACKET_SIZE - partial_len);
+         memcpy(partial + partial_len, data, n);
+         partial_len += n;
+         data += n;
+         len -= n;
+
+         if (partial_len < PACKET_SIZE)
+            return true;
+         while (tryWrite(partial, 1) == 0) {
+            if (!wait()) {
+               partial_len = 0;
+               return false;
+            }
+         }
+         stalled = clock::time_point();
+         partial_len = 0;
+      }
+
+      std::size_t count = len / PACKET_SIZE;
+      while (count > 0) {
+         std::size_t n = tryWrite(data, count);
+         if (n == 0 && !wait())
+            return false;
+         if (n > 0)
+            stalled = clock::time_point();
+         data += n * PACKET_SIZE;
+         count -= n;
+      }
+
+      // hold on to the rest
+      partial_len = len % PACKET_SIZE;
+      memcpy(partial, data, partial_len);
+      return true;
+   }
+
+
+   // --------------------------------
+   // reader
+   //
+   ShmRingReader::ShmRingReader(const std::string &name) :
+      tail(0), cached_head(0)
+   {
+      int fd = shm_open(name.c_str(), O_RDWR, 0);
+      if (fd < 0)
+         return;
+
+      struct stat st;
+      void *m = MAP_FAILED;
+      if (fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= PACKETS_OFFSET)
+         m = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (m == MAP_FAILED)
+         return;
+
+      ShmRingHeader *h = static_cast<ShmRingHeader *>(m);
+      std::size_t size = st.st_size;
+      if (h->magic.load(std::memory_order_acquire) != MAGIC ||
+          h->version != VERSION ||
+          h->packet_size != PACKET_SIZE ||
+          !validCapacity(h->capacity) ||
+          PACKETS_OFFSET + static_cast<std::size_t>(h->capacity) * PACKET_SIZE > size) {
+         munmap(m, size);
+         return;
+      }
+
+      hdr = h;
+      map_size = size;
+      packets = static_cast<ui8 *>(m) + PACKETS_OFFSET;
+      cap = hdr->capacity;
+      tail = cached_head = hdr->tail.load(std::memory_order_acquire);
+   }
+
+   //
+   // the packets up to the end of the ring or the writer's position
+   //
+   const ui8 *ShmRingReader::peek(std::size_t &count)
+   {
+      count = 0;
+      if (!hdr)
+         return nullptr;
+
+      if (cached_head == tail)
+         cached_head = hdr->head.load(std::memory_order_acquire);
+
+      std::size_t idx = tail & (cap - 1);
+      count = std::min<std::size_t>(cached_head - tail, cap - idx);
+      return packets + idx * PACKET_SIZE;
+   }
+
+   void ShmRingReader::release(std::size_t count)
+   {
+      if (!hdr)
+         return;
+
+      tail += count;
+      hdr->tail.store(tail, std::memory_order_release);
+   }
+
+   //
+   // copies out what's available, in up to two runs if it wraps
+   //
+   std::size_t ShmRingReader::read(ui8 *out, std::size_t max)
+   {
+      std::size_t total = 0;
+      for (int run = 0; run < 2 && total < max; run++) {
+         std::size_t n;
+         const ui8 *p = peek(n);
+         n = std::min(n, max - total);
+         if (n == 0)
+            break;
+
+         memcpy(out + total * PACKET_SIZE, p, n * PACKET_SIZE);
+         release(n);
+         total += n;
+      }
+      return total;
+   }
+
+} // namespace
@@ -0,0 +1,175 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// shm_ring.h: TS packet ring in POSIX shared memory, for handing
+// packets to a muxer running in another process
+// -----------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include "types.h"
+#include "output.h"
+
+namespace sigen {
+
+   struct ShmRingHeader;
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \brief Base class for the two ends of a TS packet ring in POSIX
+    * shared memory.
+    *
+    * The ring has a single producer (ShmRingWriter) and a single
+    * consumer (ShmRingReader), normally in different processes. It is
+    * lock-free: each side only advances its own index, and the two
+    * indices are kept on separate cache lines.
+    */
+   class ShmRing
+   {
+   public:
+      enum { PACKET_SIZE = 188 };
+
+      //! \brief Returns `true` if the shared memory is mapped.
+      bool isOpen() const { return hdr != nullptr; }
+      //! \brief Number of packets the ring holds.
+      ui32 capacity() const { return cap; }
+      //! \brief Number of packets written and not yet read.
+      ui32 size() const;
+
+   protected:
+      ShmRing() : hdr(nullptr), packets(nullptr), cap(0), map_size(0) {}
+      ~ShmRing();
+
+      ShmRing(const ShmRing &) = delete;
+      ShmRing &operator=(const ShmRing &) = delete;
+
+      ShmRingHeader *hdr;
+      ui8 *packets;
+      ui32 cap;
+      std::size_t map_size;
+   };
+
+   /*!
+    * \brief Producer end of a shared memory TS packet ring.
+    *
+    * Give it to an MpgPacketizer to publish the packets it builds:
+    *
+    * \code
+    *    ShmRingWriter ring("/si_out", 4096);
+    *    MpgPacketizer pkt(ring, 0);
+    *    pkt.packetize(section, pid);
+    * \endcode
+    */
+   class ShmRingWriter : public ShmRing, public OutputSink
+   {
+   public:
+      /*!
+       * \brief Constructor. Creates (or resets) the shared memory
+       * object.
+       * \param name Name of the object, as for shm_open() (e.g., "/si").
+       * \param packets Capacity of the ring. Rounded up to a power of
+       * 2, at most 2^31. The ring isn't created for more.
+       */
+      ShmRingWriter(const std::string &name, ui32 packets);
+      //! \brief Destructor. Removes the name of the shared memory object.
+      ~ShmRingWriter();
+
+      /*!
+       * \brief Set how long write() waits for the reader to make room
+       * in a full ring. The default is one second.
+       * \param t Time without any room being made after which write()
+       * gives up. 0 makes write() not wait at all.
+       */
+      void setTimeout(std::chrono::milliseconds t) { timeout = t; }
+
+      using OutputSink::write;
+      /*!
+       * \brief Publish TS packets, waiting for room in the ring if
+       * needed. Data not making up a whole packet is held until the
+       * rest of the packet is written.
+       * \return `false` if the ring isn't open, or if the reader made
+       * no room within the timeout (e.g., no reader is attached or it
+       * died). The packets that didn't fit are then dropped.
+       */
+      virtual bool write(const ui8 *data, std::size_t len);
+      /*!
+       * \brief Publish as many whole packets as there is room for,
+       * without waiting.
+       * \param data Packets to publish.
+       * \param count Number of packets.
+       * \return The number of packets published.
+       */
+      std::size_t tryWrite(const ui8 *data, std::size_t count);
+
+   private:
+      std::string name;
+      ui64 head;          // next packet to write
+      ui64 cached_tail;   // reader's position when last checked
+      std::chrono::milliseconds timeout;
+      ui8 partial[PACKET_SIZE];
+      ui8 partial_len;
+   };
+
+   /*!
+    * \brief Consumer end of a shared memory TS packet ring.
+    */
+   class ShmRingReader : public ShmRing
+   {
+   public:
+      /*!
+       * \brief Constructor. Maps a ring created by a ShmRingWriter.
+       * \param name Name of the shared memory object.
+       */
+      explicit ShmRingReader(const std::string &name);
+
+      /*!
+       * \brief Copy packets out of the ring without waiting.
+       * \param out Destination, room for max packets.
+       * \param max Maximum number of packets to read.
+       * \return The number of packets read.
+       */
+      std::size_t read(ui8 *out, std::size_t max);
+
+      /*!
+       * \brief Access the next packets in place.
+       * \param count Set to the number of contiguous packets available.
+       * \return Pointer to the first of them. Valid until release().
+       */
+      const ui8 *peek(std::size_t &count);
+      /*!
+       * \brief Return packets obtained with peek() to the writer.
+       * Does nothing if the ring isn't open.
+       * \param count Number of packets consumed.
+       */
+      void release(std::size_t count);
+
+   private:
+      ui64 tail;          // next packet to read
+      ui64 cached_head;   // writer's position when last checked
+   };
+
+   //! @}
+
+} // sigen namespace
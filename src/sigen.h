@@ -25,14 +25,27 @@
 #include "config.h"
 
 #include "types.h"
+#include "alloc.h"
 #include "dvb_defs.h"
 #include "version.h"
 
 #include "tstream.h"
+#include "bit_layout.h"
+#include "output.h"
+#include "async_writer.h"
+#include "shm_ring.h"
+#include "paced_sink.h"
+#include "packet_cache.h"
 #include "packetizer.h"
+#include "ts_mux.h"
+#include "version_manager.h"
+#include "snapshot.h"
+#include "section_iterator.h"
+#include "thread_pool.h"
 #include "utc.h"
 #include "language_code.h"
 #include "dump.h"
+#include "build_stats.h"
 
 #include "table.h"
 #include "nit_bat.h"
@@ -0,0 +1,274 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// snapshot.cc: binary snapshot of built sections and output state
+// -----------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+#include "tstream.h"
+
+namespace sigen
+{
+   //
+   // the file is the header followed by the stream, section and
+   // version records and the section data, each part aligned to 8
+   // bytes
+   //
+   struct SnapshotHeader {
+      char magic[8];
+      ui32 format;
+      ui32 num_streams;
+      ui32 num_sections;
+      ui32 num_versions;
+      ui64 data_size;
+   };
+
+   struct SnapshotStream {
+      ui16 pid;
+      ui8 cc;
+      ui8 reserved;
+      ui32 first;    // index of its first section record
+      ui32 count;
+   };
+
+   struct SnapshotSection {
+      ui64 offset;   // in the section data
+      ui16 length;
+      ui16 reserved[3];
+   };
+
+   struct SnapshotVersion {
+      ui8 table_id;
+      ui8 version;
+      ui16 table_id_ext;
+      ui16 onid;
+      ui16 tsid;
+      ui64 hash;
+   };
+
+   namespace snapshot_priv {
+
+      const char MAGIC[8] = { 'S', 'I', 'G', 'E', 'N', 'S', 'N', 'P' };
+      const ui32 FORMAT = 1;
+      const ui16 MAX_SECTION_LEN = 4096;
+
+      inline std::size_t align8(std::size_t n) { return (n + 7) & ~static_cast<std::size_t>(7); }
+
+      // offsets of the parts of the file
+      struct Layout {
+         std::size_t streams, sections, versions, data, end;
+
+         Layout(const SnapshotHeader &h) {
+            streams = align8(sizeof(SnapshotHeader));
+            sections = streams + align8(h.num_streams * sizeof(SnapshotStream));
+            versions = sections + h.num_sections * sizeof(SnapshotSection);
+            data = versions + h.num_versions * sizeof(SnapshotVersion);
+            end = data + h.data_size;
+         }
+      };
+   }
+
+   using namespace snapshot_priv;
+
+   // --------------------------------
+   // writer
+   //
+
+   void SnapshotWriter::addStream(ui16 pid, const TStream &t, ui8 cc)
+   {
+      streams.push_back({ pid, static_cast<ui8>(cc & 0x0f),
+                          static_cast<ui32>(sections.size()),
+                          static_cast<ui32>(t.section_list.size()) });
+
+      for (const auto &s : t.section_list) {
+         sections.push_back({ data.size(), s->length() });
+         data.insert(data.end(), s->getBinaryData(), s->getBinaryData() + s->length());
+      }
+   }
+
+   void SnapshotWriter::addVersions(const VersionManager &vm)
+   {
+      std::vector<VersionManager::Entry> e = vm.getEntries();
+      versions.insert(versions.end(), e.begin(), e.end());
+   }
+
+   //
+   // written to a temporary file which replaces the snapshot once
+   // complete
+   //
+   bool SnapshotWriter::write(const std::string &file) const
+   {
+      SnapshotHeader h = {};
+      memcpy(h.magic, MAGIC, sizeof(h.magic));
+      h.format = FORMAT;
+      h.num_streams = streams.size();
+      h.num_sections = sections.size();
+      h.num_versions = versions.size();
+      h.data_size = data.size();
+      Layout l(h);
+
+      std::vector<ui8> index(l.data, 0);
+      memcpy(&index[0], &h, sizeof(h));
+
+      SnapshotStream *sr = reinterpret_cast<SnapshotStream *>(&index[l.streams]);
+      for (const Stream &s : streams)
+         *sr++ = { s.pid, s.cc, 0, s.first, s.count };
+
+      SnapshotSection *sec = reinterpret_cast<SnapshotSection *>(&index[l.sections]);
+      for (const Section &s : sections)
+         *sec++ = { s.offset, s.length, { 0, 0, 0 } };
+
+      SnapshotVersion *v = reinterpret_cast<SnapshotVersion *>(&index[l.versions]);
+      for (const VersionManager::Entry &e : versions)
+         *v++ = { e.table_id, e.version, e.table_id_ext, e.onid, e.tsid, e.hash };
+
+      std::string tmp = file + ".tmp";
+      {
+         std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+         if (!f)
+            return false;
+
+         f.write(reinterpret_cast<const char *>(index.data()), index.size());
+         f.write(reinterpret_cast<const char *>(data.data()), data.size());
+         if (!f.flush())
+            return false;
+      }
+      return std::rename(tmp.c_str(), file.c_str()) == 0;
+   }
+
+
+   // --------------------------------
+   // reader
+   //
+
+   //
+   // maps the file and checks every record points inside it
+   //
+   SnapshotReader::SnapshotReader(const std::string &file)
+   {
+      int fd = ::open(file.c_str(), O_RDONLY);
+      if (fd < 0)
+         return;
+
+      struct stat st;
+      void *m = MAP_FAILED;
+      if (fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(SnapshotHeader))
+         m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if (m == MAP_FAILED)
+         return;
+
+      base = static_cast<const ui8 *>(m);
+      map_size = st.st_size;
+
+      const SnapshotHeader *h = reinterpret_cast<const SnapshotHeader *>(base);
+      Layout l(*h);
+      bool ok = (memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0) &&
+         h->format == FORMAT && h->data_size <= map_size && l.end == map_size;
+
+      if (ok) {
+         stream_recs = reinterpret_cast<const SnapshotStream *>(base + l.streams);
+         section_recs = reinterpret_cast<const SnapshotSection *>(base + l.sections);
+         version_recs = reinterpret_cast<const SnapshotVersion *>(base + l.versions);
+
+         for (ui32 i = 0; ok && i < h->num_streams; i++)
+            ok = static_cast<ui64>(stream_recs[i].first) + stream_recs[i].count <= h->num_sections;
+         // each record must point inside the data, at a section no
+         // longer than a private section whose own length matches
+         for (ui32 i = 0; ok && i < h->num_sections; i++) {
+            const SnapshotSection &r = section_recs[i];
+            ok = r.offset <= h->data_size && r.length <= h->data_size - r.offset &&
+               r.length >= 3 && r.length <= MAX_SECTION_LEN;
+            if (ok) {
+               const ui8 *d = base + l.data + r.offset;
+               ok = 3 + (((d[1] & 0x0f) << 8) | d[2]) == r.length;
+            }
+         }
+      }
+
+      if (ok) {
+         hdr = h;
+         base += l.data;
+      }
+      else {
+         munmap(m, map_size);
+         base = nullptr;
+         map_size = 0;
+      }
+   }
+
+   SnapshotReader::~SnapshotReader()
+   {
+      if (hdr)
+         munmap(const_cast<SnapshotHeader *>(hdr), map_size);
+   }
+
+
+   std::size_t SnapshotReader::numStreams() const
+   {
+      return hdr ? hdr->num_streams : 0;
+   }
+
+   ui16 SnapshotReader::getPid(std::size_t i) const
+   {
+      return stream_recs[i].pid;
+   }
+
+   ui8 SnapshotReader::getContinuityCounter(std::size_t i) const
+   {
+      return stream_recs[i].cc;
+   }
+
+   ui32 SnapshotReader::numSections(std::size_t i) const
+   {
+      return stream_recs[i].count;
+   }
+
+   const ui8 *SnapshotReader::getSectionData(std::size_t i, ui32 section, ui16 &length) const
+   {
+      const SnapshotSection &s = section_recs[stream_recs[i].first + section];
+      length = s.length;
+      return base + s.offset;
+   }
+
+   void SnapshotReader::getSections(std::size_t i, TStream &t) const
+   {
+      for (ui32 j = 0; j < stream_recs[i].count; j++) {
+         ui16 len;
+         const ui8 *d = getSectionData(i, j, len);
+         t.getNewSection(len)->setBits(d, len);
+      }
+   }
+
+   void SnapshotReader::restore(VersionManager &vm) const
+   {
+      for (ui32 i = 0; hdr && i < hdr->num_versions; i++) {
+         const SnapshotVersion &v = version_recs[i];
+         vm.setEntry({ v.table_id, v.table_id_ext, v.onid, v.tsid, v.version, v.hash });
+      }
+   }
+
+} // namespace
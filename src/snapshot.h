@@ -0,0 +1,169 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// snapshot.h: binary snapshot of built sections and output state
+// -----------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "types.h"
+#include "version_manager.h"
+
+namespace sigen {
+
+   class TStream;
+
+   struct SnapshotHeader;
+   struct SnapshotStream;
+   struct SnapshotSection;
+   struct SnapshotVersion;
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \brief Saves the sections being sent, with the continuity
+    * counter of each PID and the table versions, to a file a
+    * SnapshotReader can map back in.
+    *
+    * Written at the end of each cycle (or whenever something
+    * changed), it lets a restarted generator resume sending without
+    * rebuilding its tables first:
+    *
+    * \code
+    *    SnapshotWriter snap;
+    *    snap.addStream(0x11, sdt_sections, mux.continuityCounter(0x11));
+    *    snap.addStream(0x12, eit_sections, mux.continuityCounter(0x12));
+    *    snap.addVersions(versions);
+    *    snap.write("/var/lib/si/snapshot");
+    * \endcode
+    *
+    * The file is in the byte order of the machine that wrote it.
+    */
+   class SnapshotWriter
+   {
+   public:
+      /*!
+       * \brief Add the sections sent on a PID. The data is copied.
+       * \param pid PID the sections are sent on.
+       * \param t The sections.
+       * \param cc Continuity counter of the next packet on the PID.
+       */
+      void addStream(ui16 pid, const TStream &t, ui8 cc = 0);
+
+      //! \brief Add the state of all the tables known to a VersionManager.
+      void addVersions(const VersionManager &vm);
+
+      /*!
+       * \brief Write the snapshot, replacing the file atomically.
+       * \return `false` if it couldn't be written.
+       */
+      bool write(const std::string &file) const;
+
+   private:
+      struct Stream {
+         ui16 pid;
+         ui8 cc;
+         ui32 first, count;   // in sections
+      };
+      struct Section {
+         std::size_t offset;  // in data
+         ui16 length;
+      };
+
+      std::vector<Stream> streams;
+      std::vector<Section> sections;
+      std::vector<ui8> data;
+      std::vector<VersionManager::Entry> versions;
+   };
+
+   /*!
+    * \brief Maps a snapshot written by SnapshotWriter.
+    *
+    * Opening only maps the file and checks its index, so the
+    * sections are available right away, read in place from the
+    * mapping, or copied into a TStream:
+    *
+    * \code
+    *    SnapshotReader snap("/var/lib/si/snapshot");
+    *    snap.restore(versions);
+    *    for (std::size_t i = 0; i < snap.numStreams(); i++) {
+    *       TStream t;
+    *       snap.getSections(i, t);
+    *       mux.addPid(snap.getPid(i), 0, 1, snap.getContinuityCounter(i));
+    *       mux.queue(snap.getPid(i), t);
+    *    }
+    * \endcode
+    */
+   class SnapshotReader
+   {
+   public:
+      /*!
+       * \brief Constructor.
+       * \param file Snapshot file to map. isOpen() is `false` if it
+       * can't be read or isn't a valid snapshot.
+       */
+      SnapshotReader(const std::string &file);
+      ~SnapshotReader();
+
+      SnapshotReader(const SnapshotReader &) = delete;
+      SnapshotReader &operator=(const SnapshotReader &) = delete;
+
+      //! \brief Returns `true` if a valid snapshot is mapped.
+      bool isOpen() const { return hdr != nullptr; }
+
+      //! \brief Number of streams (PIDs) in the snapshot.
+      std::size_t numStreams() const;
+      //! \brief PID of a stream.
+      ui16 getPid(std::size_t stream) const;
+      //! \brief Continuity counter of the next packet of a stream.
+      ui8 getContinuityCounter(std::size_t stream) const;
+      //! \brief Number of sections in a stream.
+      ui32 numSections(std::size_t stream) const;
+
+      /*!
+       * \brief Data of a section of a stream, in the mapping.
+       * \param stream Index of the stream.
+       * \param section Index of the section in the stream.
+       * \param length Set to the length of the section.
+       */
+      const ui8 *getSectionData(std::size_t stream, ui32 section, ui16 &length) const;
+
+      //! \brief Copy the sections of a stream to the end of t.
+      void getSections(std::size_t stream, TStream &t) const;
+
+      //! \brief Set the table versions saved in the snapshot in a VersionManager.
+      void restore(VersionManager &vm) const;
+
+   private:
+      const SnapshotHeader *hdr = nullptr;
+      const SnapshotStream *stream_recs = nullptr;
+      const SnapshotSection *section_recs = nullptr;
+      const SnapshotVersion *version_recs = nullptr;
+      const ui8 *base = nullptr;
+      std::size_t map_size = 0;
+   };
+
+   //! @}
+
+} // sigen namespace
@@ -92,7 +92,7 @@ namespace sigen {
       };
 
       ui8 OUI_data_length;
-      std::list<SSULinkageDesc::OUIData> oui_list;
+      LoopList<SSULinkageDesc::OUIData> oui_list;
       std::vector<ui8> private_data;
    };
 
@@ -123,7 +123,7 @@ namespace sigen {
       SSUScanLinkageDesc(ui16 xs_id, ui16 onid, ui16 sid, TableType t_type)
          : LinkageDesc(LinkageDesc::TS_SSU_BAT_OR_NIT, xs_id, onid, sid),
          table_type(t_type)
-      { }
+      { incLength( sizeof(table_type) ); }
       SSUScanLinkageDesc() = delete;
 
       virtual void buildSections(Section&) const;
@@ -218,7 +218,7 @@ namespace sigen {
       std::vector<ui8> private_data;
 
       // descriptor OUI list
-      std::list<OUIData> oui_list;
+      LoopList<OUIData> oui_list;
 
       bool addOUI(ui32 oui, ui8 upd_type, bool uvf, ui8 uv, const std::vector<ui8>& sel_bytes);
 
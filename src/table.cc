@@ -23,10 +23,18 @@
 #include <iostream>
 #include <list>
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <sstream>
+#include <vector>
+#include <stdexcept>
 #include "types.h"
 #include "table.h"
 #include "descriptor.h"
 #include "tstream.h"
+#include "bit_layout.h"
+#include "item_writer.h"
+#include "thread_pool.h"
 
 namespace sigen
 {
@@ -55,7 +63,7 @@ namespace sigen
    void STable::DescList::buildSections(Section &s) const
    {
       for (const std::unique_ptr<Descriptor>& dp : d_list)
-         (*dp).buildSections(s);
+         (*dp).encode(s);
    }
 
 
@@ -89,6 +97,16 @@ namespace sigen
    }
 
 
+   //
+   // build ids come from a single counter so they're never reused,
+   // even by another table
+   void STable::newBuild() const
+   {
+      static std::atomic<ui64> last_build_id(0);
+      build_id = ++last_build_id;
+   }
+
+
    //
    // displays table fields
    //
@@ -144,79 +162,150 @@ namespace sigen
 
 
    //
-   // controls the sectionable table building.. calls the virtual function
-   // writeSection() which defines how each table is written.. this function
-   // simply allocates space, calls for the write, writes the total length
-   // of the section (returned by writeSection() and crc's it
+   // controls the sectionable table building.. the sections are
+   // planned first from the tracked lengths, so last_section_number
+   // and each section's length are known before anything is written.
+   // Each one is then allocated once at its exact size, written by the
+   // virtual function writeSection() which defines how each table is
+   // written, and crc'd
    //
    void PSITable::buildSections(TStream &strm) const
    {
-      enum State_t { MALLOC_SEC, WRITE_SEC, END_TABLE };
-
-      bool done = false;
-      ui8 cur_sec = 0;
-      ui16 sec_bytes = 0;
-      State_t state = MALLOC_SEC;
-
-      Section *s = nullptr;
-      // this table's sections
-      std::list<Section *> table_sections;
-
-      // add each field while it still fits in this section
-      while (!done)
-      {
-         switch (state)
-         {
-           case MALLOC_SEC:
-              s = strm.getNewSection(getMaxSectionLen());
-
-              // add it to the temp link list - we will need to
-              // adjust some fields once we're all done with all sections
-              table_sections.push_back( s );
-
-              state = WRITE_SEC;
-              break;
-
-           case WRITE_SEC:
-              // write as much data as we can to this section
-              if (writeSection(*s, cur_sec, sec_bytes))
-                 state = END_TABLE;
-              else {
-                 // writeSection() returned 'false' which means it is not done
-                 // so we increment the section count
-                 cur_sec++;
-                 state = MALLOC_SEC;
-              }
-              // update the section's length with the count that was added
-              s->set16Bits(1, buildLengthData(sec_bytes) + 4);
-              break;
-
-           case END_TABLE:
-              // done with the table.. update the last_section field
-              // in all the sections
-              for (auto sp : table_sections) {
-                 sp->set08Bits(7, cur_sec); // save the last_section_number
-                 sp->calcCrc();             // crc the section
-              }
-              done = true;
-              break;
-         }
+      BUILD_STAT( BuildStats::Scope stats_scope(build_stats) );
+      newBuild();
+
+      planSections(build_plan);
+
+      ui8 last_sec = build_plan.size() - 1;
+      for (size_t i = 0; i < build_plan.size(); i++)
+         buildPlannedSection(strm, i, last_sec);
+   }
+
+
+   //
+   // the iterator's version of the above
+   //
+   ui16 PSITable::startBuild() const
+   {
+      newBuild();
+      BUILD_STAT( build_stats = BuildStats() );
+
+      planSections(build_plan);
+      return build_plan.size();
+   }
+
+   void PSITable::buildSection(TStream &strm, ui8 sec_num, ui8 last_sec_num) const
+   {
+      buildPlannedSection(strm, sec_num, last_sec_num);
+   }
+
+   //
+   // as above, but once the sections are planned they're allocated
+   // here (the stream isn't thread-safe) and each thread writes a run
+   // of consecutive ones with its own writer, started at the first
+   // one's planned start
+   //
+   void PSITable::buildSections(TStream &strm, ThreadPool &pool) const
+   {
+      if (pool.size() == 1 || !sectionWriter(SectionStart())) {
+         buildSections(strm);
+         return;
       }
+
+      BUILD_STAT( BuildStats::Scope stats_scope(build_stats) );
+      newBuild();
+
+      planSections(build_plan);
+
+      std::size_t count = build_plan.size();
+      std::vector<Section*> sections;
+      sections.reserve(count);
+      for (const PlannedSection &ps : build_plan)
+         sections.push_back( strm.getNewSection(getMaxSectionLen(),
+                                                ps.length + 3 + Section::CRC_LEN) );
+
+      ui8 last_sec = count - 1;
+      std::size_t runs = std::min<std::size_t>(pool.size(), count);
+      pool.run(runs, [&](std::size_t r) {
+            std::size_t first = count * r / runs, end = count * (r + 1) / runs;
+            SectionWriter write = sectionWriter(build_plan[first].start);
+
+            for (std::size_t i = first; i < end; i++) {
+               ui16 sec_bytes;
+               bool done = write(*sections[i], i, sec_bytes);
+               completeSection(*sections[i], i, last_sec, sec_bytes, done);
+            }
+         });
+
+      BUILD_STAT( for (const Section *s : sections) build_stats.record(*s) );
+   }
+
+
+   //
+   // builds one complete section in a buffer of its planned length
+   //
+   void PSITable::buildPlannedSection(TStream &strm, ui8 sec_num, ui8 last_sec_num) const
+   {
+      ui16 sec_bytes;
+      Section *s = strm.getNewSection(getMaxSectionLen(),
+                                      build_plan[sec_num].length + 3 + Section::CRC_LEN);
+
+      bool done = writeSection(*s, sec_num, sec_bytes);
+      completeSection(*s, sec_num, last_sec_num, sec_bytes, done);
+      BUILD_STAT( build_stats.record(*s) );
+   }
+
+   //
+   // a section that didn't come out as planned means the tracked
+   // lengths are wrong (e.g., a descriptor's length() doesn't match
+   // what it writes), so the rest of the table can't be trusted either
+   //
+   void PSITable::completeSection(Section &s, ui8 sec_num, ui8 last_sec_num,
+                                  ui16 sec_bytes, bool done) const
+   {
+      if (sec_bytes != build_plan[sec_num].length || done != (sec_num == last_sec_num)) {
+         std::stringstream err;
+         err << "Table 0x" << std::hex << static_cast<int>(getId()) << std::dec
+             << " section " << static_cast<int>(sec_num) << " was written with "
+             << sec_bytes << " bytes, planned " << build_plan[sec_num].length;
+         throw std::length_error(err.str());
+      }
+
+      // update the section's length with the count that was added
+      s.set16Bits(1, buildLengthData(sec_bytes) + 4);
+      s.set08Bits(7, last_sec_num); // save the last_section_number
+      s.calcCrc();                  // crc the section
+   }
+
+   //
+   // writeSection() keeps its place in the table between calls, so
+   // the rest of the sections are run through to reset it
+   //
+   void PSITable::cancelBuild(ui8 sec_num) const
+   {
+      Section scratch(getMaxSectionLen());
+      ui16 sec_bytes;
+      while (!writeSection(scratch, sec_num++, sec_bytes))
+         scratch.clear();
    }
 
 
    //
    // writes the table_id_extension, and reserved | version | current_next
    // bytes
-   void PSITable::writeSectionHeader(Section &s) const
+   void PSITable::writeSectionHeader(Section &s, ui8 section_number, ui8 last_section_number) const
    {
-      STable::buildSections(s);
-
-      // private table data
-      s.set16Bits( table_id_extension );
-      s.set08Bits( rbits(0xc0) |
-                   version_number << 1 |
-                   current_next_indicator );
+      // table_id, section_syntax_indicator..section_length (as
+      // STable::buildSections()), then the private table data
+      BitLayout<8, 16, 16, 2, 5, 1, 8, 8>::write(s,
+                                                 getId(),
+                                                 buildLengthData(getDataLength()),
+                                                 table_id_extension,
+                                                 rbits(0x3),
+                                                 version_number,
+                                                 current_next_indicator,
+                                                 section_number,
+                                                 last_section_number);
    }
 
 #ifdef ENABLE_DUMP
@@ -240,14 +329,33 @@ namespace sigen
    // ExtPSITable destructor
    ExtPSITable::~ExtPSITable()
    {
-      for (auto l : items)
+      for (auto& l : items)
          for (auto item : l)
             delete item;
    }
 
+   //
+   // checks the length of a batch of items once and makes room for
+   // them
+   bool ExtPSITable::reserveItems(ItemList& list, size_t count, ui16 item_len)
+   {
+      if (count > MAX_TABLE_LEN || !incLength(count * item_len))
+         return false;
+
+      list.reserve(list.size() + count);
+      return true;
+   }
+
+   void ExtPSITable::duplicateError(const char* what, ui16 id)
+   {
+      std::stringstream err;
+      err << "Attempt to add duplicate " << what << " " << std::hex << id;
+      throw std::range_error(err.str());
+   }
+
    //
    // returns the pointer to the item if found; nullptr otherwise
-   ExtPSITable::ListItem* ExtPSITable::find(const std::list<ListItem*>& item_list, ui16 id)
+   ExtPSITable::ListItem* ExtPSITable::find(const ItemList& item_list, ui16 id)
    {
       auto item = std::find_if(item_list.begin(), item_list.end(),
                                [=](auto& item) { return item->equals(id); });
@@ -259,7 +367,7 @@ namespace sigen
 
    //
    // adds a descriptor to the last item added to the list
-   bool ExtPSITable::addItemDesc(std::list<ListItem*>& list, Descriptor& d)
+   bool ExtPSITable::addItemDesc(ItemList& list, Descriptor& d)
    {
       if (list.empty())
          return false;
@@ -269,7 +377,7 @@ namespace sigen
 
    //
    // adds a descriptor to the item matching the given id
-   bool ExtPSITable::addItemDesc(std::list<ListItem*>& list, ui16 id, Descriptor& d)
+   bool ExtPSITable::addItemDesc(ItemList& list, ui16 id, Descriptor& d)
    {
       ListItem* item = find(list, id);
       if (!item)
@@ -291,81 +399,192 @@ namespace sigen
    }
 
    //
-   // write section data for the item
-   bool ExtPSITable::ListItem::write_section(Section& section, ui16 max_data_len,
-                                             ui16& sec_bytes, ui16* loop_len_ptr) const
+   // plans the items in order or, if it saves sections or bytes, packed
+   void ExtPSITable::planItems(SectionPlanner& p, const ItemList& list) const
+   {
+      auto plan_run = [](SectionPlanner& p, const ItemList& order,
+                         const std::vector<size_t>& breaks) {
+         auto b = breaks.begin();
+         for (size_t i = 0; i < order.size(); i++) {
+            if (b != breaks.end() && *b == i) {
+               p.atItem(i);
+               p.next();
+               ++b;
+            }
+            order[i]->plan_section(p, i);
+         }
+      };
+
+      use_packed = false;
+      if (packing == PACK_IN_ORDER) {
+         plan_run(p, list, {});
+         return;
+      }
+      if (packing == PACK_STABLE) {
+         std::vector<size_t> breaks = packItems(p, list);
+         use_packed = true;
+         plan_run(p, packed, breaks);
+         return;
+      }
+
+      // try both from here and keep the smaller
+      std::vector<size_t> breaks = packItems(p, list);
+      SectionPlan in_order, fitted;
+      SectionPlanner o(in_order, p), f(fitted, p);
+      plan_run(o, list, {});
+      plan_run(f, packed, breaks);
+      o.finish();
+      f.finish();
+
+      auto bytes = [](const SectionPlan& plan) {
+         size_t n = 0;
+         for (const auto& s : plan)
+            n += s.length;
+         return n;
+      };
+      use_packed = (fitted.size() < in_order.size() ||
+                    (fitted.size() == in_order.size() && bytes(fitted) < bytes(in_order)));
+
+      if (use_packed)
+         plan_run(p, packed, breaks);
+      else
+         plan_run(p, list, {});
+   }
+
+   //
+   // first or best fit of the whole items, largest first, into the
+   // section p is on and new ones. Items too large for a section get
+   // sections of their own to be split across. Each section's items
+   // are then put back in their list order.
+   //
+   // PACK_STABLE instead puts each item back in the section it was
+   // last planned in. Only items that no longer fit there, and new
+   // ones, are placed anew, in list order, leaving the slack free
+   // where they can. A new section changes the last_section_number of
+   // all, so once laid out they're squeezed into the slack first
+   std::vector<size_t> ExtPSITable::packItems(const SectionPlanner& p, const ItemList& list) const
    {
-      ui8 header_len;
-      ui8* desc_loop_len_pos = 0;
-      ui16 d_len, desc_loop_len = 0;
-      bool exit = false, done = false;
-
-      while (!exit)
-      {
-         switch (run.op_state)
-         {
-           case INIT:
-              // set the descriptor iterator
-              run.d_iter = descriptors.begin();
-              run.op_state = WRITE_HEAD;
-
-           case WRITE_HEAD:
-              header_len = write_header(section) + 2;
-
-              // save the position for the desc loop len.. we'll update it later
-              desc_loop_len_pos = section.getCurDataPosition();
-              section.set16Bits( 0 );
-
-              // increment the byte count
-              sec_bytes += header_len;
-              if (loop_len_ptr)
-                 *loop_len_ptr += header_len;
-
-              run.op_state = (!run.d ? GET_DESC : WRITE_DESC);
-              break;
-
-           case GET_DESC:
-              // if we have descriptors available..
-              if (run.d_iter != descriptors.end()) {
-                 run.d = (*run.d_iter++).get();
-
-                 // make sure we can fit the next one
-                 if ( (sec_bytes + run.d->length()) > max_data_len ) {
-                    run.op_state = WRITE_HEAD;
-                    exit = true;
-                    break;
-                 }
-                 run.op_state = WRITE_DESC;
-              }
-              else {
-                 // no more descriptors.. done writing this xport stream,
-                 run = Context();
-                 exit = done = true;
-                 break;
-              }
-              break;
-
-           case WRITE_DESC:
-              run.d->buildSections(section);
-
-              // increment all byte counts
-              d_len = run.d->length();
-              sec_bytes += d_len;
-              if (loop_len_ptr)
-                 *loop_len_ptr += d_len;
-              desc_loop_len += d_len;
-
-              // try to get another one
-              run.op_state = GET_DESC;
-              break;
+      struct Bin {
+         size_t bytes;
+         bool open;
+         std::vector<size_t> items;
+      };
+      const size_t max = p.maxLength(), base = p.baseLength();
+      std::vector<Bin> bins{ { p.used(), true, {} } };
+
+      auto size_of = [&list](size_t i) -> size_t {
+         return list[i]->length() + list[i]->descriptors.loop_length();
+      };
+      auto oversize = [&](size_t i) { return base + size_of(i) > max; };
+
+      // to the first, or the fullest, section it fits in leaving
+      // spare bytes free
+      auto fit = [&](size_t i, size_t spare) {
+         size_t len = size_of(i);
+         Bin* to = nullptr;
+         for (auto& bin : bins) {
+            if (!bin.open || bin.bytes + len + spare > max)
+               continue;
+            if (!to || bin.bytes > to->bytes)
+               to = &bin;
+            if (packing != PACK_BEST_FIT)
+               break;
+         }
+         if (!to)
+            return false;
+         to->bytes += len;
+         to->items.push_back(i);
+         return true;
+      };
+      // or into the spare bytes too if squeeze, rather than a new
+      // section
+      auto place = [&](size_t i, size_t spare, bool squeeze) {
+         if (oversize(i))
+            bins.push_back({ max, false, { i } });
+         else if (!fit(i, spare) && !(squeeze && fit(i, 0)))
+            bins.push_back({ base + size_of(i), true, { i } });
+      };
+
+      if (packing == PACK_STABLE) {
+         // once laid out, a new section would change them all
+         bool squeeze = !layout.empty();
+         std::vector<size_t> moved;
+         for (size_t i = 0; i < list.size(); i++) {
+            auto was = layout.find(list[i]->key());
+            if (was == layout.end()) {
+               moved.push_back(i);
+               continue;
+            }
+            if (was->second >= bins.size())
+               bins.resize(was->second + 1, { base, true, {} });
+
+            Bin& bin = bins[was->second];
+            if (!oversize(i) && bin.open) {
+               bin.bytes += size_of(i);
+               bin.items.push_back(i);
+            }
+            else if (oversize(i) && bin.open && bin.items.empty())
+               bin = { max, false, { i } };
+            else
+               moved.push_back(i);
+         }
+
+         // sections that grew too large give up their last items
+         for (auto& bin : bins) {
+            while (bin.open && bin.bytes > max) {
+               bin.bytes -= size_of(bin.items.back());
+               moved.push_back(bin.items.back());
+               bin.items.pop_back();
+            }
          }
+
+         std::sort(moved.begin(), moved.end());
+         for (size_t i : moved)
+            place(i, packing_slack, squeeze);
+      }
+      else {
+         std::vector<size_t> by_size(list.size());
+         for (size_t i = 0; i < by_size.size(); i++)
+            by_size[i] = i;
+         std::stable_sort(by_size.begin(), by_size.end(),
+                          [&](size_t a, size_t b) { return size_of(a) > size_of(b); });
+
+         for (size_t i : by_size)
+            place(i, 0, false);
       }
-      // write the desc loop length
-      write_desc_loop_len(section, desc_loop_len_pos, desc_loop_len);
 
-      return done;
+      // a break before each section's items but the first, unless
+      // nothing was planned before them
+      std::vector<size_t> breaks;
+      bool started = p.used() > base;
+      packed.clear();
+      packed.reserve(list.size());
+      if (packing == PACK_STABLE)
+         layout.clear();
+
+      for (size_t b = 0; b < bins.size(); b++) {
+         Bin& bin = bins[b];
+         if (bin.items.empty())
+            continue;
+         if (started && b > 0)
+            breaks.push_back(packed.size());
+         started = true;
+
+         std::sort(bin.items.begin(), bin.items.end());
+         for (size_t i : bin.items) {
+            packed.push_back(list[i]);
+            if (packing == PACK_STABLE)
+               layout[list[i]->key()] = b;
+         }
+      }
+      return breaks;
    }
 
+   // the virtual-dispatch writer for items of tables that don't
+   // pass their concrete item type
+   template bool ExtPSITable::ListItem::write_section<ExtPSITable::ListItem>(Section&, ui16, ui16&,
+                                                                             Context&, ui16*) const;
+
    //
    // general case. Some tables will define their own (e.g., SDT, EIT)
    void ExtPSITable::ListItem::write_desc_loop_len(Section& section, ui8* pos, ui16 len) const
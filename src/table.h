@@ -22,16 +22,25 @@
 
 #pragma once
 
+#include <bitset>
+#include <functional>
 #include <memory>
 #include <list>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "types.h"
 #include "dump.h"
+#include "alloc.h"
+#include "build_stats.h"
 
 namespace sigen {
 
    class TStream;
    class Section;
    class Descriptor;
+   class ThreadPool;
 
    /*!
     * \defgroup abstract Abstract base classes
@@ -82,6 +91,10 @@ namespace sigen {
       Table& operator=(const Table&&) = delete;
    };
 
+   // container for the loop entries stored in descriptors
+   template <class T>
+   using LoopList = TrackedList<T, AllocKind::DESC_LOOP>;
+
    /*!
     * \brief Abstract class for tables.
     */
@@ -106,9 +119,26 @@ namespace sigen {
       /*!
        * \brief Write table data to the specified stream.
        * \param stream Stream to write section data to.
+       * \throw std::length_error if a descriptor's length() doesn't
+       * match the data it writes.
        */
       virtual void buildSections(TStream& stream) const = 0;
 
+      /*!
+       * \brief Identifies the last call to buildSections(). Changes
+       * on every build and is unique across all tables, so it can be
+       * used to tell if data derived from a build is still current.
+       * 0 if the table hasn't been built.
+       */
+      ui64 getBuildId() const { return build_id; }
+
+#ifdef ENABLE_BUILD_STATS
+      /*!
+       * \brief Statistics recorded by the last call to buildSections().
+       */
+      const BuildStats& getBuildStats() const { return build_stats; }
+#endif
+
    protected:
       enum {
          LEN_MASK = 0x0fff,
@@ -132,14 +162,22 @@ namespace sigen {
       class DescList
       {
       public:
+         typedef TrackedList<std::unique_ptr<Descriptor>, AllocKind::DESC_NODE> list_type;
+         typedef list_type::const_iterator const_iterator;
+
          void add(Descriptor& d, ui16 data_len);
-         const std::list<std::unique_ptr<Descriptor> >& list() const { return d_list; }
+         const list_type& list() const { return d_list; }
+         // the resource backing the list - emplaced descriptors go
+         // here too
+         std::pmr::memory_resource* resource() const {
+            return d_list.get_allocator().resource;
+         }
          ui16 loop_length() const { return d_length; }
 
          bool empty() const { return d_list.empty(); }
          const std::unique_ptr<Descriptor>& front() const { return d_list.front(); }
-         std::list<std::unique_ptr<Descriptor> >::const_iterator begin() const { return d_list.begin(); }
-         std::list<std::unique_ptr<Descriptor> >::const_iterator end() const { return d_list.end(); }
+         const_iterator begin() const { return d_list.begin(); }
+         const_iterator end() const { return d_list.end(); }
 
          // only writes data loop - not length as it depends on the table
          void buildSections(Section& s) const;
@@ -150,15 +188,44 @@ namespace sigen {
 
       private:
          ui16 d_length = 0;
-         std::list<std::unique_ptr<Descriptor> > d_list;
+         list_type d_list;
       };
 
+      // constructs a T in the resource r and passes it to add(),
+      // which checks its length once. If add() refuses it, it is
+      // deleted here instead of leaking
+      template <class T, class Add, class... Args>
+      static bool emplaceWith(std::pmr::memory_resource* r, Add add, Args&&... args) {
+         static_assert(std::is_base_of<Descriptor, T>::value, "T must be a Descriptor");
+
+         std::unique_ptr<T> d( new (r) T(std::forward<Args>(args)...) );
+         if (!add(*d))
+            return false;
+
+         d.release(); // owned by the table now
+         return true;
+      }
+
       // used by the derived tables to check for available space for data
       virtual ui16 getMaxDataLen() const { return max_section_length - 3; }
 
       void buildSections(Section& s) const;
       ui16 buildLengthData(ui16) const;
 
+      // assigns a new build id - called at the start of each
+      // buildSections(TStream&)
+      void newBuild() const;
+
+      // resumable build, used by SectionIterator: startBuild()
+      // returns the number of sections the table will be built as, or
+      // 0 if it can only be built whole, then buildSection() is called
+      // for each section in order. cancelBuild() is called instead if
+      // the iteration stops before sec_num, the next section
+      friend class SectionIterator;
+      virtual ui16 startBuild() const { return 0; }
+      virtual void buildSection(TStream&, ui8, ui8) const { }
+      virtual void cancelBuild(ui8) const { }
+
       bool lengthFits(ui32 l) const {
          return (static_cast<ui32>(length) + l < MAX_TABLE_LEN);
       }
@@ -168,6 +235,11 @@ namespace sigen {
       virtual void dumpHeader(std::ostream& o, STRID) const;
 #endif
 
+#ifdef ENABLE_BUILD_STATS
+      // reset by each buildSections() call
+      mutable BuildStats build_stats;
+#endif
+
    private:
       ui16 max_section_length;        // the maximum length of each sub-section
                                       // (specified by the class' MAX_SEC_LEN)
@@ -177,6 +249,7 @@ namespace sigen {
 
       ui16 length;                    // data length (not including CRC and
                                       // 3-byte header)
+      mutable ui64 build_id = 0;      // see getBuildId()
    };
 
 
@@ -190,7 +263,16 @@ namespace sigen {
    {
    public:
       virtual void buildSections(TStream& ts) const;
+      /*!
+       * \brief Builds the sections as buildSections(TStream&), writing
+       * and crc'ing them on the pool's threads. Worthwhile for tables
+       * of many sections. The output is the same.
+       * \param ts Stream to add the sections to.
+       * \param pool Threads to write the sections on.
+       */
+      void buildSections(TStream& ts, ThreadPool& pool) const;
 
+      ui16 getTableIdExtension() const { return table_id_extension; }
       ui8 getVersionNumber() const { return version_number; }
       ui8 getCurrentNextIndicator() const { return current_next_indicator; }
 
@@ -211,9 +293,100 @@ namespace sigen {
       // utility
       virtual ui16 getMaxDataLen() const;
 
-      void writeSectionHeader(Section& s) const;
+      // writes the 8-byte section header up to and including
+      // last_section_number
+      void writeSectionHeader(Section& s, ui8 section_number, ui8 last_section_number) const;
       virtual bool writeSection(Section& s, ui8, ui16& l) const = 0;
 
+      // where a section starts: at the first of the table's
+      // descriptors and items it holds or, for an item continued
+      // from the previous section, at the item's descriptor it
+      // continues with
+      struct SectionStart {
+         DescList::const_iterator desc;
+         size_t item = 0;
+         bool split = false;
+         DescList::const_iterator item_desc;
+      };
+
+      // each section's data length (as counted by writeSection(): from
+      // table_id_extension, without the CRC) and start
+      struct PlannedSection {
+         ui16 length;
+         SectionStart start;
+      };
+      typedef std::vector<PlannedSection> SectionPlan;
+
+      // works out where each section starts and ends, following the
+      // same rules as the writeSection()s, from the lengths tracked as
+      // items and descriptors are added. Nothing is written. The table
+      // keeps the position up to date with atDesc() / atItem() as it
+      // goes, for where the next section would start
+      class SectionPlanner
+      {
+      public:
+         SectionPlanner(SectionPlan& p, ui16 base_len, ui16 max_len,
+                        DescList::const_iterator first_desc = DescList::const_iterator())
+            : plan(p), base(base_len), max(max_len), bytes(base_len) {
+            plan.clear();
+            at.desc = first_desc;
+            plan.push_back({ 0, at });
+         }
+         // plans into p from where other is, to try out alternatives
+         SectionPlanner(SectionPlan& p, const SectionPlanner& other)
+            : plan(p), base(other.base), max(other.max), bytes(other.bytes), at(other.at) {
+            plan.clear();
+            plan.push_back({ 0, at });
+         }
+
+         void atDesc(DescList::const_iterator d) { at.desc = d; }
+         void atItem(size_t i) { at.item = i; at.split = false; }
+         // the item at atItem() continues at descriptor d
+         void atItemDesc(DescList::const_iterator d) { at.split = true; at.item_desc = d; }
+
+         bool fits(ui16 len) const { return bytes + len <= max; }
+         ui16 baseLength() const { return base; }
+         ui16 maxLength() const { return max; }
+         // bytes in the section so far
+         ui16 used() const { return bytes; }
+         // adds len bytes to this section, even if they don't fit
+         void put(ui16 len) { bytes += len; }
+         // adds len bytes, to a new section if they don't fit
+         void add(ui16 len) {
+            if (!fits(len))
+               next();
+            put(len);
+         }
+         // ends the section
+         void next() {
+            plan.back().length = bytes;
+            plan.push_back({ 0, at });
+            bytes = base;
+         }
+         void finish() { plan.back().length = bytes; }
+
+      private:
+         SectionPlan& plan;
+         ui16 base, max, bytes;
+         SectionStart at;
+      };
+
+      virtual void planSections(SectionPlan& plan) const = 0;
+      // the data length planned for section sec_num by the current
+      // build. The writers end each section there
+      ui16 getPlannedDataLen(ui8 sec_num) const { return build_plan[sec_num].length; }
+
+      // writes the sections in order from the given start, with its
+      // own state so several can write the same table at once. Tables
+      // that don't support it return an empty writer
+      typedef std::function<bool (Section&, ui8, ui16&)> SectionWriter;
+      virtual SectionWriter sectionWriter(const SectionStart&) const { return SectionWriter(); }
+
+      // plans the sections, for the iterator to build each one
+      virtual ui16 startBuild() const;
+      virtual void buildSection(TStream& strm, ui8 sec_num, ui8 last_sec_num) const;
+      virtual void cancelBuild(ui8 sec_num) const;
+
 #ifdef ENABLE_DUMP
       virtual void dumpHeader(std::ostream& o, STRID table_label, STRID ext_label) const;
 #endif
@@ -222,6 +395,14 @@ namespace sigen {
       ui16 table_id_extension;        // id extension for private tables
       ui8 version_number : 5;         // ver_num (5)
       bool current_next_indicator;    // cur_next (1)
+      mutable SectionPlan build_plan; // of the last (or current) build
+
+      // allocates the section at its planned length and writes it
+      void buildPlannedSection(TStream& strm, ui8 sec_num, ui8 last_sec_num) const;
+      // sets the length and last_section_number of a written section
+      // and crc's it
+      void completeSection(Section& s, ui8 sec_num, ui8 last_sec_num,
+                           ui16 sec_bytes, bool done) const;
    };
 
    //
@@ -231,7 +412,49 @@ namespace sigen {
    public:
       virtual ~ExtPSITable();
 
+      /*!
+       * \brief How the table's items (services, transport streams,
+       * elementary streams) are packed into sections.
+       */
+      enum Packing {
+         PACK_IN_ORDER,  //!< In the order added, splitting an item's descriptors across sections when it doesn't fit (default)
+         PACK_FIRST_FIT, //!< Whole items, largest first, each to the first section with room
+         PACK_BEST_FIT,  //!< Whole items, largest first, each to the fullest section with room
+         PACK_STABLE     //!< Whole items, each kept in the section it was last built in
+      };
+
    protected:
+      /*!
+       * \brief Sets how the items are packed into sections. Made
+       * public by the SDT, NIT/BAT and PMT - the EIT writes its
+       * sections its own way.
+       *
+       * The fit policies only split items larger than a section, and
+       * keep the table's own descriptors first and the items in their
+       * added order within each section. A packing is only used if it
+       * takes fewer sections, or fewer bytes, than PACK_IN_ORDER.
+       * Services and transport streams may be carried in any section,
+       * so SDT and NIT/BAT receivers are unaffected. A PMT's
+       * elementary streams can end up in a different order, which
+       * receivers relying on it may not expect.
+       *
+       * PACK_STABLE is for tables rebuilt as they change: an item
+       * stays in its section while it fits there, so an edit to one
+       * item changes one section rather than every one after it. New
+       * items, and those that outgrow their section, go to the first
+       * section with slack bytes to spare. It is used even if it
+       * takes more sections than PACK_IN_ORDER.
+       * \param p Packing policy.
+       * \param slack Bytes PACK_STABLE leaves free in each section
+       * it fills, for its items to grow into.
+       */
+      void setPacking(Packing p, ui16 slack = 0) {
+         packing = p;
+         packing_slack = slack;
+         layout.clear();
+      }
+      Packing getPacking() const { return packing; }
+
       ExtPSITable(ui8 size, ui8 tid, ui16 tid_ext, ui8 min_len, ui16 max_sec_len,
                   ui8 ver, bool cni, bool data_bit = true)
          : PSITable(tid, tid_ext, min_len, max_sec_len, ver, cni, data_bit),
@@ -242,41 +465,112 @@ namespace sigen {
       struct ListItem : public STable::ListItem {
          virtual ~ListItem() {}
 
+         SIGEN_TRACKED_NEW(AllocKind::TABLE_ITEM)
+
          DescList descriptors;
 
          virtual ui16 length() const = 0;
-         virtual bool equals(ui16 id) const = 0;
-
-         // controls the state machine for writing the loop's section data
-         bool write_section(Section& sec, ui16 max_data_len, ui16& sec_bytes,
-                            ui16* item_loop_len = nullptr) const;
-         // writes item header bytes, returns num bytes written
-         virtual ui8 write_header(Section& sec) const = 0;
-         // writes the 2-byte desc loop len
-         virtual void write_desc_loop_len(Section& sec, ui8* pos, ui16 len) const;
+         // the id that identifies the item in its list
+         virtual ui16 key() const = 0;
+         bool equals(ui16 id) const { return key() == id; }
 
-      protected:
-         // section building state tracking
+         // section building state tracking. Kept by the table's writer
+         // as an item may be continued in the next section
          enum State_t { INIT, WRITE_HEAD, GET_DESC, WRITE_DESC };
-         mutable struct Context {
+         struct Context {
             Context() : op_state(INIT), d(nullptr) {}
+            // continues the item at descriptor from
+            Context(DescList::const_iterator from) :
+               op_state(WRITE_HEAD), d(from->get()), d_iter(std::next(from)) {}
 
             State_t op_state;
             const Descriptor* d;
-            std::list<std::unique_ptr<Descriptor> >::const_iterator d_iter;
-         } run;
+            DescList::const_iterator d_iter;
+         };
+
+         // controls the state machine for writing the loop's section
+         // data. Tables pass their final item type to call its header
+         // writers directly (see item_writer.h)
+         template <class Item = ListItem>
+         bool write_section(Section& sec, ui16 max_data_len, ui16& sec_bytes, Context& run,
+                            ui16* item_loop_len = nullptr) const;
+         // the item's share of the sections, as write_section() would
+         // split it (see item_writer.h). index is its place in its list
+         void plan_section(SectionPlanner& p, size_t index) const;
+         // writes item header bytes, returns num bytes written
+         virtual ui8 write_header(Section& sec) const = 0;
+         // writes the 2-byte desc loop len
+         virtual void write_desc_loop_len(Section& sec, ui8* pos, ui16 len) const;
       };
 
-      static bool contains(const std::list<ListItem*>& list, ui16 id) {
+      // the table's loop entries
+      typedef TrackedVector<ListItem*, AllocKind::TABLE_ITEM> ItemList;
+
+      static bool contains(const ItemList& list, ui16 id) {
          return (nullptr != ExtPSITable::find(list, id));
       }
-      static ListItem* find(const std::list<ListItem*>& list, ui16 id);
-      bool addItemDesc(std::list<ListItem*>& list, Descriptor& desc);
-      bool addItemDesc(std::list<ListItem*>& list, ui16 id, Descriptor& desc);
+      static ListItem* find(const ItemList& list, ui16 id);
+      bool addItemDesc(ItemList& list, Descriptor& desc);
+      bool addItemDesc(ItemList& list, ui16 id, Descriptor& desc);
+
+      // batch inserts: checks the aggregate length of count items of
+      // item_len bytes once and, if it fits, reserves room for them
+      // in the list. Nothing is changed if they don't fit
+      bool reserveItems(ItemList& list, size_t count, ui16 item_len);
+
+      // checks a batch of new items' ids against the list and each
+      // other in a single pass. Throws std::range_error on the first
+      // duplicate, like the single-item routines
+      template <class Spec, class Key>
+      static void checkDuplicates(const ItemList& list, const Spec* specs, size_t count,
+                                  Key key_of, const char* what) {
+         std::bitset<0x10000> seen;
+         for (const ListItem* item : list)
+            seen.set(item->key());
+
+         for (size_t i = 0; i < count; i++) {
+            ui16 id = key_of(specs[i]);
+            if (seen.test(id))
+               duplicateError(what, id);
+            seen.set(id);
+         }
+      }
+      [[noreturn]] static void duplicateError(const char* what, ui16 id);
+
+      // constructs a descriptor in the last item's storage
+      template <class T, class... Args>
+      bool emplaceItemDesc(ItemList& list, Args&&... args) {
+         if (list.empty())
+            return false;
+
+         ListItem* item = list.back();
+         return emplaceWith<T>(item->descriptors.resource(),
+                               [this, item](Descriptor& d) { return addItemDesc(item, d); },
+                               std::forward<Args>(args)...);
+      }
 
-      std::vector<std::list<ListItem*> > items;
+      // plans list's items after what p has planned so far, as set
+      // by setPacking()
+      void planItems(SectionPlanner& p, const ItemList& list) const;
+      // the order the writers take list's items in, as last planned
+      const ItemList& writeOrder(const ItemList& list) const {
+         return use_packed ? packed : list;
+      }
+
+      std::vector<ItemList> items;
    private:
+      Packing packing = PACK_IN_ORDER;
+      ui16 packing_slack = 0;
+      mutable ItemList packed;        // the packed order, if used
+      mutable bool use_packed = false;
+      // PACK_STABLE: the section each item was last planned in, by
+      // key, counted from the first section items can go in
+      mutable std::unordered_map<ui16, size_t> layout;
+
       bool addItemDesc(ListItem* item, Descriptor& d);
+      // packs list into packed, returning the positions that start a
+      // new section
+      std::vector<size_t> packItems(const SectionPlanner& p, const ItemList& list) const;
    };
 
    //! @}
@@ -33,6 +33,8 @@ namespace sigen
    //
    void TDT::buildSections(TStream &strm) const
    {
+      BUILD_STAT( BuildStats::Scope stats_scope(build_stats) );
+      newBuild();
       Section *s = strm.getNewSection( getMaxSectionLen() );
 
       STable::buildSections(*s);
@@ -41,6 +43,8 @@ namespace sigen
       s->set08Bits( utc.time.getBCDHour() );
       s->set08Bits( utc.time.getBCDMinute() );
       s->set08Bits( utc.time.getBCDSecond() );
+      BUILD_STAT( build_stats.record(*s) );
+      strm.shrinkToFit(*s);
    }
 
    //
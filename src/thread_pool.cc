@@ -0,0 +1,118 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// thread_pool.cc: a fixed set of threads to run jobs in parallel
+// -----------------------------------
+
+#include <algorithm>
+#include "thread_pool.h"
+
+namespace sigen
+{
+   ThreadPool::ThreadPool(unsigned threads)
+   {
+      if (threads == 0)
+         threads = std::max(1u, std::thread::hardware_concurrency());
+
+      for (unsigned i = 1; i < threads; i++)
+         workers.emplace_back(&ThreadPool::work, this);
+   }
+
+   ThreadPool::~ThreadPool()
+   {
+      {
+         std::lock_guard<std::mutex> l(lock);
+         stopping = true;
+      }
+      start.notify_all();
+      for (std::thread &t : workers)
+         t.join();
+   }
+
+   //
+   // jobs are handed out one at a time by number, so threads that
+   // finish early take more of them
+   //
+   void ThreadPool::run(std::size_t n, const std::function<void (std::size_t)> &job)
+   {
+      if (n == 0)
+         return;
+
+      std::lock_guard<std::mutex> serialize(run_lock);
+      std::unique_lock<std::mutex> l(lock);
+      cur_job = &job;
+      count = pending = n;
+      next = 0;
+      generation++;
+      if (n > 1)
+         start.notify_all();
+
+      runJobs(l);
+      finished.wait(l, [this] { return pending == 0; });
+      cur_job = nullptr;
+
+      if (failure) {
+         std::exception_ptr e = nullptr;
+         std::swap(e, failure);
+         std::rethrow_exception(e);
+      }
+   }
+
+   void ThreadPool::runJobs(std::unique_lock<std::mutex> &l)
+   {
+      while (next < count) {
+         std::size_t i = next++;
+         const std::function<void (std::size_t)> &job = *cur_job;
+
+         l.unlock();
+         std::exception_ptr e;
+         try {
+            job(i);
+         }
+         catch (...) {
+            e = std::current_exception();
+         }
+         l.lock();
+
+         if (e && !failure)
+            failure = e;
+
+         if (--pending == 0)
+            finished.notify_all();
+      }
+   }
+
+   //
+   // worker threads wait for each run() to start
+   //
+   void ThreadPool::work()
+   {
+      std::unique_lock<std::mutex> l(lock);
+      unsigned seen = generation;
+      while (true) {
+         start.wait(l, [&] { return stopping || generation != seen; });
+         if (stopping)
+            return;
+
+         seen = generation;
+         runJobs(l);
+      }
+   }
+
+} // namespace
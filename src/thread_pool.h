@@ -0,0 +1,100 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// thread_pool.h: a fixed set of threads to run jobs in parallel
+// -----------------------------------
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sigen {
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \brief A fixed set of threads that run numbered jobs in
+    * parallel, e.g., to write the sections of large tables:
+    *
+    * \code
+    *    ThreadPool pool;
+    *    nit.buildSections(t, pool);
+    * \endcode
+    *
+    * The threads are started by the constructor and wait for work
+    * until the pool is destroyed.
+    */
+   class ThreadPool
+   {
+   public:
+      /*!
+       * \brief Constructor.
+       * \param threads Number of threads jobs run on, including the
+       * one calling run(). 0 uses one per hardware thread.
+       */
+      explicit ThreadPool(unsigned threads = 0);
+      ~ThreadPool();
+
+      ThreadPool(const ThreadPool &) = delete;
+      ThreadPool &operator=(const ThreadPool &) = delete;
+
+      //! \brief Number of threads jobs run on.
+      unsigned size() const { return workers.size() + 1; }
+
+      /*!
+       * \brief Run job(0) to job(count - 1), returning once all are
+       * done. The calling thread runs jobs too. Calls from several
+       * threads run one after another.
+       * \param count Number of jobs.
+       * \param job Function called with each job number. If any
+       * throw, the rest still run and the first exception is
+       * rethrown once all are done.
+       */
+      void run(std::size_t count, const std::function<void (std::size_t)> &job);
+
+   private:
+      std::vector<std::thread> workers;
+
+      std::mutex run_lock;    // held by run() throughout
+      std::mutex lock;        // for the rest
+      std::condition_variable start, finished;
+
+      const std::function<void (std::size_t)> *cur_job = nullptr;
+      std::size_t count = 0, next = 0, pending = 0;
+      std::exception_ptr failure;  // first thrown by the current run
+      unsigned generation = 0;
+      bool stopping = false;
+
+      void work();
+      // runs jobs until there are no more to start. Called with lock
+      // held, which is released while each job runs
+      void runJobs(std::unique_lock<std::mutex> &l);
+   };
+
+   //! @}
+
+} // sigen namespace
@@ -81,6 +81,8 @@ namespace sigen
    //
    void TOT::buildSections(TStream &strm) const
    {
+      BUILD_STAT( BuildStats::Scope stats_scope(build_stats) );
+      newBuild();
       Section *s = strm.getNewSection( getMaxSectionLen() );
 
       STable::buildSections(*s);
@@ -99,6 +101,8 @@ namespace sigen
 
       // crc it
       s->calcCrc();
+      BUILD_STAT( build_stats.record(*s) );
+      strm.shrinkToFit(*s);
    }
 
 } // namespace
@@ -70,6 +70,17 @@ namespace sigen {
        * \param desc Descriptor to add.
        */
       bool addDesc(Descriptor& desc);
+      /*!
+       * \brief Construct a Descriptor of type T in the table's storage and
+       * add it to the descriptors loop.
+       * \param args Arguments forwarded to the T constructor.
+       */
+      template <class T, class... Args>
+      bool emplaceDesc(Args&&... args) {
+         return emplaceWith<T>(descriptors.resource(),
+                               [this](Descriptor& d) { return addDesc(d); },
+                               std::forward<Args>(args)...);
+      }
 
       // section data writer
       virtual void buildSections(TStream &) const;
@@ -0,0 +1,261 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// ts_mux.cc: multiplexes the TS packets of several PIDs
+// -----------------------------------
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "ts_mux.h"
+#include "packetizer.h"
+#include "tstream.h"
+
+namespace sigen
+{
+   namespace ts_mux_priv {
+
+      // the input() of an invalid PID
+      struct RejectSink : public OutputSink {
+         virtual bool write(const ui8 *, std::size_t) { return false; }
+      };
+
+      RejectSink reject;
+   }
+
+   using namespace ts_mux_priv;
+
+   // a PID's queue of packets. Sent packets are skipped, and dropped
+   // when the queue empties or, for queues fed ahead of the mux, once
+   // they're half of it
+   struct TsMux::Stream : public OutputSink
+   {
+      TsMux &mux;
+      std::vector<ui8> data;
+      std::size_t head = 0;  // offset of the next packet to send
+      std::size_t index = 0; // in mux.streams
+      ui16 pid;
+      ui16 weight;
+      ui16 turn = 0;         // packets left in the current turn
+      ui8 priority;
+      ui8 cc;
+
+      Stream(TsMux &m, ui16 p, ui8 pri, ui16 w, ui8 c) :
+         mux(m), pid(p), weight(w), priority(pri), cc(c & 0x0f) {}
+
+      std::size_t size() const { return (data.size() - head) / PACKET_SIZE; }
+
+      virtual bool write(const ui8 *d, std::size_t len) {
+         if (len % PACKET_SIZE)
+            return false;
+
+         // drop what's been sent before growing the queue
+         if (head > 0 && head >= data.size() / 2) {
+            data.erase(data.begin(), data.begin() + head);
+            head = 0;
+         }
+         data.insert(data.end(), d, d + len);
+         mux.total_queued += len / PACKET_SIZE;
+         return true;
+      }
+   };
+
+
+   TsMux::TsMux(OutputSink &o, std::size_t b) :
+      out_buf(std::max<std::size_t>(b, 1) * PACKET_SIZE),
+      out(o),
+      batch(std::max<std::size_t>(b, 1))
+   {
+   }
+
+   TsMux::~TsMux()
+   {
+   }
+
+
+   bool TsMux::addPid(ui16 pid, ui8 priority, ui16 weight, ui8 cc)
+   {
+      if (pid >= MAX_PID)
+         return false;
+
+      if (by_pid.size() <= pid)
+         by_pid.resize(pid + 1, nullptr);
+
+      Stream *s = by_pid[pid];
+      if (!s) {
+         streams.emplace_back(new Stream(*this, pid, priority, std::max<ui16>(weight, 1), cc));
+         s = by_pid[pid] = streams.back().get();
+      }
+      else {
+         s->priority = priority;
+         s->weight = std::max<ui16>(weight, 1);
+         s->turn = std::min(s->turn, s->weight);
+      }
+
+      // keep the levels contiguous, highest first
+      std::stable_sort(streams.begin(), streams.end(),
+                       [](const std::unique_ptr<Stream> &a, const std::unique_ptr<Stream> &b) {
+                          return a->priority > b->priority;
+                       });
+      for (std::size_t i = 0; i < streams.size(); i++)
+         streams[i]->index = i;
+      return true;
+   }
+
+
+   bool TsMux::queue(ui16 pid, const Section &section)
+   {
+      Stream *s = find(pid);
+      if (!s)
+         return false;
+
+      MpgPacketizer(*s, 0).packetize(section, pid);
+      return true;
+   }
+
+   bool TsMux::queue(ui16 pid, const TStream &t)
+   {
+      Stream *s = find(pid);
+      if (!s)
+         return false;
+
+      MpgPacketizer pkt(*s, 0);
+      for (const auto &section : t.section_list)
+         pkt.packetize(*section, pid);
+      return true;
+   }
+
+   OutputSink &TsMux::input(ui16 pid)
+   {
+      Stream *s = find(pid);
+      if (!s) {
+         if (!addPid(pid))
+            return reject;
+         s = find(pid);
+      }
+      return *s;
+   }
+
+
+   std::size_t TsMux::queued(ui16 pid) const
+   {
+      const Stream *s = find(pid);
+      return s ? s->size() : 0;
+   }
+
+   ui8 TsMux::continuityCounter(ui16 pid) const
+   {
+      const Stream *s = find(pid);
+      return s ? s->cc : 0;
+   }
+
+
+   //
+   // the stream to send from: the current one while its turn lasts,
+   // if no higher priority stream has packets, otherwise the next one
+   // with packets in the highest non-empty level
+   TsMux::Stream *TsMux::next()
+   {
+      std::size_t first = 0;
+      while (streams[first]->size() == 0)
+         first++;
+      ui8 level = streams[first]->priority;
+
+      Stream *cur = current;
+      if (cur && cur->priority == level) {
+         if (cur->turn > 0 && cur->size() > 0)
+            return cur;
+
+         // round robin from the one after the current one
+         std::size_t end = first;
+         while (end < streams.size() && streams[end]->priority == level)
+            end++;
+
+         for (std::size_t i = cur->index + 1; i < end; i++) {
+            if (streams[i]->size() > 0) {
+               first = i;
+               break;
+            }
+         }
+      }
+
+      current = streams[first].get();
+      current->turn = current->weight;
+      return current;
+   }
+
+   void TsMux::write(const ui8 *data, std::size_t len)
+   {
+      if (!out.write(data, len))
+         failed = true;
+   }
+
+   std::size_t TsMux::mux(std::size_t max_packets)
+   {
+      std::size_t sent = 0, fill = 0;
+      ui8 *buf = out_buf.data();
+
+      while (sent < max_packets && total_queued > 0) {
+         Stream *s = next();
+         std::size_t n = std::min<std::size_t>({ s->turn, s->size(),
+                                                 max_packets - sent, batch - fill });
+
+         ui8 *p = buf + fill * PACKET_SIZE;
+         std::memcpy(p, s->data.data() + s->head, n * PACKET_SIZE);
+
+         // continuity_counter, counted only on packets with a payload
+         ui8 cc = s->cc;
+         for (std::size_t i = 0; i < n; i++, p += PACKET_SIZE) {
+            if (p[3] & 0x10) {
+               p[3] = (p[3] & 0xf0) | cc;
+               cc = (cc + 1) & 0x0f;
+            }
+            else
+               p[3] = (p[3] & 0xf0) | ((cc - 1) & 0x0f);
+         }
+         s->cc = cc;
+
+         s->head += n * PACKET_SIZE;
+         if (s->head == s->data.size()) {
+            s->data.clear();
+            s->head = 0;
+         }
+         s->turn -= n;
+         total_queued -= n;
+         sent += n;
+
+         fill += n;
+         if (fill == batch) {
+            write(buf, fill * PACKET_SIZE);
+            fill = 0;
+         }
+      }
+
+      if (fill)
+         write(buf, fill * PACKET_SIZE);
+      return sent;
+   }
+
+   bool TsMux::flush()
+   {
+      mux(std::numeric_limits<std::size_t>::max());
+      return out.flush() && !failed;
+   }
+
+} // namespace
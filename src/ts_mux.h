@@ -0,0 +1,164 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// ts_mux.h: multiplexes the TS packets of several PIDs
+// -----------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "types.h"
+#include "output.h"
+
+namespace sigen {
+
+   class Section;
+   class TStream;
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \brief Interleaves the TS packets of several PIDs into one
+    * output, keeping the continuity_counter of each PID.
+    *
+    * An MpgPacketizer has a single continuity_counter, so packets of
+    * several PIDs written through one packetizer don't count
+    * correctly. Instead, each PID is added to the mux, which owns its
+    * counter and a queue of its packets. Packets are queued whole,
+    * either as sections or through the PID's input() sink (e.g., from
+    * a PacketCache), and their counters are set as they're sent:
+    *
+    * \code
+    *    TsMux mux(out);
+    *    mux.addPid(0x00, 2);     // PAT first
+    *    mux.addPid(0x10, 1);
+    *    mux.addPid(0x11, 1);
+    *    mux.addPid(0x12, 0, 4);  // EIT when the rest are empty
+    *
+    *    mux.queue(0x00, pat_sections);
+    *    cache.emit(nit, 0x10, cc, mux.input(0x10));
+    *    ...
+    *    mux.flush();
+    * \endcode
+    *
+    * The next packet sent is taken from the highest priority PID with
+    * packets queued. PIDs of the same priority take turns, sending up
+    * to their weight in packets each turn. Packets are copied to the
+    * output in batches of consecutive packets from each PID and
+    * written with a single call per batch.
+    */
+   class TsMux
+   {
+   public:
+      enum { PACKET_SIZE = 188, MAX_PID = 0x1fff };
+
+      /*!
+       * \brief Constructor.
+       * \param out Sink to write the multiplexed packets to.
+       * \param batch Maximum number of packets per write to the sink.
+       */
+      TsMux(OutputSink &out, std::size_t batch = 64);
+      ~TsMux();
+
+      TsMux(const TsMux &) = delete;
+      TsMux &operator=(const TsMux &) = delete;
+
+      /*!
+       * \brief Add a PID to the mux, or change its policy.
+       * \param pid PID (0 - 0x1ffe).
+       * \param priority PIDs with higher values are sent first.
+       * \param weight Packets sent per turn among PIDs of the same
+       * priority (at least 1).
+       * \param cc Continuity counter of the first packet, if the PID
+       * is new.
+       * \return `false` if the PID is not valid.
+       */
+      bool addPid(ui16 pid, ui8 priority = 0, ui16 weight = 1, ui8 cc = 0);
+
+      /*!
+       * \brief Queue the packets of a section on a PID.
+       * \return `false` if the PID hasn't been added.
+       */
+      bool queue(ui16 pid, const Section &section);
+
+      /*!
+       * \brief Queue the packets of all the sections in a stream on
+       * a PID.
+       * \return `false` if the PID hasn't been added.
+       */
+      bool queue(ui16 pid, const TStream &t);
+
+      /*!
+       * \brief Sink that queues TS packets on a PID.
+       *
+       * Writes to it must be whole packets already carrying the PID;
+       * their continuity_counter is overwritten when they're sent.
+       * The PID is added with the default policy if it hasn't been.
+       * Writes to the sink of an invalid PID fail.
+       */
+      OutputSink &input(ui16 pid);
+
+      /*!
+       * \brief Send queued packets to the output.
+       * \param max_packets Maximum number of packets to send.
+       * \return Number of packets sent.
+       */
+      std::size_t mux(std::size_t max_packets);
+
+      /*!
+       * \brief Send all the queued packets and flush the output.
+       * \return `false` if the output failed.
+       */
+      bool flush();
+
+      //! \brief Number of packets queued on a PID.
+      std::size_t queued(ui16 pid) const;
+      //! \brief Number of packets queued on all PIDs.
+      std::size_t queued() const { return total_queued; }
+      //! \brief Continuity counter of the next packet sent on a PID.
+      ui8 continuityCounter(ui16 pid) const;
+      //! \brief `false` if a write to the output failed.
+      bool good() const { return !failed; }
+
+   private:
+      struct Stream;
+
+      std::vector<std::unique_ptr<Stream> > streams;  // by priority, highest first
+      std::vector<Stream *> by_pid;
+      std::vector<ui8> out_buf;
+      Stream *current = nullptr;
+      OutputSink &out;
+      std::size_t batch;
+      std::size_t total_queued = 0;
+      bool failed = false;
+
+      Stream *find(ui16 pid) const {
+         return pid < by_pid.size() ? by_pid[pid] : nullptr;
+      }
+      Stream *next();
+      void write(const ui8 *data, std::size_t len);
+   };
+
+   //! @}
+
+} // sigen namespace
@@ -21,13 +21,22 @@
 // and transport stream section object.
 // -----------------------------------
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
 #include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <cassert>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <list>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
 #include "dump.h"
 #include "tstream.h"
 #include "language_code.h"
@@ -108,26 +117,145 @@ namespace sigen
          2947551409U, 2876312838U, 2788305887U, 2733848168U,
          3165939309U, 3094707162U, 3040238851U, 2985771188U,
       };
+
+      //
+      // 64-bit hash of the section data, a word at a time. Never 0,
+      // which marks a hash not computed yet
+      inline ui64 mix64(ui64 x)
+      {
+         x ^= x >> 33;
+         x *= 0xff51afd7ed558ccdULL;
+         x ^= x >> 33;
+         x *= 0xc4ceb9fe1a85ec53ULL;
+         return x ^ (x >> 33);
+      }
+
+      inline ui64 hashWord(ui64 h, ui64 w)
+      {
+         h ^= w * 0x87c37b91114253d5ULL;
+         return ((h << 31) | (h >> 33)) * 0x4cf5ad432745937fULL;
+      }
+
+      ui64 hashData(const ui8 *d, std::size_t len)
+      {
+         ui64 h = 0x9e3779b97f4a7c15ULL ^ len, w;
+         std::size_t i = 0;
+         for (; i + sizeof(w) <= len; i += sizeof(w)) {
+            memcpy(&w, d + i, sizeof(w));
+            h = hashWord(h, w);
+         }
+         if (i < len) {
+            w = 0;
+            memcpy(&w, d + i, len - i);
+            h = hashWord(h, w);
+         }
+         h = mix64(h);
+         return h ? h : 1;
+      }
+
+      // MPEG-2 CRC32 of the data
+      ui32 crc32(const ui8 *d, std::size_t len)
+      {
+         ui32 crc_accum = 0xffffffff;
+         for (std::size_t j = 0; j < len; j++) {
+            int i = ( static_cast<int>(crc_accum >> 24) ^ *d++ ) & 0xff;
+            crc_accum = ( crc_accum << 8 ) ^ CrcTable[i];
+         }
+         return crc_accum;
+      }
    }
 
    using namespace tstream_priv;
 
+   // owns a buffer used by several sections
+   struct Section::Shared {
+      std::atomic<ui32> refs;
+      ui16 size;  // of data, as allocated
+      ui8 *data;
+      std::pmr::memory_resource* resource;
+   };
+
    // --------------------------------
    // dvb section class
    //
-   Section::Section(ui16 s) :
-      crc(0), data_length(0), size(s)
+   // the buffer isn't cleared: only the bytes written up to
+   // data_length are ever read back
+   Section::Section(ui16 s, std::pmr::memory_resource* r, ui8 *buffer, ui16 alloc_len) :
+      crc(0), data_length(0), size(s), alloc_size(alloc_len ? alloc_len : s), resource(r)
    {
-      data = new ui8[s];
-      memset(data, 0xff, s);
+      assert( alloc_size <= size );
+      data = buffer ? buffer :
+         static_cast<ui8*>(allocate(AllocKind::SECTION_DATA, alloc_size, resource));
       pos = data;
    }
 
+   Section::Section(Section &&o) noexcept :
+      pos(o.pos), data(o.data), shared(o.shared), hash(o.hash),
+      crc(o.crc), data_length(o.data_length),
+      size(o.size), alloc_size(o.alloc_size), resource(o.resource)
+#ifdef ENABLE_BUILD_STATS
+      , item_count(o.item_count), desc_count(o.desc_count)
+#endif
+   {
+      o.pos = o.data = nullptr;
+      o.shared = nullptr;
+      o.data_length = o.alloc_size = 0;
+   }
+
+   Section &Section::operator=(Section &&o) noexcept
+   {
+      if (this != &o) {
+         release();
+         pos = o.pos;
+         data = o.data;
+         shared = o.shared;
+         hash = o.hash;
+         crc = o.crc;
+         data_length = o.data_length;
+         size = o.size;
+         alloc_size = o.alloc_size;
+         resource = o.resource;
+#ifdef ENABLE_BUILD_STATS
+         item_count = o.item_count;
+         desc_count = o.desc_count;
+#endif
+         o.pos = o.data = nullptr;
+         o.shared = nullptr;
+         o.data_length = o.alloc_size = 0;
+      }
+      return *this;
+   }
+
+   void Section::release()
+   {
+      if (shared) {
+         if (--shared->refs == 0) {
+            std::pmr::memory_resource* r = shared->resource;
+            deallocate(AllocKind::SECTION_DATA, shared->data, shared->size, r);
+            shared->~Shared();
+            deallocate(AllocKind::SECTION, shared, sizeof(Shared), r);
+         }
+         shared = nullptr;
+      }
+      else if (data)
+         deallocate(AllocKind::SECTION_DATA, data, alloc_size, resource);
+      pos = data = nullptr;
+      data_length = alloc_size = 0;
+   }
+
+   void Section::overflow(ui16 len) const
+   {
+      std::stringstream err;
+      err << "Section: writing " << len << " bytes at " << data_length
+          << " overflows its " << alloc_size << " byte buffer";
+      throw std::length_error(err.str());
+   }
+
    // data copiers
    //
    bool Section::set08Bits(ui8 d)
    {
-      assert( lengthFits(sizeof(d)) );
+      checkFits(sizeof(d));
 
       *pos++ = d;
       data_length += sizeof(d);
@@ -136,7 +264,7 @@ namespace sigen
 
    bool Section::set16Bits(ui16 d)
    {
-      assert( lengthFits(sizeof(d)) );
+      checkFits(sizeof(d));
 
       *pos++ = (d >> 8) & 0x00ff;
       *pos++ = d & 0x00ff;
@@ -146,7 +274,7 @@ namespace sigen
 
    bool Section::set24Bits(const ui8 *d)
    {
-      assert( lengthFits(3) );
+      checkFits(3);
 
       *pos++ = d[0];
       *pos++ = d[1];
@@ -157,7 +285,7 @@ namespace sigen
 
    bool Section::set24Bits(const ui32 d)
    {
-      assert( lengthFits(3) );
+      checkFits(3);
 
       // copy the lower 24 bits
       *pos++ = (d >> 16) & 0x000000ff;
@@ -169,7 +297,7 @@ namespace sigen
 
    bool Section::set32Bits(ui32 d)
    {
-      assert( lengthFits(sizeof(d)) );
+      checkFits(sizeof(d));
 
       *pos++ = static_cast<ui8>(d >> 24) & 0xff;
       *pos++ = static_cast<ui8>(d >> 16) & 0xff;
@@ -181,15 +309,9 @@ namespace sigen
 
    //
    // writes a string of data
-   bool Section::setBits(const std::string &data)
+   bool Section::setBits(std::string_view data)
    {
-      assert( lengthFits(data.length()) );
-
-      for (auto c : data)
-         set08Bits(c);
-
-      // don't add length as it is done by set08Bits()
-      return true;
+      return setBits( reinterpret_cast<const ui8 *>(data.data()), data.length() );
    }
 
    //
@@ -200,15 +322,14 @@ namespace sigen
    }
 
    //
-   // writes a sequency of bytes in vector form
-   bool Section::setBits(const std::vector<ui8> &data)
+   // copies a run of bytes. An empty vector's data may be null, which
+   // memcpy() doesn't allow even for no bytes
+   bool Section::setBits(const ui8 *d, ui16 len)
    {
-      assert( lengthFits(data.size()) );
-
-      for (ui8 byte : data)
-         set08Bits(byte);
+      if (len == 0)
+         return true;
 
-      // don't add length as it is done by set08Bits()
+      memcpy(reserve(len), d, len);
       return true;
    }
 
@@ -216,7 +337,7 @@ namespace sigen
    // these don't increment the cur position
    bool Section::set08Bits(ui8 idx, ui8 d)
    {
-      if (idx > size) {
+      if (idx >= alloc_size) {
          std::cerr << "Section::set08Bits(ui8, ui8): invalid index.. set aborted" << std::endl;
          return false;
       }
@@ -233,7 +354,7 @@ namespace sigen
 
    bool Section::set16Bits(ui16 idx, ui16 d)
    {
-      if (idx + 1 > size) {
+      if (idx + 1 >= alloc_size) {
          std::cerr << "Section::set16Bits(ui16, ui16): invalid index.. set aborted" << std::endl;
          return false;
       }
@@ -248,8 +369,7 @@ namespace sigen
    //
    void Section::write(std::ostream &o) const
    {
-      for (int i = 0; i < data_length; i++)
-         o << data[i];
+      o.write(reinterpret_cast<const char *>(data), data_length);
    }
 
    //
@@ -257,21 +377,94 @@ namespace sigen
    //
    bool Section::calcCrc()
    {
-      ui8 *d = &data[0];
-      int i;
-      ui32 crc_accum = 0xffffffff;
+      checkFits(CRC_LEN);
 
-      assert( lengthFits(CRC_LEN) );
-
-      for ( int j = 0;  j < data_length;  j++ ) {
-         i = ( static_cast<int>(crc_accum >> 24) ^ *d++ ) & 0xff;
-         crc_accum = ( crc_accum << 8 ) ^ CrcTable[i];
-      }
-      crc = crc_accum;
+      crc = crc32(data, data_length);
       set32Bits(crc);
+
+      hash = hashData(data, data_length);
       return true;
    }
 
+   //
+   // patches the version_number of a complete section, keeping the
+   // reserved bits and current_next_indicator, and crc's it again
+   //
+   void Section::setVersionNumber(ui8 version)
+   {
+      assert( !shared && data_length >= 8 + CRC_LEN );
+
+      data[5] = (data[5] & 0xc1) | ((version & 0x1f) << 1);
+
+      ui16 len = data_length - CRC_LEN;
+      crc = crc32(data, len);
+      for (int b = 0; b < CRC_LEN; b++)
+         data[len + b] = crc >> (24 - 8 * b);
+
+      hash = hashData(data, data_length);
+   }
+
+   ui64 Section::getHash() const
+   {
+      if (!hash)
+         hash = hashData(data, data_length);
+      return hash;
+   }
+
+   bool Section::sameData(const Section &o) const
+   {
+      return data_length == o.data_length &&
+         (data == o.data ||
+          (getHash() == o.getHash() && memcmp(data, o.data, data_length) == 0));
+   }
+
+   //
+   // switches to the other section's buffer, making it shared first
+   // if it isn't yet
+   //
+   std::size_t Section::shareData(Section &o)
+   {
+      assert( sameData(o) );
+
+      if (data == o.data)
+         return 0;
+
+      if (!o.shared) {
+         void *p = allocate(AllocKind::SECTION, sizeof(Shared), o.resource);
+         o.shared = new (p) Shared{ {1}, o.alloc_size, o.data, o.resource };
+         o.alloc_size = o.data_length;
+      }
+
+      std::size_t released = shared ? (shared->refs == 1 ? shared->size : 0) : alloc_size;
+      ui16 len = data_length;
+      ui64 h = o.getHash();
+      release();
+
+      shared = o.shared;
+      shared->refs++;
+      data = o.data;
+      pos = data + len;
+      data_length = alloc_size = len;
+      hash = h;
+      return released;
+   }
+
+   //
+   // copies the data to an exactly sized buffer
+   //
+   ui8 *Section::shrinkToFit()
+   {
+      if (shared || data_length == alloc_size)
+         return nullptr;
+
+      ui8 *old = data;
+      data = static_cast<ui8*>(allocate(AllocKind::SECTION_DATA, data_length, resource));
+      memcpy(data, old, data_length);
+      pos = data + data_length;
+      alloc_size = data_length;
+      return old;
+   }
+
    //
    // display the section in binary / char mode
    //
@@ -289,9 +482,17 @@ namespace sigen
 
    TStream::~TStream()
    {
-      // delete any allocated sections
-      for (Section* s : section_list)
-         delete s;
+      for (const SpareBuffer& b : spare_buffers)
+         deallocate(AllocKind::SECTION_DATA, b.data, b.size, getResource());
+   }
+
+   TStream &TStream::operator=(TStream &&other)
+   {
+      if (this != &other) {
+         section_list.clear();
+         append(std::move(other));
+      }
+      return *this;
    }
 
 
@@ -300,27 +501,179 @@ namespace sigen
    //
    Section *TStream::getNewSection(ui16 size)
    {
-      Section *sec = new Section( size );
-      section_list.push_back( sec );
+      // reuse a buffer released by a previous section, if any
+      ui8 *buffer = nullptr;
+      auto spare = std::find_if(spare_buffers.rbegin(), spare_buffers.rend(),
+                                [=](const SpareBuffer& b) { return b.size == size; });
+      if (spare != spare_buffers.rend()) {
+         buffer = spare->data;
+         spare_buffers.erase( std::next(spare).base() );
+      }
+
+      Section *sec = new (getResource()) Section( size, getResource(), buffer );
+      section_list.emplace_back( sec );
+      return sec;
+   }
+
+
+   Section *TStream::getNewSection(ui16 size, ui16 length)
+   {
+      Section *sec = new (getResource()) Section( size, getResource(), nullptr, length );
+      section_list.emplace_back( sec );
       return sec;
    }
 
 
+   //
+   // right-sizes the section and keeps its buffer for reuse. A section
+   // moved in from a stream on another resource gives its buffer back
+   // to that resource, as spares are freed through this stream's own
+   //
+   void TStream::shrinkToFit(Section &s)
+   {
+      ui8 *buffer = s.shrinkToFit();
+      if (!buffer)
+         return;
+
+      if (s.getResource() == getResource())
+         spare_buffers.push_back( { s.capacity(), buffer } );
+      else
+         deallocate(AllocKind::SECTION_DATA, buffer, s.capacity(), s.getResource());
+   }
+
+
+   //
+   // moves the other stream's sections into this one. The list nodes
+   // are relinked if both lists allocate from the same resource,
+   // otherwise only the handles are moved
+   //
+   void TStream::splice(SectionList::const_iterator pos, TStream &&other)
+   {
+      if (this == &other)
+         return;
+
+      if (section_list.get_allocator() == other.section_list.get_allocator())
+         section_list.splice(pos, other.section_list);
+      else {
+         for (SectionPtr &s : other.section_list)
+            section_list.insert(pos, std::move(s));
+         other.section_list.clear();
+      }
+   }
+
+   //
+   // hands over all the sections
+   //
+   TStream::SectionList TStream::take()
+   {
+      SectionList l(std::move(section_list));
+      section_list.clear();
+      return l;
+   }
+
+
+   //
+   // points each section at the buffer of the first one with the
+   // same data
+   //
+   std::size_t TStream::dedup()
+   {
+      std::unordered_multimap<ui64, Section *> first;
+      first.reserve(section_list.size());
+
+      std::size_t released = 0;
+      for (const SectionPtr &s : section_list) {
+         ui64 h = s->getHash();
+         auto range = first.equal_range(h);
+         auto same = std::find_if(range.first, range.second,
+                                  [&](const std::pair<const ui64, Section *> &f) {
+                                     return f.second->sameData(*s);
+                                  });
+         if (same != range.second)
+            released += s->shareData(*same->second);
+         else
+            first.emplace(h, s.get());
+      }
+      return released;
+   }
+
+   ui64 TStream::getHash() const
+   {
+      ui64 h = section_list.size();
+      for (const SectionPtr &s : section_list)
+         h = hashWord(h, s->getHash());
+      return mix64(h);
+   }
+
+
    //
    // dump to the file
    //
-   void TStream::write(const std::string &file_name) const
+   bool TStream::write(const std::string &file_name) const
    {
-      std::stringstream strm;
-      for (const Section *s : section_list) {
-         s->write(strm);
+      int fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0)
+         return false;
+
+      bool ok = write(fd);
+      return (::close(fd) == 0) && ok;
+   }
+
+
+   //
+   // gathers the section buffers, IOV_MAX at a time, and writes
+   // them out. Short writes are resumed from where they stopped
+   //
+   bool TStream::write(int fd) const
+   {
+      std::vector<iovec> iov;
+      iov.reserve( std::min<size_t>(section_list.size(), IOV_MAX) );
+
+      auto s = section_list.begin();
+      while (s != section_list.end()) {
+         iov.clear();
+         for (; s != section_list.end() && iov.size() < IOV_MAX; ++s)
+            iov.push_back({ const_cast<ui8 *>((*s)->getBinaryData()), (*s)->length() });
+
+         iovec *v = iov.data();
+         int n = iov.size();
+         while (n > 0) {
+            ssize_t w = ::writev(fd, v, n);
+            if (w < 0) {
+               if (errno == EINTR)
+                  continue;
+               return false;
+            }
+
+            // skip what was written. Nothing written with data left
+            // would never make progress
+            bool stuck = (w == 0);
+            for (; n > 0 && static_cast<size_t>(w) >= v->iov_len; v++, n--)
+               w -= v->iov_len;
+            if (n > 0) {
+               if (stuck) {
+                  errno = EIO;
+                  return false;
+               }
+               v->iov_base = static_cast<ui8 *>(v->iov_base) + w;
+               v->iov_len -= w;
+            }
+         }
       }
+      return true;
+   }
 
-      // open the file and save the contents of the stream to it
-      std::ofstream f( file_name.c_str() );
 
-      while (strm.peek() != EOF)
-         f.put(strm.get());
+   //
+   // to a stdio stream
+   //
+   bool TStream::write(FILE *f) const
+   {
+      for (const SectionPtr &s : section_list) {
+         if (fwrite(s->getBinaryData(), 1, s->length(), f) != s->length())
+            return false;
+      }
+      return true;
    }
 
 
@@ -340,7 +693,7 @@ namespace sigen
       int cnt = 0;
 
       // dump all sections
-      for (const Section *s : section_list) {
+      for (const SectionPtr &s : section_list) {
          o << "- sec: " << std::dec << cnt++
            << ", length: " << std::dec << s->length()
            << ", size (max): " << std::dec << s->capacity()
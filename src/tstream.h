@@ -23,10 +23,16 @@
 
 #pragma once
 
+#include <cassert>
+#include <cstdio>
 #include <string>
+#include <string_view>
 #include <list>
+#include <memory>
 #include <vector>
 #include "types.h"
+#include "alloc.h"
+#include "build_stats.h"
 
 namespace sigen {
 
@@ -39,35 +45,75 @@ namespace sigen {
    class Section
    {
    private:
+      // a data buffer shared by identical sections (see TStream::dedup())
+      struct Shared;
+
       ui8 *pos,
          *data;
+      Shared *shared = nullptr;
+      mutable ui64 hash = 0; // 0 until computed
       ui32 crc;
       ui16 data_length;
-      const ui16 size; // max size of the section (set at construction)
+      ui16 size; // max size of the section (set at construction)
+      ui16 alloc_size; // size of data - less than size once shrunk
+      std::pmr::memory_resource* resource; // where data is allocated
+#ifdef ENABLE_BUILD_STATS
+      ui16 item_count = 0;
+      ui16 desc_count = 0;
+#endif
 
       // checks if len bytes can fit
-      bool lengthFits(ui16 len) const { return ((data_length + len) <= size); }
+      bool lengthFits(ui16 len) const { return ((data_length + len) <= alloc_size); }
+      // as above, throwing std::length_error if they don't. Sections
+      // are allocated at their planned length, so a write past it
+      // (e.g., from a descriptor whose length() is wrong) is stopped
+      // in release builds too
+      void checkFits(ui16 len) const {
+         if (!lengthFits(len))
+            overflow(len);
+      }
+      [[noreturn]] void overflow(ui16 len) const;
+
+      // frees the data buffer
+      void release();
 
    public:
       enum { CRC_LEN = 4 };
 
-      // constructor / destructor
-      Section(ui16 section_size);
-      ~Section() { delete [] data; }
-      // prohibit
+      // constructor / destructor. Only alloc_len bytes (section_size
+      // if 0) are allocated, for sections whose length is known up
+      // front. If given, buffer must hold them, allocated from r, and
+      // is owned by the section
+      Section(ui16 section_size, std::pmr::memory_resource* r = getMemoryResource(),
+              ui8 *buffer = nullptr, ui16 alloc_len = 0);
+      ~Section() { release(); }
+
+      // movable, the data buffer is handed over. Copying is prohibited
+      Section(Section &&) noexcept;
+      Section &operator=(Section &&) noexcept;
       Section(const Section &) = delete;
-      Section(const Section &&) = delete;
       Section &operator=(const Section &) = delete;
-      Section &operator=(const Section &&) = delete;
+
+      SIGEN_TRACKED_NEW(AllocKind::SECTION)
 
       // accessors
       const ui8 *getBinaryData() const { return data; }
       ui16 length() const { return data_length; }
       ui16 capacity() const { return size; }
+      std::pmr::memory_resource* getResource() const { return resource; }
 
       ui8 *getCurDataPosition() const { return pos; }
       ui32 getCRC() const { return crc; }
 
+      // 64-bit hash of the section data, computed by calcCrc() or on
+      // first use for sections without a CRC. Not updated if the data
+      // is changed afterwards
+      ui64 getHash() const;
+      // true if both sections hold the same bytes
+      bool sameData(const Section &other) const;
+      // true if the data buffer is shared with other sections
+      bool isShared() const { return shared != nullptr; }
+
       // utility
       bool set08Bits(ui8 data);
       bool set16Bits(ui16 data);
@@ -79,9 +125,22 @@ namespace sigen {
       bool setBits(ui8 data)  { return set08Bits(data); }
       bool setBits(ui16 data) { return set16Bits(data); }
       bool setBits(ui32 data) { return set32Bits(data); }
-      bool setBits(const std::string &data);
+      bool setBits(std::string_view data);
+      bool setBits(const std::string &data) { return setBits(std::string_view(data)); }
       bool setBits(const LanguageCode &code);
-      bool setBits(const std::vector<ui8> &v);
+      bool setBits(const std::vector<ui8> &v) { return setBits(v.data(), v.size()); }
+      bool setBits(const ui8 *d, ui16 len); // copies len bytes
+
+      // reserves len bytes with a single bounds check and returns a
+      // cursor to them. The caller must fill all len bytes
+      ui8 *reserve(ui16 len) {
+         checkFits(len);
+
+         ui8 *p = pos;
+         pos += len;
+         data_length += len;
+         return p;
+      }
 
       // sets data without incrementing pointer
       bool set08Bits(ui8 idx, ui8 data);
@@ -91,6 +150,42 @@ namespace sigen {
       void write(std::ostream &) const;
       bool calcCrc();
 
+      // sets the version_number of a complete PSI section, updating
+      // its CRC and hash. The data buffer can't be shared
+      void setVersionNumber(ui8 version);
+
+      // empties the section to write it again from the start
+      void clear() {
+         assert( !shared );
+         pos = data;
+         data_length = 0;
+         crc = 0;
+         hash = 0;
+#ifdef ENABLE_BUILD_STATS
+         item_count = desc_count = 0;
+#endif
+      }
+
+      // moves the data to a buffer of exactly length() bytes once the
+      // section is complete. Returns the previous buffer (capacity()
+      // bytes from the section's resource) which the caller takes
+      // ownership of, or nullptr if there was nothing to release
+      ui8 *shrinkToFit();
+
+      // releases this section's buffer and uses other's, which must
+      // hold the same data. Both sections must be complete: they
+      // can't be written to afterwards. Returns the bytes released
+      std::size_t shareData(Section &other);
+
+#ifdef ENABLE_BUILD_STATS
+      // counters for BuildStats - incremented by the table and
+      // descriptor writers
+      void countItem() { item_count++; }
+      void countDesc() { desc_count++; }
+      ui16 getItemCount() const { return item_count; }
+      ui16 getDescCount() const { return desc_count; }
+#endif
+
 #ifdef ENABLE_DUMP
       void dump(std::ostream &) const;
 #endif
@@ -98,40 +193,143 @@ namespace sigen {
 
    /*!
     * \brief Stream output class.
+    *
+    * Owns the sections built into it. Streams can be moved and
+    * combined without copying the section data, e.g., to hand back
+    * the output of a builder thread:
+    *
+    * \code
+    *    TStream all;
+    *    for (auto& f : futures)    // std::future<TStream>
+    *       all.append(f.get());
+    * \endcode
     */
    class TStream
    {
    public:
-      //! \brief Constructor.
-      TStream() { }
+      //! \brief Owning handle to a section.
+      typedef std::unique_ptr<Section> SectionPtr;
+      //! \brief List of sections.
+      typedef TrackedList<SectionPtr, AllocKind::SECTION> SectionList;
+
+      /*!
+       * \brief Constructor.
+       * \param r Memory resource to allocate the sections from.
+       */
+      TStream(std::pmr::memory_resource* r = getMemoryResource())
+         : section_list(r), spare_buffers(r) { }
       //! \brief Destructor.
       ~TStream();
 
-      // prohibit
+      //! \brief Move constructor. Takes the sections and resource of the other stream.
+      TStream(TStream &&) = default;
+      /*!
+       * \brief Move assignment. Releases this stream's sections and
+       * takes the other's. The memory resource is not changed.
+       */
+      TStream &operator=(TStream &&);
       TStream(const TStream &) = delete;
-      TStream(const TStream &&) = delete;
       TStream &operator=(const TStream &) = delete;
-      TStream &operator=(const TStream &&) = delete;
 
       // the linked-list of sections
-      std::list<Section *> section_list;
+      SectionList section_list;
 
       // accessors
       ui16 getNumSections() const { return section_list.size(); }
 
+      //! \brief Returns the resource the sections are allocated from.
+      std::pmr::memory_resource* getResource() const {
+         return section_list.get_allocator().resource;
+      }
+
       // allocates a new section of 'section_size' bytes
       Section *getNewSection(ui16 section_size);
+      // allocates a new section of 'section_size' bytes which will
+      // hold exactly 'length' - it needs no shrinkToFit()
+      Section *getNewSection(ui16 section_size, ui16 length);
+
+      // right-sizes a completed section. Its full size buffer is kept
+      // for the next getNewSection() of the same size
+      void shrinkToFit(Section &s);
+
+      /*!
+       * \brief Move the sections of another stream in front of pos.
+       * The section data is not copied.
+       * \param pos Position in section_list.
+       * \param other Stream to take the sections from. Left empty.
+       */
+      void splice(SectionList::const_iterator pos, TStream &&other);
+      /*!
+       * \brief Move the sections of another stream to the end of this one.
+       * \param other Stream to take the sections from. Left empty.
+       */
+      void append(TStream &&other) { splice(section_list.end(), std::move(other)); }
+      /*!
+       * \brief Add a section to the end of the stream.
+       * \param s Section to add.
+       */
+      void append(SectionPtr s) { section_list.push_back(std::move(s)); }
+      /*!
+       * \brief Remove all the sections from the stream.
+       * \return The sections, in order.
+       */
+      SectionList take();
+
+      /*!
+       * \brief Share the data buffer of identical sections.
+       *
+       * Sections with the same bytes (e.g., the SDT Other and EIT
+       * Other sections of one transport stream built for each of the
+       * others in a network) are found by their hash, compared and
+       * made to use a single buffer. The sections stay in the stream,
+       * in order, and can still be moved to other streams; the buffer
+       * is freed with the last section using it.
+       *
+       * \return Number of bytes of section data released.
+       */
+      std::size_t dedup();
+
+      /*!
+       * \brief Hash of the data of all the sections, in order.
+       *
+       * Comparing the hash of a new build of a cycle of tables with
+       * the previous one detects whether anything changed without
+       * comparing the data.
+       */
+      ui64 getHash() const;
 
       /*!
        * \brief Write the section data to a file with the specified
        * name.
        * \param file_name File name to write data to.
+       * \return `false` if the file couldn't be written.
+       */
+      bool write(const std::string &file_name) const;
+      /*!
+       * \brief Write the section data to a file descriptor. The
+       * sections are written in place with writev(), without copying.
+       * \param fd Open file descriptor.
+       * \return `false` on a write error (see errno).
+       */
+      bool write(int fd) const;
+      /*!
+       * \brief Write the section data to a stdio stream.
+       * \param f Open stream.
+       * \return `false` on a write error.
        */
-      void write(const std::string &file_name) const;
+      bool write(FILE *f) const;
 
 #ifdef ENABLE_DUMP
       void dump(std::ostream &) const;
 #endif
+
+   private:
+      // section buffers released by shrinkToFit()
+      struct SpareBuffer {
+         ui16 size;
+         ui8 *data;
+      };
+      TrackedVector<SpareBuffer, AllocKind::SECTION> spare_buffers;
    };
 
 } // sigen namespace
@@ -28,3 +28,4 @@
 typedef uint32_t ui32;
 typedef uint16_t ui16;
 typedef uint8_t  ui8;
+typedef uint64_t ui64;
@@ -0,0 +1,190 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// version_manager.cc: assigns table versions from content changes
+// -----------------------------------
+
+#include <cstdio>
+#include <fstream>
+#include "version_manager.h"
+#include "descriptor.h"
+#include "table.h"
+#include "tstream.h"
+
+namespace sigen
+{
+   namespace version_manager_priv {
+
+      // table_ids of the tables identified by more than table_id_extension
+      inline bool isSDT(ui8 tid) { return tid == 0x42 || tid == 0x46; }
+      inline bool isEIT(ui8 tid) { return tid >= 0x4e && tid <= 0x6f; }
+
+      inline ui16 get16(const ui8 *d) { return (d[0] << 8) | d[1]; }
+
+      inline void setVersion(TStream &t, ui8 version)
+      {
+         for (const TStream::SectionPtr &s : t.section_list)
+            s->setVersionNumber(version);
+      }
+   }
+
+   using namespace version_manager_priv;
+
+   VersionManager::VersionManager(const std::string &file) :
+      state_file(file)
+   {
+      if (!state_file.empty())
+         load();
+      unsaved = false;
+   }
+
+
+   //
+   // builds the table once and, if it wasn't built with its recorded
+   // version, patches that into the sections. If they differ from
+   // those last built with it, they're patched again with the next one
+   //
+   bool VersionManager::build(PSITable &table, TStream &t)
+   {
+      TStream s(t.getResource());
+      table.buildSections(s);
+      if (s.section_list.empty())
+         return false;
+
+      // the table's identity, from its first section
+      const Section &first = *s.section_list.front();
+      const ui8 *d = first.getBinaryData();
+      ui16 onid = 0, tsid = 0;
+      if (isSDT(d[0]) && first.length() >= 10)
+         onid = get16(d + 8);
+      else if (isEIT(d[0]) && first.length() >= 12) {
+         tsid = get16(d + 8);
+         onid = get16(d + 10);
+      }
+      ui64 k = key(d[0], get16(d + 3), onid, tsid);
+
+      bool changed = true;
+      auto st = tables.find(k);
+      if (st == tables.end())
+         tables[k] = { table.getVersionNumber(), s.getHash() };
+      else {
+         if (table.getVersionNumber() != st->second.version)
+            setVersion(s, st->second.version);
+
+         if (s.getHash() == st->second.hash)
+            changed = false;
+         else {
+            st->second.version = (st->second.version + 1) & 0x1f;
+            setVersion(s, st->second.version);
+            st->second.hash = s.getHash();
+         }
+         table.setVersionNumber(st->second.version);
+      }
+      unsaved |= changed;
+
+      t.append(std::move(s));
+      return changed;
+   }
+
+
+   int VersionManager::getVersion(ui8 table_id, ui16 table_id_ext,
+                                  ui16 onid, ui16 tsid) const
+   {
+      auto st = tables.find(key(table_id, table_id_ext, onid, tsid));
+      return (st == tables.end()) ? -1 : st->second.version;
+   }
+
+
+   std::vector<VersionManager::Entry> VersionManager::getEntries() const
+   {
+      std::vector<Entry> entries;
+      entries.reserve(tables.size());
+      for (const auto &st : tables) {
+         entries.push_back({ static_cast<ui8>(st.first >> 48),
+                             static_cast<ui16>(st.first >> 32),
+                             static_cast<ui16>(st.first >> 16),
+                             static_cast<ui16>(st.first),
+                             st.second.version, st.second.hash });
+      }
+      return entries;
+   }
+
+   void VersionManager::setEntry(const Entry &e)
+   {
+      tables[key(e.table_id, e.table_id_ext, e.onid, e.tsid)] =
+         { static_cast<ui8>(e.version & 0x1f), e.hash };
+      unsaved = true;
+   }
+
+
+   //
+   // the state file has a line per table:
+   //    table_id table_id_ext onid tsid version hash
+   // in hex
+   //
+   bool VersionManager::load()
+   {
+      std::ifstream f(state_file);
+      if (!f)
+         return false;
+
+      unsigned tid, ext, onid, tsid, version;
+      unsigned long long hash;
+      while (f >> std::hex >> tid >> ext >> onid >> tsid >> version >> hash) {
+         setEntry({ static_cast<ui8>(tid), static_cast<ui16>(ext), static_cast<ui16>(onid),
+                    static_cast<ui16>(tsid), static_cast<ui8>(version), hash });
+      }
+      return f.eof();
+   }
+
+   //
+   // written to a temporary file first so a crash doesn't leave a
+   // partial one
+   //
+   bool VersionManager::save()
+   {
+      if (state_file.empty())
+         return false;
+      if (!unsaved)
+         return true;
+
+      std::string tmp = state_file + ".tmp";
+      {
+         std::ofstream f(tmp, std::ios::trunc);
+         if (!f)
+            return false;
+
+         f << std::hex;
+         for (const Entry &e : getEntries()) {
+            f << static_cast<unsigned>(e.table_id) << ' '
+              << e.table_id_ext << ' ' << e.onid << ' ' << e.tsid << ' '
+              << static_cast<unsigned>(e.version) << ' '
+              << e.hash << '\n';
+         }
+         if (!f.flush())
+            return false;
+      }
+      if (std::rename(tmp.c_str(), state_file.c_str()) != 0)
+         return false;
+
+      unsaved = false;
+      return true;
+   }
+
+} // namespace
@@ -0,0 +1,141 @@
+// Copyright 2020 Ed Porras
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy,
+// modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// version_manager.h: assigns table versions from content changes
+// -----------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace sigen {
+
+   class PSITable;
+   class TStream;
+
+   /*! \addtogroup utility
+    *  @{
+    */
+
+   /*!
+    * \brief Keeps the version_number of tables that are rebuilt each
+    * cycle, changing it only when their content changes.
+    *
+    * Tables are identified by their table_id and table_id_extension
+    * and, for the SDT, the original_network_id or, for the EIT, the
+    * transport_stream_id and original_network_id. The version each
+    * table was last built with is recorded with a hash of its
+    * sections. Building through the manager sets that version on the
+    * table, and increments it (modulo 32) if the sections came out
+    * different. Each table is built once: a different version is
+    * patched into its sections:
+    *
+    * \code
+    *    VersionManager versions("/var/lib/si/versions");
+    *    for (;;) {
+    *       TStream t;
+    *       SDTActual sdt(tsid, onid, 0);   // version is set by the manager
+    *       ...
+    *       versions.build(sdt, t);
+    *       ...
+    *       versions.save();
+    *    }
+    * \endcode
+    *
+    * If a state file is given, the versions are loaded from it and
+    * save() writes them back, so they carry on from where they were
+    * after a restart. Calling it once per cycle writes all of the
+    * cycle's changes at once.
+    */
+   class VersionManager
+   {
+   public:
+      //! \brief Recorded state of a table.
+      struct Entry {
+         ui8 table_id;
+         ui16 table_id_ext;
+         ui16 onid;
+         ui16 tsid;
+         ui8 version;
+         ui64 hash;    //!< TStream::getHash() of the sections built with the version.
+      };
+
+      /*!
+       * \brief Constructor.
+       * \param state_file File to load and save the versions in. None
+       * if empty.
+       */
+      VersionManager(const std::string &state_file = "");
+
+      /*!
+       * \brief Build a table's sections with the version for its
+       * current content.
+       * \param table Table to build. Its version_number is updated.
+       * \param t Stream to append the sections to.
+       * \return `true` if the table is new or its content changed.
+       */
+      bool build(PSITable &table, TStream &t);
+
+      /*!
+       * \brief Version last built for a table.
+       * \return -1 if the table isn't known.
+       */
+      int getVersion(ui8 table_id, ui16 table_id_ext,
+                     ui16 onid = 0, ui16 tsid = 0) const;
+
+      //! \brief Number of tables known.
+      std::size_t size() const { return tables.size(); }
+
+      //! \brief State of all the tables known.
+      std::vector<Entry> getEntries() const;
+      //! \brief Set the state of a table (e.g., from a SnapshotReader).
+      void setEntry(const Entry &e);
+
+      /*!
+       * \brief Write the state file (replaced atomically) if any
+       * version changed since it was loaded or last saved.
+       * \return `false` if there's no state file or it couldn't be
+       * written.
+       */
+      bool save();
+
+   private:
+      struct State {
+         ui8 version;
+         ui64 hash;   // of the sections built with the version
+      };
+
+      std::map<ui64, State> tables;  // by key()
+      std::string state_file;
+      bool unsaved = false;   // changes not written to state_file
+
+      static ui64 key(ui8 table_id, ui16 table_id_ext, ui16 onid, ui16 tsid) {
+         return (static_cast<ui64>(table_id) << 48) | (static_cast<ui64>(table_id_ext) << 32) |
+            (static_cast<ui64>(onid) << 16) | tsid;
+      }
+      bool load();
+   };
+
+   //! @}
+
+} // sigen namespace
@@ -0,0 +1,181 @@
+#include <memory_resource>
+#include <vector>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   // counts the requests forwarded to another resource
+   struct CountingResource : public std::pmr::memory_resource
+   {
+      CountingResource(std::pmr::memory_resource* r) : upstream(r) { }
+
+      std::pmr::memory_resource* upstream;
+      ui32 allocs = 0;
+      ui32 deallocs = 0;
+
+   private:
+      void* do_allocate(std::size_t bytes, std::size_t align) {
+         allocs++;
+         return upstream->allocate(bytes, align);
+      }
+      void do_deallocate(void* p, std::size_t bytes, std::size_t align) {
+         deallocs++;
+         upstream->deallocate(p, bytes, align);
+      }
+      bool do_is_equal(const std::pmr::memory_resource& o) const noexcept {
+         return this == &o;
+      }
+   };
+
+   //
+   // builds an SDT and checks the allocations made by the library
+   // against a budget
+   const ui32 num_services = 50;
+
+   static void add_services(SDT& sdt)
+   {
+      std::vector<SDT::ServiceSpec> services;
+      for (ui32 i = 0; i < num_services; i++)
+         services.push_back({ static_cast<ui16>(100 + i), true, true, 4, false });
+      sdt.addServices(services);
+
+      for (ui32 i = 0; i < num_services; i++) {
+         sdt.addServiceDesc( 100 + i, *new ServiceDesc(0x01, "provider", "service") );
+
+         MultilingualServiceNameDesc* mlsnd = new MultilingualServiceNameDesc;
+         mlsnd->addInfo("eng", "provider", "service");
+         mlsnd->addInfo("fre", "fournisseur", "service");
+         sdt.addServiceDesc( 100 + i, *mlsnd );
+      }
+   }
+
+   static int check_sdt_allocs(AllocCounter& counter, TStream& t)
+   {
+      SDTActual sdt(0x20, 0x30, 0x01);
+      add_services(sdt);
+
+      // each service is one object plus the list's storage,
+      // reserved once for the batch
+      if (counter.allocations(AllocKind::TABLE_ITEM) != num_services + 1 ||
+          counter.allocations(AllocKind::DESCRIPTOR) != num_services * 2 ||
+          counter.allocations(AllocKind::DESC_NODE) != num_services * 2 ||
+          counter.allocations(AllocKind::DESC_LOOP) != num_services * 2)
+         return 1;
+
+      // building the sections must not touch the table's data. The
+      // stream's bookkeeping is the section list
+      counter.reset();
+      sdt.buildSections(t);
+
+      ui32 sections = t.getNumSections();
+      if (counter.allocations(AllocKind::TABLE_ITEM) != 0 ||
+          counter.allocations(AllocKind::DESCRIPTOR) != 0 ||
+          counter.allocations(AllocKind::DESC_NODE) != 0 ||
+          counter.allocations(AllocKind::DESC_LOOP) != 0 ||
+          counter.allocations(AllocKind::SECTION_DATA) != sections ||
+          counter.allocations(AllocKind::SECTION) > sections * 2)
+         return 1;
+
+      // the sections are planned before they're written, so each
+      // one's buffer is allocated once at its exact length, again
+      // when building again
+      ui32 data_allocs = counter.allocations(AllocKind::SECTION_DATA);
+      sdt.buildSections(t);
+      if (t.getNumSections() != sections * 2 ||
+          counter.allocations(AllocKind::SECTION_DATA) != data_allocs + sections)
+         return 1;
+
+      return 0;
+   }
+
+   //
+   // descriptors with inline payloads make one allocation each (the
+   // object itself) plus the list node when attached - nothing for
+   // their loop data or strings
+   static int check_inline_desc_allocs(AllocCounter& counter)
+   {
+      std::pmr::monotonic_buffer_resource arena;
+      CountingResource scoped(&arena);
+      counter.reset();
+      {
+         MemoryScope scope(&scoped);
+         PF_EITActual eit(0x20, 0x30, 0x01, 1);
+         eit.addPresentEvent(0x1000, UTC(3, 1, 1999, 9, 0, 0), BCDTime(0, 30, 0), 1, 1);
+
+         ContentDesc* cd = new ContentDesc;
+         for (ui8 i = 0; i < 100; i++)
+            cd->addContent(i & 0x0f, 0x02, 0x03, 0x04);
+         eit.addPresentEventDesc( *cd );
+
+         ParentalRatingDesc* prd = new ParentalRatingDesc;
+         for (ui8 i = 0; i < 50; i++)
+            prd->addRating("GBR", i);
+         eit.addPresentEventDesc( *prd );
+
+         ISO639LanguageDesc* ild = new ISO639LanguageDesc;
+         ild->addLanguage("eng", ISO639LanguageDesc::CLEAN_EFFECTS);
+         eit.addPresentEventDesc( *ild );
+
+         eit.addPresentEventDesc( *new StuffingDesc(0xff, 200) );
+
+         if (counter.allocations(AllocKind::DESCRIPTOR) != 4 ||
+             counter.allocations(AllocKind::DESC_NODE) != 4 ||
+             counter.allocations(AllocKind::DESC_LOOP) != 0 ||
+             scoped.allocs != counter.allocations())
+            return 1;
+      }
+      return 0;
+   }
+
+   int alloc(TStream&)
+   {
+      AllocCounter counter;
+      setAllocObserver(&counter);
+
+      int rc;
+      {
+         TStream t;
+         rc = check_sdt_allocs(counter, t);
+      }
+
+      // everything was released once the table and stream went out
+      // of scope
+      if (!rc && (counter.releases(AllocKind::TABLE_ITEM) != num_services + 1 ||
+                  counter.releases(AllocKind::DESCRIPTOR) != num_services * 2 ||
+                  counter.releases(AllocKind::SECTION_DATA) != counter.allocations(AllocKind::SECTION_DATA) ||
+                  counter.releases(AllocKind::SECTION) != counter.allocations(AllocKind::SECTION)))
+         rc = 1;
+
+      // the same build, in a monotonic arena. Everything the library
+      // allocates must come from it
+      if (!rc) {
+         std::pmr::monotonic_buffer_resource arena;
+         CountingResource scoped(&arena);
+         counter.reset();
+         {
+            MemoryScope scope(&scoped);
+            SDTActual sdt(0x20, 0x30, 0x01);
+            add_services(sdt);
+
+            TStream t;
+            sdt.buildSections(t);
+         }
+         if (getMemoryResource() != std::pmr::new_delete_resource() ||
+             scoped.allocs == 0 ||
+             scoped.allocs != counter.allocations() ||
+             scoped.deallocs != scoped.allocs)
+            rc = 1;
+         arena.release();
+      }
+
+      if (!rc)
+         rc = check_inline_desc_allocs(counter);
+
+      // the counter goes out of scope with this function
+      setAllocObserver(nullptr);
+      return rc;
+   }
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   static std::string read_file(const std::string& name)
+   {
+      std::ifstream f(name, std::ios::binary);
+      return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+   }
+
+   // a few hundred KB of sections
+   static void build(TStream& t)
+   {
+      for (ui16 tsid = 0; tsid < 20; tsid++) {
+         SDTActual sdt(0x20, tsid, 0x01);
+         for (ui16 i = 0; i < 200; i++) {
+            sdt.addService(i, true, true, 4, false);
+            sdt.addServiceDesc( *new ServiceDesc(0x01, "provider", "service") );
+         }
+         sdt.buildSections(t);
+      }
+   }
+
+   //
+   // writes the stream through an AsyncWriter with a small pool, so
+   // buffers are reused, and compares the file with the sections
+   static int check_writer(const TStream& t, const std::string& expected,
+                           bool use_io_uring, int open_flags)
+   {
+      char name[] = "/tmp/sigen_asyncXXXXXX";
+      int fd = mkstemp(name);
+      if (fd < 0)
+         return 77;
+      close(fd);
+      fd = open(name, O_WRONLY | open_flags);
+
+      AsyncWriter::Options opts;
+      opts.buffer_size = 4096;
+      opts.num_buffers = 4;
+      opts.batch = 2;
+      opts.use_io_uring = use_io_uring;
+
+      int rc = 0;
+      {
+         AsyncWriter out(fd, opts);
+         if (!use_io_uring && out.backend() != AsyncWriter::WRITER_THREAD)
+            rc = 1;
+
+         std::size_t completed = 0;
+         out.setCompletionHandler([&](std::size_t bytes, int error) {
+               completed += bytes;
+               if (error)
+                  rc = 1;
+            });
+
+         // the pool bounds the data in flight
+         for (const auto& s : t.section_list) {
+            if (!out.write(s->getBinaryData(), s->length()) ||
+                out.inFlight() > opts.num_buffers)
+               rc = 1;
+         }
+
+         if (!out.flush() || out.inFlight() != 0 ||
+             out.bytesWritten() != expected.size() ||
+             completed != expected.size() ||
+             out.freeBuffers() != opts.num_buffers)
+            rc = 1;
+
+         // the descriptor is left after the data
+         if (lseek(fd, 0, SEEK_CUR) != static_cast<off_t>(expected.size()))
+            rc = 1;
+      }
+      close(fd);
+
+      if (read_file(name) != expected)
+         rc = 1;
+      unlink(name);
+      return rc;
+   }
+
+   //
+   // TS packets written asynchronously match the ones written by the
+   // file packetizer
+   static int check_packets(const TStream& t)
+   {
+      char name[] = "/tmp/sigen_asyncXXXXXX";
+      int fd = mkstemp(name);
+      if (fd < 0)
+         return 77;
+
+      int rc = 0;
+      std::string ref_name = std::string(name) + ".ref";
+      {
+         MpgPacketizer ref(ref_name, 0);
+         for (const auto& s : t.section_list)
+            ref.packetize(*s, 0x11);
+      }
+
+      {
+         AsyncWriter out(fd);
+         MpgPacketizer pkt(out, 0);
+         for (const auto& s : t.section_list)
+            pkt.packetize(*s, 0x11);
+         if (!out.flush() || !pkt.good())
+            rc = 1;
+      }
+      close(fd);
+
+      std::string ref = read_file(ref_name);
+      if (ref.empty() || ref.size() % 188 || read_file(name) != ref)
+         rc = 1;
+
+      // a failed write sticks until cleared
+      FdSink bad(-1);
+      MpgPacketizer lost(bad, 0);
+      lost.packetize(*t.section_list.front(), 0x11);
+      lost.packetize(*t.section_list.front(), 0x11);
+      if (lost.good())
+         rc = 1;
+      lost.clearError();
+      if (!lost.good())
+         rc = 1;
+
+      // sections longer than a private section are written in batches
+      TStream big;
+      Section* sec = big.getNewSection(8000);
+      ui8* p = sec->reserve(8000);
+      for (int i = 0; i < 8000; i++)
+         p[i] = i * 7;
+      BufferSink packets;
+      MpgPacketizer split(packets, 0);
+      split.packetize(*sec, 0x11);
+
+      std::vector<ui8> payload;
+      for (std::size_t at = 0; at < packets.buffer.size(); at += 188)
+         payload.insert(payload.end(), packets.buffer.begin() + at + 4,
+                        packets.buffer.begin() + at + 188);
+      if (!split.good() || packets.buffer.size() != (8001 + 183) / 184 * 188 ||
+          payload[0] != 0 || !std::equal(p, p + 8000, payload.begin() + 1))
+         rc = 1;
+
+      unlink(name);
+      unlink(ref_name.c_str());
+      return rc;
+   }
+
+   int async(TStream& t)
+   {
+      build(t);
+
+      std::string expected;
+      for (const auto& s : t.section_list)
+         expected.append(reinterpret_cast<const char*>(s->getBinaryData()), s->length());
+
+      // io_uring (where available) and the writer thread, at
+      // explicit offsets and in order
+      for (bool use_io_uring : { true, false }) {
+         for (int flags : { 0, O_APPEND }) {
+            int rc = check_writer(t, expected, use_io_uring, flags);
+            if (rc)
+               return rc;
+         }
+      }
+
+      return check_packets(t);
+   }
+}
@@ -0,0 +1,70 @@
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   // the table packetized 'times' times in a row with one packetizer
+   static std::vector<ui8> packetize(const STable& table, ui16 pid, int times)
+   {
+      TStream t;
+      table.buildSections(t);
+
+      BufferSink out;
+      MpgPacketizer pkt(out, 0);
+      for (int i = 0; i < times; i++) {
+         for (const auto& s : t.section_list)
+            pkt.packetize(*s, pid);
+      }
+      return out.buffer;
+   }
+
+   int cache(TStream&)
+   {
+      PAT pat(0x30, 1);
+      for (ui16 i = 1; i < 300; i++)
+         pat.addProgram(i, 0x100 + i);
+
+      // repeats are sent from the cache, with the continuity counter
+      // carried on as by the packetizer
+      PacketCache cache;
+      BufferSink out;
+      ui8 cc = 0;
+      for (int i = 0; i < 5; i++)
+         cache.emit(pat, 0x00, cc, out);
+
+      if (out.buffer != packetize(pat, 0x00, 5) ||
+          cache.size() != 1 || cache.misses() != 1 || cache.hits() != 4)
+         return 1;
+
+      // rebuilding the table replaces the entry
+      pat.addProgram(400, 0x400);
+      TStream t;
+      pat.buildSections(t);
+
+      BufferSink out2;
+      cc = 0;
+      cache.emit(pat, 0x00, cc, out2);
+      if (cache.misses() != 2 || out2.buffer != packetize(pat, 0x00, 1))
+         return 1;
+
+      // and so does a new version
+      pat.incVersionNumber();
+      cache.emit(pat, 0x00, cc, out2);
+      if (cache.misses() != 3)
+         return 1;
+
+      // each PID has an entry of its own
+      cache.emit(pat, 0x01, cc, out2);
+      if (cache.size() != 2 || cache.misses() != 4)
+         return 1;
+
+      cache.invalidate(pat);
+      cache.emit(pat, 0x01, cc, out2);
+      if (cache.size() != 1 || cache.misses() != 5)
+         return 1;
+
+      return 0;
+   }
+}
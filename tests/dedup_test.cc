@@ -0,0 +1,111 @@
+#include <memory>
+#include <vector>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   enum { NUM_TS = 5 };
+
+   // the SDT of a transport stream: Actual in its own multiplex,
+   // Other in the rest
+   static void build_sdt(TStream& t, ui16 ts, bool actual, ui16 services)
+   {
+      std::unique_ptr<SDT> sdt;
+      if (actual)
+         sdt.reset(new SDTActual(ts, 0x30, 0x01));
+      else
+         sdt.reset(new SDTOther(ts, 0x30, 0x01));
+
+      for (ui16 i = 0; i < services; i++) {
+         sdt->addService((ts << 8) | i, true, true, 4, false);
+         sdt->addServiceDesc( *new ServiceDesc(0x01, "provider", "service") );
+      }
+      sdt->buildSections(t);
+   }
+
+   // the SDTs carried in every multiplex of the network
+   static void build_network(TStream& t, ui16 services = 40)
+   {
+      for (ui16 mux = 0; mux < NUM_TS; mux++) {
+         for (ui16 ts = 0; ts < NUM_TS; ts++)
+            build_sdt(t, ts, ts == mux, services);
+      }
+   }
+
+   // deduplicates a network's sections, all released on return
+   static int check_dedup()
+   {
+      TStream t;
+      build_network(t);
+
+      BufferSink before;
+      before.write(t);
+      ui64 hash = t.getHash();
+
+      // each multiplex repeats the other transport streams' SDT Other
+      // sections, so all but one copy of each is released
+      std::size_t other_bytes = 0;
+      ui16 other_sections = 0;
+      for (ui16 ts = 0; ts < NUM_TS; ts++) {
+         TStream o;
+         build_sdt(o, ts, false, 40);
+         other_sections += o.getNumSections();
+         for (const auto& s : o.section_list)
+            other_bytes += s->length();
+      }
+
+      std::size_t released = t.dedup();
+      if (released != other_bytes * (NUM_TS - 2))
+         return 1;
+
+      ui16 shared = 0;
+      for (const auto& s : t.section_list)
+         shared += s->isShared();
+      if (shared != other_sections * (NUM_TS - 1))
+         return 1;
+
+      // the stream's data is unchanged, and a second pass finds
+      // nothing more
+      BufferSink after;
+      after.write(t);
+      if (after.buffer != before.buffer || t.getHash() != hash || t.dedup() != 0)
+         return 2;
+
+      // a new build of the same tables has the same hash, and a
+      // changed one doesn't
+      TStream same, changed;
+      build_network(same);
+      build_network(changed, 41);
+      if (same.getHash() != hash || changed.getHash() == hash)
+         return 3;
+
+      // shared sections outlive the stream they were deduplicated in
+      TStream moved;
+      moved.append(std::move(t));
+      t = TStream();
+      BufferSink out;
+      out.write(moved);
+      if (out.buffer != before.buffer)
+         return 4;
+
+      return 0;
+   }
+
+   int dedup(TStream&)
+   {
+      AllocCounter allocs;
+      setAllocObserver(&allocs);
+      int rc = check_dedup();
+      setAllocObserver(nullptr);
+
+      // and the shared buffers are released with the last section
+      if (!rc && (allocs.allocations(AllocKind::SECTION_DATA) != allocs.releases(AllocKind::SECTION_DATA) ||
+                  allocs.allocations(AllocKind::SECTION) != allocs.releases(AllocKind::SECTION)))
+         rc = 5;
+
+      return rc;
+   }
+}
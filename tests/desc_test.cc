@@ -0,0 +1,206 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   typedef std::vector<std::unique_ptr<Descriptor>> DescList;
+
+   template <class T, class... Args>
+   static T& add(DescList& l, Args&&... args)
+   {
+      T* d = new T(std::forward<Args>(args)...);
+      l.emplace_back(d);
+      return *d;
+   }
+
+   //
+   // one of each descriptor class, with its loops filled in. The
+   // UtilityDesc is left out: it's a marker that's never written
+   static void all_descs(DescList& l)
+   {
+      std::vector<ui8> v = { 1, 2, 3, 4, 5, 6, 7 };
+
+      // nit & bat
+      add<NetworkNameDesc>(l, "my network");
+      add<NetworkNameDesc>(l, std::string(259, 'c'));
+      add<StuffingDesc>(l, 'z', 13);
+      add<StuffingDesc>(l, std::string(259, 'd'));
+      auto& mlnnd = add<MultilingualNetworkNameDesc>(l);
+      mlnnd.addText("fre", "France");
+      mlnnd.addText("eng", "France");
+      add<SatelliteDeliverySystemDesc>(l, 0x44444444, 0x3333, 0x1111111, true,
+                                       Dvb::Sat::CIRCULAR_RIGHT_POL, Dvb::Sat::MOD_QPSK,
+                                       Dvb::CR_9_10_FECI, Dvb::Sat::ROF_020);
+      add<CableDeliverySystemDesc>(l, 1000, 2000, 0x01, 0x08, 0x02);
+      add<TerrestrialDeliverySystemDesc>(l, 0x55555555,
+                                         Dvb::Terr::BW_6_MHZ,
+                                         Dvb::Terr::CONS_QAM_16,
+                                         Dvb::Terr::HI_4_IN_DEPTH,
+                                         Dvb::Terr::CR_2_3, Dvb::Terr::CR_7_8,
+                                         Dvb::Terr::GI_1_16,
+                                         Dvb::Terr::TM_8K,
+                                         true,
+                                         Dvb::Terr::PRI_HIGH,
+                                         false,
+                                         false);
+      add<StreamIdentifierDesc>(l, 0x88);
+      add<TimeShiftedServiceDesc>(l, 0x4000);
+      auto& asd = add<AnnouncementSupportDesc>(l, AnnouncementSupportDesc::EMERGENCY_ALARM_AS |
+                                               AnnouncementSupportDesc::WEATHER_FLASH_AS);
+      asd.addAnnouncement(AnnouncementSupportDesc::SERVICE_AUDIO_STREAM_RT);
+      asd.addAnnouncement(AnnouncementSupportDesc::WEATHER_FLASH_AT,
+                          AnnouncementSupportDesc::DIFFERENT_SERVICE_RT,
+                          0x1100, 0x1300, 0x402, 0x3);
+      auto& cfld = add<CellFrequencyLinkDesc>(l);
+      cfld.addCell(10, 10000);
+      cfld.addSubCell(10, 11, 1000);
+      cfld.addCell(11, 40000);
+      auto& cld = add<CellListDesc>(l);
+      cld.addCell(1, 3000, 2000, 555, 65);
+      cld.addSubCell(1, 20, 3000, 2000, 555, 65);
+      cld.addCell(2, 4000, 3000, 5555, 655);
+      auto& fld = add<FrequencyListDesc>(l, 0x2);
+      fld.addFrequency(0x1000);
+      fld.addFrequency(0x2000);
+      add<BouquetNameDesc>(l, "Bouquet Name");
+      auto& mlbnd = add<MultilingualBouquetNameDesc>(l);
+      mlbnd.addText("spa", "Jugo de naranja");
+      auto& caid = add<CAIdentifierDesc>(l);
+      for (int i = 0; i < 30; i++)
+         caid.addSystemId(i + 0x3000);
+      auto& sld = add<ServiceListDesc>(l);
+      for (int i = 0; i < 50; i++)
+         sld.addService(i + 100, 0x01);
+      add<ClonedDataDesc>(l, std::vector<ui8>{ 0xa0, 0 });
+      add<ClonedDataDesc>(l, std::vector<ui8>{ 0xa2, 3, 0x45, 0x67, 0x89 });
+
+      // sdt
+      add<ServiceDesc>(l, 0xfe, std::string(300, 'p'), std::string(300, 's'));
+      auto& cad = add<CountryAvailabilityDesc>(l, true);
+      cad.addCountry("eng");
+      cad.addCountry("fra");
+      add<TimeShiftedEventDesc>(l, 0x9999, 0x8888);
+      add<TelephoneDesc>(l, true, 0x5, "123-", "1234567-", "123-",
+                         "1234567-", "123456789012345-");
+      auto& mlsnd = add<MultilingualServiceNameDesc>(l);
+      mlsnd.addInfo("fre", "Radio France 1", "Some Service 1");
+      mlsnd.addInfo("spa", "Radio France 2", "Some Service 2");
+      add<ComponentDesc>(l, 0x2, 0x4, 0x5, "eng", "Description of component");
+      auto& nrd = add<NVODReferenceDesc>(l);
+      nrd.addIdentifiers(0x01, 0x02, 0x03);
+      add<DataBroadcastDesc>(l, 0x3333, 0x2, "test", "eng", "this is the text");
+
+      // eit
+      add<PDCDesc>(l, 0x1000);
+      add<PrivateDataSpecifierDesc>(l, 0x44446666);
+      auto& mlcd = add<MultilingualComponentDesc>(l, 0x22);
+      mlcd.addText("fre", "Je sui fatigue");
+      add<DSNGDesc>(l, "dsng data");
+      add<PartialTransportStreamDesc>(l, 0x3000, 0x50, 0x1000);
+      add<TransportStreamDesc>(l);
+      auto& cond = add<ContentDesc>(l);
+      cond.addContent(0x1, 0x1, 0xc, 0x1);
+      cond.addContent(0x2, 0x1, 0xb, 0x1);
+      add<ShortSmoothingBufferDesc>(l, 0x1, 0x4, "xxxxxxxxx");
+      auto& prd = add<ParentalRatingDesc>(l);
+      prd.addRating("eng", 0x01);
+      prd.addRating("fre", 0x02);
+      add<ShortEventDesc>(l, "eng", "Fight Club", std::string(300, 'e'));
+      auto& eed = add<ExtendedEventDesc>(l, "eng", "An event", 0, 1);
+      eed.addItem("Director", "David Fincher");
+      eed.addItem("Year", "1999");
+
+      // pmt
+      auto& subtd = add<SubtitlingDesc>(l);
+      subtd.addSubtitling("eng", 0x01, 0x1000, 0x1010);
+      subtd.addSubtitling("fre", 0x01, 0x1001, 0x1010);
+      auto& ttd = add<TeletextDesc>(l);
+      ttd.addTeletext("eng", 0x01, 0x01, 0x11);
+      ttd.addTeletext("fre", 0x01, 0x02, 0x11);
+      auto& langd = add<ISO639LanguageDesc>(l);
+      langd.addLanguage("eng", 0x02);
+      langd.addLanguage("fre", 0x03);
+      add<AC3Desc>(l);
+      auto& ac3d = add<AC3Desc>(l);
+      ac3d.setASVC(0x4);
+      ac3d.setBSID(0x2);
+      auto& eac3d = add<ExtendedAC3Desc>(l);
+      eac3d.setComponentType(0x01);
+      eac3d.setMixinfoExists();
+      eac3d.setSubstream1(0x22);
+      add<AncillaryDataDesc>(l, 0x51);
+      add<PrivateDataIndicatorDesc>(l, 0x55553333);
+      add<ServiceMoveDesc>(l, 0x01, 0x02, 0x03);
+      add<DataStreamAlignmentDesc>(l, 0xff);
+      add<MobileHandoverLinkageDesc>(l, 0x2000, 0x1000, 100,
+                                     MobileHandoverLinkageDesc::HO_ASSOCIATED_SERVICE,
+                                     100, 20);
+      auto& ssudbid = add<SSUDataBroadcastIdDesc>(l);
+      ssudbid.addOUI(0x2001, SSUDataBroadcastIdDesc::UPDATE_TYPE_SSU_USING_RETURN_CHANNEL,
+                     2, v);
+      add<AudioStreamDesc>(l, true, false, 0x22);
+      add<VideoStreamDesc>(l, false, 0x09, false, true);
+      add<VideoStreamDesc>(l, false, 0x09, false, true, 0x88, 0x2, true);
+      add<DataBroadcastIdDesc>(l, 0x4545);
+      add<HierarchyDesc>(l, 0x02, 0x15, 0x16, 0x17);
+      add<MaximumBitrateDesc>(l, 0x234243);
+      add<CopyrightDesc>(l, 0x88990011, "(c) 2001 ep");
+      add<MultiplexBufferUtilizationDesc>(l, false, 0xefff, 0x27);
+      add<SystemClockDesc>(l, true, 0x7, 0x3);
+      add<TargetBackgroundGridDesc>(l, 0x0001, 0x0002, 0x1);
+      add<VideoWindowDesc>(l, 0x0002, 0x0001, 0x03);
+      add<RegistrationDesc>(l, 0x43523412, "");
+      add<RegistrationDesc>(l, 0x43523412, "additional");
+      add<STDDesc>(l, false);
+      add<SmoothingBufferDesc>(l, 0x334455, 0x445566);
+      add<IBPDesc>(l, true, false, 0x1111);
+      add<LinkageDesc>(l, 0x001, 0x002, 0x003, 0xf);
+      auto& ssuld = add<SSULinkageDesc>(l, 0x1000, 0x2000, 0x101);
+      ssuld.addOUI(0x12345, v);
+      add<SSUScanLinkageDesc>(l, 0x1000, 0x2000, 0x100, SSUScanLinkageDesc::TABLE_TYPE_BAT);
+      add<AdaptationFieldDataDesc>(l, AdaptationFieldDataDesc::PVR_ASSIST);
+
+      // tot & cat
+      auto& ltod = add<LocalTimeOffsetDesc>(l);
+      UTC t2(1, 22, 1999, 10, 0, 0);
+      ltod.addTimeOffset("eng", 0x22, true, 0x1234, t2, 0x4321);
+      add<CADesc>(l, 0x4653, 0x1234, "this is a test");
+
+      // eacem
+      add<EACEM::StreamIdentifierDesc>(l);
+      add<EACEM::PrivateDataSpecifierDesc>(l);
+      auto& lcnd = add<EACEM::LogicalChannelDesc>(l);
+      lcnd.addLogicalChan(0x1000, 0x10);
+      lcnd.addLogicalChan(0x1001, 0x11, false);
+   }
+
+   //
+   // each descriptor writes exactly the length() it plans sections
+   // with, and its own length field agrees
+   int desc(TStream&)
+   {
+      DescList l;
+      all_descs(l);
+
+      for (std::size_t i = 0; i < l.size(); i++) {
+         const Descriptor& d = *l[i];
+         Section s(4096);
+         d.encode(s);
+
+         const ui8* data = s.getBinaryData();
+         if (s.length() != d.length() || d.length() < 2 || data[1] != d.length() - 2) {
+            std::cerr << "descriptor " << i << " (tag 0x" << std::hex << int(data[0])
+                      << std::dec << ") length() " << d.length() << ", wrote "
+                      << s.length() << std::endl;
+            return 1;
+         }
+      }
+      return 0;
+   }
+}
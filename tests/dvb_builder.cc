@@ -51,7 +51,7 @@ namespace tests
       // compare
       std::ostringstream os;
       std::for_each(ts.section_list.begin(), ts.section_list.end(),
-                    [&](const Section* section) {
+                    [&](const TStream::SectionPtr& section) {
                        section->write(os);
                     } );
       int cmp = std::memcmp(os.str().c_str(), blob, size);
@@ -65,7 +65,7 @@ namespace tests
 void usage(const std::string& prog)
 {
    std::cerr << prog << " linked against sigen library v" << sigen::version() << std::endl
-             << "Usage: " << prog << " [-bat|-cat|-eit|-nit|-pat|-pmt|-sdt|-tdt|-tot]"
+             << "Usage: " << prog << " [-bat|-cat|-eit|-nit|-pat|-pmt|-sdt|-tdt|-tot|-stats|-alloc|-emplace|-batch|-layout|-stream|-async|-shm|-paced|-cache|-mux|-dedup|-versions|-snapshot|-iterator|-plan|-parallel|-packing|-desc]"
              << std::endl;
 }
 
@@ -97,6 +97,25 @@ int main(int argc, char* argv[])
       { "-st", tests::st },
       { "-eacem", tests::eacem },
       { "-other", tests::other },
+      { "-stats", tests::stats },
+      { "-alloc", tests::alloc },
+      { "-emplace", tests::emplace },
+      { "-batch", tests::batch },
+      { "-layout", tests::layout },
+      { "-stream", tests::stream },
+      { "-async", tests::async },
+      { "-shm", tests::shm },
+      { "-paced", tests::paced },
+      { "-cache", tests::cache },
+      { "-mux", tests::mux },
+      { "-dedup", tests::dedup },
+      { "-versions", tests::versions },
+      { "-snapshot", tests::snapshot },
+      { "-iterator", tests::iterator },
+      { "-plan", tests::plan },
+      { "-parallel", tests::parallel },
+      { "-packing", tests::packing },
+      { "-desc", tests::desc },
    };
 
    // search for the given argument
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <random>
 #include <string>
 #include "../src/sigen.h"
 
@@ -17,6 +18,33 @@ namespace tests {
    int st(sigen::TStream& t);
    int eacem(sigen::TStream& t);
    int other(sigen::TStream& t);
+   int stats(sigen::TStream& t);
+   int alloc(sigen::TStream& t);
+   int emplace(sigen::TStream& t);
+   int batch(sigen::TStream& t);
+   int layout(sigen::TStream& t);
+   int stream(sigen::TStream& t);
+   int async(sigen::TStream& t);
+   int shm(sigen::TStream& t);
+   int paced(sigen::TStream& t);
+   int cache(sigen::TStream& t);
+   int mux(sigen::TStream& t);
+   int dedup(sigen::TStream& t);
+   int versions(sigen::TStream& t);
+   int snapshot(sigen::TStream& t);
+   int iterator(sigen::TStream& t);
+   int plan(sigen::TStream& t);
+   int parallel(sigen::TStream& t);
+   int packing(sigen::TStream& t);
+   int desc(sigen::TStream& t);
+
+   // random table contents, repeatable from the seed
+   typedef std::minstd_rand Random;
+
+   // the body length of a random StuffingDesc, 2 to 255 bytes long.
+   // Added with the emplace...Desc() methods, it's deleted if the
+   // table is full
+   inline ui8 random_desc_len(Random& rnd) { return rnd() % 254; }
 
    int cmp_bin(const sigen::TStream& ts, const std::string& filename);
    bool write_bin(const sigen::TStream& ts, const std::string& basename);
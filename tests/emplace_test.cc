@@ -0,0 +1,99 @@
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   //
+   // same table as the sdt test but with the descriptors constructed
+   // in place by the table wherever their data is all passed to the
+   // constructor. The output must match
+   static int check_sdt(TStream& t)
+   {
+      SDTActual sdt(0x20, 0x30, 0x05);
+
+      // nothing to add to yet
+      if (sdt.emplaceServiceDesc<TimeShiftedEventDesc>(0x9999, 0x8888))
+         return 1;
+
+      sdt.addService(200, true, true, 1, false);
+
+      sdt.emplaceServiceDesc<ServiceDesc>( 0xfe,
+                                           "My provider name is XYZ and the point of this is to test if really long strings are truncated correctly so I must add even more data here",
+                                           "my service name is ABC and the point of this is to test if really really long strings are really really truncated correctly");
+
+      CountryAvailabilityDesc *cad = new CountryAvailabilityDesc(true);
+      cad->addCountry("eng");
+      cad->addCountry("fra");
+      cad->addCountry("spa");
+      cad->addCountry("ita");
+      cad->addCountry("rus");
+      sdt.addServiceDesc( *cad );
+
+      sdt.emplaceServiceDesc<StuffingDesc>( 'z', 200 );
+      sdt.emplaceServiceDesc<StuffingDesc>( std::string(259, 'd') );
+      sdt.emplaceServiceDesc<TimeShiftedEventDesc>( 0x9999, 0x8888 );
+      sdt.emplaceServiceDesc<TelephoneDesc>(true, 0x5, "123-", "1234567-", "123-",
+                                            "1234567-", "123456789012345-");
+
+      // another service
+      sdt.addService(201, false, true, 1, false);
+
+      MultilingualServiceNameDesc *mlsnd = new MultilingualServiceNameDesc;
+      mlsnd->addInfo("fre", "Radio France 1", "Some Service 1");
+      mlsnd->addInfo("spa", "Radio France 2", "Some Service 2");
+      mlsnd->addInfo("eng", "Radio France 3", "Some Service 3");
+      mlsnd->addInfo("deu", "Radio France 4", "Some Service 4");
+      mlsnd->addInfo("ita", "Radio France 5", "Some Service 5");
+      mlsnd->addInfo("rus", "Radio France 6", "Some Service 6");
+      mlsnd->addInfo("chi", "Radio France 7", "Some Service 7");
+      sdt.addServiceDesc( 201, *mlsnd );
+
+      sdt.emplaceServiceDesc<ComponentDesc>( 0x2, 0x4, 0x5, "eng", "Deescription of component" );
+
+      NVODReferenceDesc *nrd = new NVODReferenceDesc;
+      nrd->addIdentifiers( 0x01, 0x02, 0x03 );
+      sdt.addServiceDesc( *nrd );
+
+      sdt.emplaceServiceDesc<DataBroadcastDesc>( 0x3333, 0x2, "test", "eng", "this is the text");
+
+      sdt.buildSections(t);
+      return tests::cmp_bin(t, "reference/sdt.ts");
+   }
+
+   //
+   // descriptors that don't fit are released by the table
+   static int check_rejected(AllocCounter& counter)
+   {
+      ui32 added = 0;
+      {
+         SDTActual sdt(0x20, 0x30, 0x05);
+         sdt.addService(200, true, true, 1, false);
+
+         counter.reset();
+         while (sdt.emplaceServiceDesc<StuffingDesc>(0xff, 255))
+            added++;
+
+         if (added == 0 ||
+             counter.allocations(AllocKind::DESCRIPTOR) != added + 1 ||
+             counter.releases(AllocKind::DESCRIPTOR) != 1)
+            return 1;
+      }
+      return (counter.releases(AllocKind::DESCRIPTOR) == added + 1) ? 0 : 1;
+   }
+
+   int emplace(TStream& t)
+   {
+      AllocCounter counter;
+      setAllocObserver(&counter);
+
+      int rc = check_rejected(counter);
+      setAllocObserver(nullptr);
+
+      if (rc)
+         return rc;
+
+      return check_sdt(t);
+   }
+}
@@ -0,0 +1,98 @@
+#include <vector>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   static std::vector<ui8> built_whole(const STable& table)
+   {
+      TStream t;
+      table.buildSections(t);
+
+      BufferSink out;
+      out.write(t);
+      return out.buffer;
+   }
+
+   // builds the table with an iterator, dropping each section once
+   // its data is copied. Also checks how many are held at once
+   static bool iterated(const STable& table, AllocCounter& allocs)
+   {
+      std::vector<ui8> whole = built_whole(table);
+
+      BufferSink out;
+      SectionIterator it(table);
+      ui16 count = it.size(), n = 0;
+
+      while (TStream::SectionPtr s = it.next()) {
+         // every section knows the last one
+         if (s->getBinaryData()[0] != 0x70 && s->getBinaryData()[7] != count - 1)
+            return false;
+
+         out.write(s->getBinaryData(), s->length());
+         n++;
+
+         // the section, the buffer it was shrunk from and maybe a
+         // scratch buffer
+         if (allocs.allocations(AllocKind::SECTION_DATA) -
+             allocs.releases(AllocKind::SECTION_DATA) > 3)
+            return false;
+      }
+      return n == count && it.done() && !it.next() && out.buffer == whole;
+   }
+
+   int iterator(TStream&)
+   {
+      SDTActual sdt(0x20, 0x30, 0x01);
+      for (ui16 i = 0; i < 300; i++) {
+         sdt.addService(i, true, true, 4, false);
+         sdt.addServiceDesc( *new ServiceDesc(0x01, "A provider", "A service") );
+      }
+
+      NITActual nit(0x1000, 1);
+      nit.addNetworkDesc( *new NetworkNameDesc("A network name") );
+      for (ui16 ts = 0; ts < 200; ts++) {
+         nit.addXportStream(ts, 0x1000);
+         nit.addXportStreamDesc( *new CableDeliverySystemDesc(3120000, 68750, 2, 3, 4) );
+      }
+
+      PAT pat(0x20, 1);
+      pat.addProgram(1, 0x100);
+
+      PF_EITActual eit(1, 0x20, 0x30, 1);
+      eit.addPresentEvent(0, UTC(3, 1, 2020, 9, 0, 0), BCDTime(1, 0, 0), 4, false);
+      eit.addPresentEventDesc( *new ShortEventDesc("eng", "News", "") );
+
+      TDT tdt(UTC(3, 1, 2020, 9, 0, 0));
+
+      AllocCounter allocs;
+      int rc = 0;
+      {
+         std::vector<ui8> whole = built_whole(sdt);
+
+         setAllocObserver(&allocs);
+         if (!iterated(sdt, allocs) || !iterated(nit, allocs) || !iterated(pat, allocs) ||
+             !iterated(eit, allocs) || !iterated(tdt, allocs))
+            rc = 1;
+         setAllocObserver(nullptr);
+
+         // a multi-section table, and the rest built whole
+         if (!rc && (SectionIterator(sdt).size() < 3 || SectionIterator(eit).size() != 2 ||
+                     SectionIterator(tdt).size() != 1))
+            rc = 2;
+
+         // stopping part way leaves the table ready to build again
+         if (!rc) {
+            SectionIterator it(sdt);
+            it.next();
+            if (it.remaining() != it.size() - 1)
+               rc = 3;
+         }
+         if (!rc && built_whole(sdt) != whole)
+            rc = 3;
+      }
+      return rc;
+   }
+}
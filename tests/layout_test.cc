@@ -0,0 +1,68 @@
+#include <cstring>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   typedef BitLayout<8, 1, 1, 1, 13, 2, 2, 4> TSHeader;
+
+   // layouts can be packed at compile time
+   struct Packed {
+      ui8 data[TSHeader::BYTES];
+   };
+
+   static constexpr Packed pack_header()
+   {
+      Packed p = {};
+      TSHeader::pack(p.data, 0x47, 0, 1, 0, 0x1234, 0, 1, 0x1f); // cc wraps to 0xf
+      return p;
+   }
+
+   static_assert(TSHeader::BITS == 32 && TSHeader::BYTES == 4, "TS header size");
+   static_assert(pack_header().data[0] == 0x47 &&
+                 pack_header().data[1] == 0x52 &&
+                 pack_header().data[2] == 0x34 &&
+                 pack_header().data[3] == 0x1f, "TS header packing");
+
+   int layout(TStream&)
+   {
+      // fields that straddle byte boundaries in a record wider than
+      // 64 bits: the cable delivery system layout
+      const ui8 expected[] = {
+         0x03, 0x12, 0x00, 0x00,  // frequency
+         0xff, 0xf2,              // reserved, FEC_outer
+         0x03,                    // modulation
+         0x00, 0x06, 0x87, 0x54   // symbol_rate, FEC_inner
+      };
+
+      Section s(64);
+      BitLayout<32, 12, 4, 8, 28, 4>::write(s, 0x03120000, 0xfff, 2, 3, 0x0006875, 4);
+
+      if (s.length() != sizeof(expected) ||
+          memcmp(s.getBinaryData(), expected, sizeof(expected)))
+         return 1;
+
+      // values are masked to their field width
+      ui8 b[2];
+      BitLayout<4, 12>::pack(b, 0xab, 0xfedc);
+      if (b[0] != 0xbe || b[1] != 0xdc)
+         return 1;
+
+      // bulk writers copy through a single reserved run
+      Section w(16);
+      const std::vector<ui8> v = { 0x01, 0x02 };
+      ui8 *cur = w.reserve(2);
+      cur[0] = 0xaa; cur[1] = 0xbb;
+      w.setBits(std::string_view("xyz"));
+      w.setBits(v);
+
+      const ui8 bulk[] = { 0xaa, 0xbb, 'x', 'y', 'z', 0x01, 0x02 };
+      if (w.length() != sizeof(bulk) ||
+          memcmp(w.getBinaryData(), bulk, sizeof(bulk)))
+         return 1;
+
+      return 0;
+   }
+}
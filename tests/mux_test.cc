@@ -0,0 +1,174 @@
+#include <map>
+#include <vector>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   enum { PACKET_SIZE = TsMux::PACKET_SIZE };
+
+   static ui16 pid_of(const ui8* p) { return ((p[1] & 0x1f) << 8) | p[2]; }
+
+   // the packets of each PID in the output
+   static std::map<ui16, std::vector<ui8> > demux(const std::vector<ui8>& ts)
+   {
+      std::map<ui16, std::vector<ui8> > pids;
+      for (std::size_t i = 0; i < ts.size(); i += PACKET_SIZE) {
+         auto& p = pids[pid_of(&ts[i])];
+         p.insert(p.end(), &ts[i], &ts[i] + PACKET_SIZE);
+      }
+      return pids;
+   }
+
+   // the sections of each stream packetized on their own, in cycles
+   static std::vector<ui8> alone(const TStream& t, ui16 pid, int cycles = 1)
+   {
+      BufferSink out;
+      MpgPacketizer pkt(out, 0);
+      for (int i = 0; i < cycles; i++) {
+         for (const auto& s : t.section_list)
+            pkt.packetize(*s, pid);
+      }
+      return out.buffer;
+   }
+
+   // the PIDs of the output packets, in order
+   static std::vector<ui16> pid_order(const std::vector<ui8>& ts)
+   {
+      std::vector<ui16> pids;
+      for (std::size_t i = 0; i < ts.size(); i += PACKET_SIZE)
+         pids.push_back(pid_of(&ts[i]));
+      return pids;
+   }
+
+   int mux(TStream&)
+   {
+      PAT pat(0x30, 1);
+      for (ui16 i = 1; i < 100; i++)
+         pat.addProgram(i, 0x100 + i);
+
+      NITActual nit(0x1000, 1);
+      nit.addNetworkDesc( *new NetworkNameDesc("A network name") );
+      for (ui16 ts = 0; ts < 20; ts++)
+         nit.addXportStream(ts, 0x1000);
+
+      SDTActual sdt(0x20, 0x30, 0x01);
+      for (ui16 i = 0; i < 20; i++) {
+         sdt.addService(i, true, true, 4, false);
+         sdt.addServiceDesc( *new ServiceDesc(0x01, "provider", "service") );
+      }
+
+      TDT tdt(UTC(3, 1, 2020, 9, 0, 0));
+
+      TStream pat_t, nit_t, sdt_t, tdt_t;
+      pat.buildSections(pat_t);
+      nit.buildSections(nit_t);
+      sdt.buildSections(sdt_t);
+      tdt.buildSections(tdt_t);
+
+      BufferSink out;
+      TsMux mux(out, 4);
+      mux.addPid(0x00, 2);
+      mux.addPid(0x10, 1);
+      mux.addPid(0x11, 1);
+      mux.addPid(0x14, 0);
+
+      if (!mux.queue(0x00, pat_t) || !mux.queue(0x10, nit_t) ||
+          !mux.queue(0x11, sdt_t) || !mux.queue(0x14, tdt_t) ||
+          mux.queue(0x12, sdt_t))
+         return 1;
+
+      std::size_t total = mux.queued();
+      if (!mux.flush() || mux.queued() != 0 ||
+          out.buffer.size() != total * PACKET_SIZE)
+         return 1;
+
+      // each PID's packets, with their counters, are what a packetizer
+      // for that PID alone would have written
+      auto pids = demux(out.buffer);
+      if (pids[0x00] != alone(pat_t, 0x00) || pids[0x10] != alone(nit_t, 0x10) ||
+          pids[0x11] != alone(sdt_t, 0x11) || pids[0x14] != alone(tdt_t, 0x14))
+         return 2;
+
+      // the PAT first, then the NIT and SDT taking turns, then the TDT
+      std::vector<ui16> order = pid_order(out.buffer);
+      std::size_t n_pat = pids[0x00].size() / PACKET_SIZE,
+         n_nit = pids[0x10].size() / PACKET_SIZE,
+         n_sdt = pids[0x11].size() / PACKET_SIZE;
+      for (std::size_t i = 0; i < order.size(); i++) {
+         ui16 expected;
+         if (i < n_pat)
+            expected = 0x00;
+         else if (i < n_pat + 2 * std::min(n_nit, n_sdt))
+            expected = ((i - n_pat) % 2) ? 0x11 : 0x10;
+         else if (i < n_pat + n_nit + n_sdt)
+            expected = (n_nit > n_sdt) ? 0x10 : 0x11;
+         else
+            expected = 0x14;
+
+         if (order[i] != expected)
+            return 3;
+      }
+
+      // the counters carry on from one cycle to the next, also when
+      // sending only part of the queue
+      mux.queue(0x00, pat_t);
+      if (mux.mux(1) != 1 || !mux.flush())
+         return 4;
+      pids = demux(out.buffer);
+      if (pids[0x00] != alone(pat_t, 0x00, 2))
+         return 4;
+
+      // weights: 3 packets of one PID for each of the other
+      BufferSink out2;
+      TsMux wmux(out2);
+      wmux.addPid(0x10, 0, 3);
+      wmux.addPid(0x11, 0, 1, 5);
+      for (int i = 0; i < 4; i++)
+         wmux.queue(0x10, pat_t);
+      wmux.queue(0x11, pat_t);
+      wmux.flush();
+
+      order = pid_order(out2.buffer);
+      std::size_t n = n_pat; // of the lighter PID
+      for (std::size_t i = 0; i < 4 * n; i++) {
+         if (order[i] != ((i % 4 == 3) ? 0x11 : 0x10))
+            return 5;
+      }
+      if (wmux.continuityCounter(0x11) != ((5 + n) & 0x0f))
+         return 5;
+
+      // cached packets queued through a PID's input
+      BufferSink out3;
+      TsMux cmux(out3);
+      PacketCache cache;
+      ui8 cc = 0;
+      cache.emit(nit, 0x10, cc, cmux.input(0x10));
+      cache.emit(nit, 0x10, cc, cmux.input(0x10));
+      cmux.flush();
+      if (out3.buffer != alone(nit_t, 0x10, 2) || cmux.input(0x10).write(out3.buffer.data(), 1))
+         return 6;
+
+      // the input of an invalid PID rejects packets
+      if (cmux.input(TsMux::MAX_PID).write(out3.buffer.data(), PACKET_SIZE))
+         return 6;
+
+      // a carousel fed a cycle ahead of the mux, so its queue never
+      // empties, sends every cycle
+      BufferSink out4;
+      TsMux amux(out4);
+      amux.addPid(0x00);
+      amux.queue(0x00, pat_t);
+      for (int i = 0; i < 50; i++) {
+         amux.queue(0x00, pat_t);
+         amux.mux(n_pat);
+      }
+      amux.flush();
+      if (out4.buffer != alone(pat_t, 0x00, 51))
+         return 7;
+
+      return 0;
+   }
+}
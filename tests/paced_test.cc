@@ -0,0 +1,124 @@
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   typedef std::chrono::steady_clock clock;
+
+   static void packetize(OutputSink& out)
+   {
+      SDTActual sdt(0x20, 0x30, 0x01);
+      for (ui16 i = 0; i < 60; i++) {
+         sdt.addService(i, true, true, 4, false);
+         sdt.addServiceDesc( *new ServiceDesc(0x01, "provider", "service") );
+      }
+
+      TStream t;
+      sdt.buildSections(t);
+
+      MpgPacketizer pkt(out, 0);
+      for (const auto& s : t.section_list)
+         pkt.packetize(*s, 0x11);
+   }
+
+   //
+   // reads the FIFO, recording when the data arrived. Checks the rate
+   // and that the SI packets came through in order
+   static int read_fifo(const char* name, const std::vector<ui8>& si, ui32 bitrate)
+   {
+      int fd = open(name, O_RDONLY);
+      if (fd < 0)
+         return 1;
+
+      std::vector<ui8> got;
+      std::vector<std::pair<clock::time_point, std::size_t> > arrivals;
+      ui8 buf[4096];
+      ssize_t n;
+      while ((n = read(fd, buf, sizeof(buf))) > 0) {
+         got.insert(got.end(), buf, buf + n);
+         arrivals.emplace_back(clock::now(), got.size());
+      }
+      close(fd);
+
+      // the rate from the end of the first read to the last
+      if (got.size() % PacedSink::PACKET_SIZE || arrivals.size() < 10)
+         return 1;
+      double secs = std::chrono::duration<double>(arrivals.back().first - arrivals.front().first).count();
+      double rate = (arrivals.back().second - arrivals.front().second) * 8 / secs;
+      if (rate < bitrate * 0.9 || rate > bitrate * 1.1)
+         return 2;
+
+      // everything except the null packets is the SI
+      std::vector<ui8> pkts;
+      for (std::size_t i = 0; i < got.size(); i += PacedSink::PACKET_SIZE) {
+         ui16 pid = ((got[i + 1] & 0x1f) << 8) | got[i + 2];
+         if (pid != 0x1fff)
+            pkts.insert(pkts.end(), got.begin() + i, got.begin() + i + PacedSink::PACKET_SIZE);
+      }
+      return (pkts == si) ? 0 : 3;
+   }
+
+   //
+   // SI at 1.5 Mbit/s to a FIFO read by another process
+   int paced(TStream&)
+   {
+      BufferSink si;
+      packetize(si);
+
+      std::string name = "/tmp/sigen_paced_" + std::to_string(getpid());
+      if (mkfifo(name.c_str(), 0600) != 0)
+         return 77;
+
+      PacedSink::Options opts;
+      opts.bitrate = 1500000;
+      opts.burst = 7;
+
+      pid_t child = fork();
+      if (child < 0) {
+         unlink(name.c_str());
+         return 77;
+      }
+      if (child == 0)
+         _exit(read_fifo(name.c_str(), si.buffer, opts.bitrate));
+
+      int rc = 0;
+      int fd = open(name.c_str(), O_WRONLY);
+      {
+         FdSink fifo(fd);
+         PacedSink paced(fifo, opts);
+
+         // a cycle of SI, then padding for the rest of the time
+         packetize(paced);
+         if (!paced.run(std::chrono::milliseconds(500)) || paced.queued() != 0)
+            rc = 1;
+
+         const PacedSink::Stats& stats = paced.getStats();
+         if (stats.batches < 50 ||
+             stats.packets != stats.batches * opts.burst ||
+             stats.null_packets == 0 ||
+             stats.packets - stats.null_packets != si.buffer.size() / PacedSink::PACKET_SIZE ||
+             stats.jitter() > paced.interval())
+            rc = 1;
+      }
+      close(fd);
+
+      int status;
+      waitpid(child, &status, 0);
+      unlink(name.c_str());
+
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+         rc = 1;
+      return rc;
+   }
+}
@@ -0,0 +1,111 @@
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   template <class... Pool>
+   static std::vector<ui8> built(const PSITable& table, Pool&... pool)
+   {
+      TStream t;
+      table.buildSections(t, pool...);
+
+      BufferSink out;
+      out.write(t);
+      return out.buffer;
+   }
+
+   // every job runs exactly once, on more than one thread
+   static bool runs_all(ThreadPool& pool)
+   {
+      const std::size_t count = 1000;
+      std::vector<std::atomic<int>> runs(count);
+      pool.run(count, [&](std::size_t i) { runs[i]++; });
+
+      for (auto& r : runs)
+         if (r != 1)
+            return false;
+      return true;
+   }
+
+   // a job's exception is rethrown by run() once the others are done
+   static bool rethrows(ThreadPool& pool)
+   {
+      const std::size_t count = 100;
+      std::vector<std::atomic<int>> runs(count);
+      try {
+         pool.run(count, [&](std::size_t i) {
+               runs[i]++;
+               if (i % 37 == 1)
+                  throw std::runtime_error("job failed");
+            });
+         return false;
+      }
+      catch (const std::runtime_error&) {
+      }
+
+      for (auto& r : runs)
+         if (r != 1)
+            return false;
+      return runs_all(pool);
+   }
+
+   int parallel(TStream&)
+   {
+      Random rnd(1);
+
+      // items split across sections and forced breaks
+      NITActual nit(0x1000, 1);
+      nit.addNetworkDesc( *new NetworkNameDesc("A network name") );
+      nit.addNetworkDesc( *new UtilityDesc(UtilityDesc::SECTION_END_MARK) );
+      for (ui16 ts = 0; ts < 400; ts++) {
+         nit.addXportStream(ts, 0x1000);
+         for (ui16 i = 0, d = rnd() % 8; i < d; i++)
+            nit.emplaceXportStreamDesc<StuffingDesc>(0xff, random_desc_len(rnd));
+      }
+
+      SDTActual sdt(0x20, 0x30, 1);
+      for (ui16 s = 0; s < 1000; s++) {
+         sdt.addService(s, true, true, 4, false);
+         sdt.addServiceDesc( *new ServiceDesc(0x01, "A provider", "A service") );
+      }
+
+      PAT pat(0x20, 1);
+      for (ui16 i = 0; i < 1000; i++)
+         pat.addProgram(i + 1, 0x100 + i);
+
+      CAT cat(1);
+      for (ui16 i = 0; i < 50; i++)
+         cat.emplaceDesc<StuffingDesc>(0xff, random_desc_len(rnd));
+
+      PMT pmt(0x100, 0x101, 1);
+      pmt.addProgramDesc( *new StuffingDesc(0xff, 200) );
+      for (ui16 es = 0; es < 100; es++) {
+         pmt.addElemStream(PMT::ES_ISO_IEC_11172_VIDEO, 0x200 + es);
+         pmt.emplaceElemStreamDesc<StuffingDesc>(0xff, random_desc_len(rnd));
+      }
+
+      PF_EITActual eit(1, 0x20, 0x30, 1);
+      eit.addPresentEvent(0, UTC(3, 1, 2020, 9, 0, 0), BCDTime(1, 0, 0), 4, false);
+
+      const PSITable* tables[] = { &nit, &sdt, &pat, &cat, &pmt, &eit };
+      for (unsigned threads : { 1, 2, 3, 8 }) {
+         ThreadPool pool(threads);
+         if (pool.size() != threads || !runs_all(pool) || !rethrows(pool))
+            return 1;
+
+         // the same bytes as built by a single thread, which can
+         // build it again afterwards
+         for (const PSITable* table : tables) {
+            std::vector<ui8> whole = built(*table);
+            if (built(*table, pool) != whole || built(*table) != whole)
+               return 2;
+         }
+      }
+      return 0;
+   }
+}
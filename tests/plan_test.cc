@@ -0,0 +1,87 @@
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   //
+   // builds the table and checks each section was allocated once, at
+   // the length it was written to, and is numbered correctly
+   static bool planned(const STable& table, AllocCounter& allocs)
+   {
+      TStream t;
+      allocs.reset();
+      table.buildSections(t);
+
+      std::size_t count = t.section_list.size(), bytes = 0, n = 0;
+      for (const auto& s : t.section_list) {
+         const ui8* data = s->getBinaryData();
+         ui16 sec_len = ((data[1] & 0x0f) << 8) | data[2];
+
+         if (sec_len + 3 != s->length() || s->length() > table.getMaxSectionLen() ||
+             data[6] != n++ || data[7] != count - 1)
+            return false;
+         bytes += s->length();
+      }
+      return allocs.allocations(AllocKind::SECTION_DATA) == count &&
+         allocs.bytes(AllocKind::SECTION_DATA) == bytes;
+   }
+
+   int plan(TStream&)
+   {
+      AllocCounter allocs;
+      setAllocObserver(&allocs);
+
+      int rc = 0;
+      Random rnd(1);
+      for (int round = 0; round < 20 && !rc; round++)
+      {
+         PAT pat(0x20, 1);
+         for (ui16 i = 0, num = rnd() % 800; i < num; i++)
+            pat.addProgram(i + 1, 0x100 + i);
+
+         CAT cat(1);
+         for (ui16 i = 0, num = rnd() % 100; i < num; i++)
+            cat.emplaceDesc<StuffingDesc>(0xff, random_desc_len(rnd));
+
+         // programs with descriptors that fill whole sections
+         PMT pmt(0x100, 0x101, 1);
+         for (ui16 i = 0, num = rnd() % 12; i < num; i++)
+            pmt.emplaceProgramDesc<StuffingDesc>(0xff, random_desc_len(rnd));
+         for (ui16 es = 0, num = rnd() % 60; es < num; es++) {
+            pmt.addElemStream(PMT::ES_ISO_IEC_11172_VIDEO, 0x200 + es);
+            for (ui16 i = 0, d = rnd() % 6; i < d; i++)
+               pmt.emplaceElemStreamDesc<StuffingDesc>(0xff, random_desc_len(rnd));
+         }
+
+         // forced section breaks among the network descriptors
+         NITActual nit(0x1000, 1);
+         for (ui16 i = 0, num = rnd() % 12; i < num; i++) {
+            if (rnd() % 4 == 0)
+               nit.emplaceNetworkDesc<UtilityDesc>(UtilityDesc::SECTION_END_MARK);
+            else
+               nit.emplaceNetworkDesc<StuffingDesc>(0xff, random_desc_len(rnd));
+         }
+         for (ui16 ts = 0, num = rnd() % 80; ts < num; ts++) {
+            nit.addXportStream(ts, 0x1000);
+            for (ui16 i = 0, d = rnd() % 5; i < d; i++)
+               nit.emplaceXportStreamDesc<StuffingDesc>(0xff, random_desc_len(rnd));
+         }
+
+         SDTActual sdt(0x20, 0x30, 1);
+         for (ui16 s = 0, num = rnd() % 100; s < num; s++) {
+            sdt.addService(s, true, true, 4, false);
+            for (ui16 i = 0, d = rnd() % 4; i < d; i++)
+               sdt.emplaceServiceDesc<StuffingDesc>(0xff, random_desc_len(rnd));
+         }
+
+         if (!planned(pat, allocs) || !planned(cat, allocs) || !planned(pmt, allocs) ||
+             !planned(nit, allocs) || !planned(sdt, allocs))
+            rc = 1;
+      }
+
+      setAllocObserver(nullptr);
+      return rc;
+   }
+}
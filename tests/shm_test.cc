@@ -0,0 +1,124 @@
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   static void build(TStream& t)
+   {
+      NITActual nit(0x1000, 1);
+      for (ui16 ts = 0; ts < 1000; ts++) {
+         nit.addXportStream(ts, 0x1000);
+         nit.addXportStreamDesc( *new CableDeliverySystemDesc(3120000, 68750, 2, 3, 4) );
+      }
+      nit.buildSections(t);
+   }
+
+   static void packetize(const TStream& t, OutputSink& out)
+   {
+      MpgPacketizer pkt(out, 0);
+      for (const auto& s : t.section_list)
+         pkt.packetize(*s, 0x10);
+   }
+
+   //
+   // a child process packetizes the NIT into a ring smaller than the
+   // table, which this process reads from
+   int shm(TStream& t)
+   {
+      build(t);
+
+      BufferSink expected;
+      packetize(t, expected);
+
+      const std::string name = "/sigen_test_" + std::to_string(getpid());
+      ShmRingWriter ring(name, 32);
+      if (!ring.isOpen())
+         return 77;
+      if (ring.capacity() != 32)
+         return 1;
+
+      pid_t child = fork();
+      if (child < 0)
+         return 77;
+      if (child == 0) {
+         packetize(t, ring);
+         _exit(0);
+      }
+
+      // a ring that doesn't exist can't be opened
+      ShmRingReader none("/sigen_test_none");
+      ShmRingReader reader(name);
+
+      std::vector<ui8> got;
+      std::vector<ui8> buf(16 * ShmRing::PACKET_SIZE);
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while (reader.isOpen() && got.size() < expected.buffer.size() &&
+             std::chrono::steady_clock::now() < deadline) {
+         std::size_t n = reader.read(buf.data(), 16);
+         if (n == 0)
+            sched_yield();
+         got.insert(got.end(), buf.begin(), buf.begin() + n * ShmRing::PACKET_SIZE);
+      }
+
+      if (got.size() < expected.buffer.size())
+         kill(child, SIGKILL);
+
+      int status;
+      waitpid(child, &status, 0);
+
+      if (none.isOpen() || !reader.isOpen() ||
+          !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+          got != expected.buffer || reader.size() != 0)
+         return 1;
+
+      // nothing to release on a ring that isn't open
+      none.release(1);
+
+      // with no reader, a full ring gives up after the timeout and
+      // the packetizer reports it
+      ShmRingWriter unread(name + "_unread", 4);
+      unread.setTimeout(std::chrono::milliseconds(10));
+      MpgPacketizer pkt(unread, 0);
+      for (const auto& s : t.section_list)
+         pkt.packetize(*s, 0x10);
+      if (pkt.good() || unread.size() != unread.capacity())
+         return 1;
+
+      // rings too large to index aren't created, and a reader doesn't
+      // trust a capacity that isn't a power of 2. It's the header's
+      // only 32-bit field holding the ring's size
+      ShmRingWriter huge(name + "_huge", 0x80000001);
+      if (huge.isOpen())
+         return 1;
+
+      int fd = shm_open((name + "_unread").c_str(), O_RDWR, 0);
+      ui32 words[16];
+      bool corrupted = false;
+      if (fd >= 0 && pread(fd, words, sizeof(words), 0) == sizeof(words)) {
+         for (ui32& w : words) {
+            if (w == unread.capacity()) {
+               w = 3;
+               corrupted = pwrite(fd, words, sizeof(words), 0) == sizeof(words);
+               break;
+            }
+         }
+      }
+      if (fd >= 0)
+         close(fd);
+      if (!corrupted || ShmRingReader((name + "_unread")).isOpen())
+         return 1;
+
+      return 0;
+   }
+}
@@ -0,0 +1,777 @@
+//
+// sigen_bench: section build micro-benchmarks. Not part of the test
+// suite - run with 'make bench'
+//
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "../src/sigen.h"
+
+using namespace sigen;
+
+namespace bench
+{
+   typedef std::chrono::steady_clock clock;
+
+   // the time taken by the build step. The fastest run is reported
+   // as it is the least disturbed by everything else on the machine
+   struct Result {
+      ui32 runs = 0;
+      ui32 sections = 0;  // per run
+      ui32 bytes = 0;     // per run
+      std::chrono::nanoseconds best = std::chrono::nanoseconds::max();
+   };
+
+   static void report(const std::string& name, const Result& r)
+   {
+      double ms = std::chrono::duration<double, std::milli>(r.best).count();
+      double mbs = (r.bytes / (1024.0 * 1024.0)) / (ms / 1000.0);
+
+      std::cout << std::left << std::setw(10) << name
+                << std::right << std::fixed << std::setprecision(3)
+                << std::setw(10) << ms << " ms/run "
+                << std::setw(8) << r.sections << " sections "
+                << std::setw(10) << r.bytes << " bytes "
+                << std::setprecision(1) << std::setw(8) << mbs << " MB/s"
+                << std::endl;
+   }
+
+   // runs build() repeatedly for about a second
+   template <class F>
+   static Result run(F build)
+   {
+      Result r;
+      auto start = clock::now(), now = start;
+      do {
+         TStream t;
+         auto t0 = clock::now();
+         build(t);
+         now = clock::now();
+
+         r.best = std::min<std::chrono::nanoseconds>(r.best, now - t0);
+         if (r.runs++ == 0) {
+            for (const auto& s : t.section_list)
+               r.bytes += s->length();
+            r.sections = t.getNumSections();
+         }
+      } while (now - start < std::chrono::seconds(1));
+      return r;
+   }
+
+   //
+   // p/f EITs for many services, each event carrying the usual set of
+   // descriptors
+   static void eit()
+   {
+      const ui16 num_services = 500;
+      std::vector<std::unique_ptr<PF_EITActual> > eits;
+
+      for (ui16 sid = 0; sid < num_services; sid++) {
+         PF_EITActual* eit = new PF_EITActual(sid, 0x30, 0x01, 1);
+         eits.emplace_back(eit);
+
+         for (ui16 ev = 0; ev < 2; ev++) {
+            UTC start(3, 1, 2020, 9 + ev, 0, 0);
+            BCDTime dur(1, 0, 0);
+            if (ev == 0)
+               eit->addPresentEvent(ev, start, dur, 4, false);
+            else
+               eit->addFollowingEvent(ev, start, dur, 1, false);
+
+            Descriptor* d[6];
+            d[0] = new ShortEventDesc("eng", "The name of the event",
+                                      std::string(120, 't'));
+            d[1] = new ExtendedEventDesc("eng", std::string(180, 'x'), 0, 0);
+
+            ContentDesc* cd = new ContentDesc;
+            for (ui8 i = 0; i < 4; i++)
+               cd->addContent(i, i, 0, 0);
+            d[2] = cd;
+
+            ParentalRatingDesc* prd = new ParentalRatingDesc;
+            prd->addRating("GBR", 8);
+            prd->addRating("FRA", 10);
+            prd->addRating("DEU", 12);
+            d[3] = prd;
+
+            d[4] = new ComponentDesc(0x1, 0x3, 1, "eng", "video");
+            d[5] = new ComponentDesc(0x2, 0x3, 2, "eng", "audio");
+
+            for (Descriptor* desc : d) {
+               if (ev == 0)
+                  eit->addPresentEventDesc(*desc);
+               else
+                  eit->addFollowingEventDesc(*desc);
+            }
+         }
+      }
+
+      report("eit", run([&](TStream& t) {
+               for (const auto& eit : eits)
+                  eit->buildSections(t);
+            }));
+   }
+
+   //
+   // a NIT describing many transport streams
+   static void nit()
+   {
+      NITActual nit(0x1000, 1);
+      nit.addNetworkDesc( *new NetworkNameDesc("A network name") );
+
+      for (ui16 ts = 0; ts < 400; ts++) {
+         nit.addXportStream(ts, 0x1000);
+
+         ServiceListDesc* sld = new ServiceListDesc;
+         for (ui16 s = 0; s < 12; s++)
+            sld->addService((ts << 4) | s, 0x01);
+         nit.addXportStreamDesc( *sld );
+
+         nit.addXportStreamDesc( *new CableDeliverySystemDesc(3120000, 68750, 2, 3, 4) );
+      }
+
+      report("nit", run([&](TStream& t) { nit.buildSections(t); }));
+   }
+
+   //
+   // one SDT filled up to the maximum table length (67 sections),
+   // written and crc'd by pools of 1 up to one thread per core
+   static void parallel()
+   {
+      SDTActual sdt(0x20, 0x30, 1);
+      for (ui16 s = 0; sdt.addService(s, true, true, 4, false); s++) {
+         if (!sdt.emplaceServiceDesc<ServiceDesc>(0x01, "A provider", "A service name"))
+            break;
+      }
+
+      report("sdt", run([&](TStream& t) { sdt.buildSections(t); }));
+
+      unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+      for (unsigned threads = 1; threads <= std::max(4u, cores); threads *= 2) {
+         ThreadPool pool(threads);
+         report("sdt x" + std::to_string(threads),
+                run([&](TStream& t) { sdt.buildSections(t, pool); }));
+      }
+   }
+
+   //
+   // the table built with each packing policy, and what the fit
+   // policies save
+   template <class Table>
+   static void pack(const std::string& name, Table& table)
+   {
+      const std::pair<const char*, ExtPSITable::Packing> policies[] = {
+         { "in order", ExtPSITable::PACK_IN_ORDER },
+         { "first fit", ExtPSITable::PACK_FIRST_FIT },
+         { "best fit", ExtPSITable::PACK_BEST_FIT },
+      };
+
+      Result in_order;
+      for (const auto& policy : policies) {
+         table.setPacking(policy.second);
+         Result r = run([&](TStream& t) { table.buildSections(t); });
+         report(name + " " + policy.first, r);
+
+         if (policy.second == ExtPSITable::PACK_IN_ORDER)
+            in_order = r;
+         else
+            std::cout << std::setw(20) << "saved "
+                      << std::setw(8) << int(in_order.sections - r.sections) << " sections "
+                      << std::setw(10) << int(in_order.bytes - r.bytes) << " bytes"
+                      << std::endl;
+      }
+   }
+
+   //
+   // the sections and bytes each packing policy takes for an SDT, NIT
+   // and BAT with items of varied sizes, as an operator's would be
+   static void packing()
+   {
+      std::minstd_rand rnd(1);
+      auto name = [&rnd](const char* base, ui16 n) {
+         return std::string(base) + std::string(rnd() % 16, ' ') + std::to_string(n);
+      };
+
+      SDTActual sdt(0x20, 0x30, 1);
+      for (ui16 s = 0; s < 300; s++) {
+         sdt.addService(s, true, true, 4, s % 4 == 0);
+         sdt.addServiceDesc( *new ServiceDesc(0x01, name("Provider", s % 8), name("Channel", s)) );
+         if (s % 4 == 0) {
+            CAIdentifierDesc* ca = new CAIdentifierDesc;
+            for (ui16 i = 0, n = 1 + rnd() % 3; i < n; i++)
+               ca->addSystemId(0x0100 + i);
+            sdt.addServiceDesc( *ca );
+         }
+      }
+
+      NITActual nit(0x1000, 1);
+      nit.addNetworkDesc( *new NetworkNameDesc("A network name") );
+      BAT bat(0x2000, 1);
+      bat.addBouquetDesc( *new BouquetNameDesc("A bouquet name") );
+      for (ui16 ts = 0; ts < 120; ts++) {
+         // the services and their logical channel numbers
+         nit.addXportStream(ts, 0x1000);
+         ServiceListDesc* sld = new ServiceListDesc;
+         EACEM::LogicalChannelDesc* lcd = new EACEM::LogicalChannelDesc;
+         for (ui16 s = 0, n = 4 + rnd() % 36; s < n; s++) {
+            sld->addService((ts << 6) | s, 0x01);
+            lcd->addLogicalChan((ts << 6) | s, ts * 40 + s);
+         }
+         nit.addXportStreamDesc( *sld );
+         nit.addXportStreamDesc( *new CableDeliverySystemDesc(3120000, 68750, 2, 3, 4) );
+         nit.addXportStreamDesc( *new EACEM::PrivateDataSpecifierDesc );
+         nit.addXportStreamDesc( *lcd );
+
+         bat.addXportStream(ts, 0x1000);
+         sld = new ServiceListDesc;
+         for (ui16 s = 0, n = 1 + rnd() % 30; s < n; s++)
+            sld->addService((ts << 6) | s, 0x01);
+         bat.addXportStreamDesc( *sld );
+      }
+
+      pack("sdt", sdt);
+      pack("nit", nit);
+      pack("bat", bat);
+   }
+
+   //
+   // the sections whose bytes change per edit as the services of an
+   // SDT grow, one 6-byte descriptor at a time, packed in order and
+   // stable with increasing slack
+   static void churn()
+   {
+      const ui16 num_services = 300;
+      const int edits = 100;
+
+      auto sections = [](const SDT& sdt) {
+         TStream t;
+         sdt.buildSections(t);
+         std::vector<std::vector<ui8> > data;
+         for (const auto& s : t.section_list)
+            data.emplace_back(s->getBinaryData(), s->getBinaryData() + s->length());
+         return data;
+      };
+
+      const std::pair<ExtPSITable::Packing, ui16> policies[] = {
+         { ExtPSITable::PACK_IN_ORDER, 0 },
+         { ExtPSITable::PACK_STABLE, 0 },
+         { ExtPSITable::PACK_STABLE, 16 },
+         { ExtPSITable::PACK_STABLE, 32 },
+         { ExtPSITable::PACK_STABLE, 64 },
+      };
+      for (const auto& policy : policies) {
+         std::minstd_rand rnd(1);
+         SDTActual sdt(0x20, 0x30, 1);
+         for (ui16 s = 0; s < num_services; s++) {
+            sdt.addService(s, true, true, 4, false);
+            sdt.addServiceDesc( *new ServiceDesc(0x01, "A provider",
+                                                 "Channel" + std::string(rnd() % 16, ' ') +
+                                                 std::to_string(s)) );
+            CAIdentifierDesc* ca = new CAIdentifierDesc;
+            for (ui16 i = 0, n = 1 + rnd() % 4; i < n; i++)
+               ca->addSystemId(0x0100 + i);
+            sdt.addServiceDesc( *ca );
+         }
+         sdt.setPacking(policy.first, policy.second);
+
+         // a change in the number of sections changes them all, as
+         // each carries the last_section_number
+         auto before = sections(sdt);
+         std::size_t first = before.size(), changed = 0, spread = 0, recounted = 0;
+         for (int edit = 0; edit < edits; edit++) {
+            sdt.addServiceDesc(rnd() % num_services, *new PrivateDataSpecifierDesc(edit));
+
+            auto after = sections(sdt);
+            if (after.size() == before.size()) {
+               std::size_t n = 0;
+               for (std::size_t i = 0; i < after.size(); i++)
+                  n += (after[i] != before[i]);
+               changed += n;
+               spread += (n > 1);
+            }
+            else
+               recounted++;
+            before = after;
+         }
+
+         std::string name = (policy.first == ExtPSITable::PACK_IN_ORDER) ? "in order" :
+            "stable " + std::to_string(policy.second);
+         std::cout << std::left << std::setw(10) << name
+                   << std::right << std::fixed << std::setprecision(2)
+                   << std::setw(4) << first << " -> " << std::setw(3) << before.size() << " sections "
+                   << std::setw(6) << double(changed) / (edits - recounted) << " changed/edit "
+                   << std::setw(4) << spread << " edits changed >1 "
+                   << std::setw(4) << recounted << " changed all"
+                   << std::endl;
+      }
+   }
+
+   //
+   // writes 100 MB of sections to a file
+   static void write()
+   {
+      TStream t;
+      Stuffing st(4093, 0xff); // a full section
+      ui32 bytes = 0;
+      while (bytes < 100 * 1024 * 1024) {
+         st.buildSections(t);
+         bytes += t.section_list.back()->length();
+      }
+
+      char name[] = "/tmp/sigen_benchXXXXXX";
+      int fd = mkstemp(name);
+      if (fd < 0) {
+         std::cerr << "write: can't create a temporary file" << std::endl;
+         return;
+      }
+      close(fd);
+
+      Result r;
+      r.sections = t.getNumSections();
+      r.bytes = bytes;
+      for (int i = 0; i < 5; i++) {
+         auto t0 = clock::now();
+         t.write(std::string(name));
+         r.best = std::min<std::chrono::nanoseconds>(r.best, clock::now() - t0);
+         r.runs++;
+      }
+      unlink(name);
+
+      report("write", r);
+   }
+
+   //
+   // time spent in each packetize() call for 25 MB of sections,
+   // written to a file with blocking writes and asynchronously
+   static void packetize_to(const std::string& name, const TStream& t,
+                            OutputSink& out, const char* fname)
+   {
+      std::vector<double> us;
+      us.reserve(t.getNumSections());
+
+      MpgPacketizer pkt(out, 0);
+      auto start = clock::now();
+      for (const auto& s : t.section_list) {
+         auto t0 = clock::now();
+         pkt.packetize(*s, 0x12);
+         us.push_back(std::chrono::duration<double, std::micro>(clock::now() - t0).count());
+      }
+      out.flush();
+      double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+      std::sort(us.begin(), us.end());
+      std::cout << std::left << std::setw(10) << name
+                << std::right << std::fixed << std::setprecision(1)
+                << std::setw(10) << ms << " ms total "
+                << std::setw(8) << us[us.size() / 2] << " us p50 "
+                << std::setw(8) << us[us.size() * 99 / 100] << " us p99 "
+                << std::setw(10) << us.back() << " us max"
+                << std::endl;
+      unlink(fname);
+   }
+
+   static void async()
+   {
+      TStream t;
+      Stuffing st(4093, 0xff);
+      for (ui32 i = 0; i < 6400; i++)
+         st.buildSections(t);
+
+      const char* fname = "/tmp/sigen_bench_async.ts";
+      {
+         FdSink out(fname);
+         packetize_to("blocking", t, out, fname);
+      }
+
+      for (bool use_io_uring : { true, false }) {
+         int fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+         {
+            AsyncWriter::Options opts;
+            opts.use_io_uring = use_io_uring;
+            AsyncWriter out(fd, opts);
+            packetize_to(out.backend() == AsyncWriter::IO_URING ? "io_uring" : "thread",
+                         t, out, fname);
+         }
+         close(fd);
+      }
+   }
+
+   // discards its packets, so only the cost of producing them is timed
+   struct NullSink : public OutputSink {
+      ui64 bytes = 0;
+      virtual bool write(const ui8*, size_t len) { bytes += len; return true; }
+   };
+
+   //
+   // one repetition cycle of a PAT and a large NIT: packetizing the
+   // built sections each time vs re-sending them from a PacketCache
+   static void cache()
+   {
+      PAT pat(0x30, 1);
+      for (ui16 i = 1; i < 200; i++)
+         pat.addProgram(i, 0x100 + i);
+
+      NITActual nit(0x1000, 1);
+      for (ui16 ts = 0; ts < 400; ts++) {
+         nit.addXportStream(ts, 0x1000);
+         ServiceListDesc* sld = new ServiceListDesc;
+         for (ui16 s = 0; s < 12; s++)
+            sld->addService((ts << 4) | s, 0x01);
+         nit.addXportStreamDesc( *sld );
+      }
+
+      TStream pat_t, nit_t;
+      pat.buildSections(pat_t);
+      nit.buildSections(nit_t);
+
+      NullSink out;
+      MpgPacketizer pat_pkt(out, 0), nit_pkt(out, 0);
+      PacketCache pc;
+      ui8 pat_cc = 0, nit_cc = 0;
+
+      for (bool cached : { false, true }) {
+         Result r;
+         r.sections = pat_t.getNumSections() + nit_t.getNumSections();
+         auto start = clock::now(), now = start;
+         do {
+            ui64 bytes = out.bytes;
+            auto t0 = clock::now();
+            if (cached) {
+               pc.emit(pat, 0x00, pat_cc, out);
+               pc.emit(nit, 0x10, nit_cc, out);
+            } else {
+               for (const auto& s : pat_t.section_list)
+                  pat_pkt.packetize(*s, 0x00);
+               for (const auto& s : nit_t.section_list)
+                  nit_pkt.packetize(*s, 0x10);
+            }
+            now = clock::now();
+            r.bytes = out.bytes - bytes;
+            // the first emit fills the cache
+            if (!cached || r.runs > 0)
+               r.best = std::min<std::chrono::nanoseconds>(r.best, now - t0);
+            r.runs++;
+         } while (now - start < std::chrono::seconds(1));
+
+         report(cached ? "cached" : "packetize", r);
+      }
+   }
+
+   //
+   // packets per second through a TsMux interleaving five PIDs of
+   // different priorities, queued as ready made packets
+   static void mux()
+   {
+      const ui16 pids[] = { 0x00, 0x10, 0x11, 0x12, 0x14 };
+      const ui8 priorities[] = { 3, 2, 2, 1, 0 };
+
+      // four full sections of each PID per cycle
+      TStream t;
+      Stuffing st(4093, 0xff);
+      st.buildSections(t);
+
+      std::vector<ui8> pkts[5];
+      for (int i = 0; i < 5; i++) {
+         BufferSink b;
+         MpgPacketizer pkt(b, 0);
+         for (int j = 0; j < 4; j++)
+            pkt.packetize(*t.section_list.front(), pids[i]);
+         pkts[i] = std::move(b.buffer);
+      }
+
+      NullSink out;
+      TsMux mux(out);
+      for (int i = 0; i < 5; i++)
+         mux.addPid(pids[i], priorities[i]);
+
+      ui64 packets = 0;
+      auto start = clock::now(), now = start;
+      do {
+         for (int i = 0; i < 5; i++)
+            mux.input(pids[i]).write(pkts[i].data(), pkts[i].size());
+         mux.flush();
+         now = clock::now();
+      } while (now - start < std::chrono::seconds(1));
+      packets = out.bytes / TsMux::PACKET_SIZE;
+
+      double secs = std::chrono::duration<double>(now - start).count();
+      std::cout << std::left << std::setw(10) << "mux"
+                << std::right << std::fixed << std::setprecision(2)
+                << std::setw(10) << packets / secs / 1e6 << " Mpackets/s "
+                << std::setprecision(1)
+                << std::setw(8) << (out.bytes / (1024.0 * 1024.0)) / secs << " MB/s"
+                << std::endl;
+   }
+
+   // tracks the bytes held by the library and their high-water mark
+   struct PeakBytes : public AllocObserver {
+      std::size_t cur = 0, peak = 0;
+
+      virtual void allocated(AllocKind, std::size_t bytes) {
+         peak = std::max(peak, cur += bytes);
+      }
+      virtual void released(AllocKind, std::size_t bytes) { cur -= bytes; }
+   };
+
+   //
+   // memory held by the sections of many small p/f EITs (one short
+   // event each) built into one stream
+   static void rss()
+   {
+      const ui16 num_services = 10000;
+      std::vector<std::unique_ptr<PF_EITActual> > eits;
+
+      for (ui16 sid = 0; sid < num_services; sid++) {
+         PF_EITActual* eit = new PF_EITActual(sid, 0x30, 0x01, 1);
+         eits.emplace_back(eit);
+
+         eit->addPresentEvent(0, UTC(3, 1, 2020, 9, 0, 0), BCDTime(1, 0, 0), 4, false);
+         eit->addPresentEventDesc( *new ShortEventDesc("eng", "News", "") );
+      }
+
+      PeakBytes held;
+      setAllocObserver(&held);
+      {
+         TStream t;
+         for (const auto& eit : eits)
+            eit->buildSections(t);
+
+         ui32 bytes = 0;
+         for (const auto& s : t.section_list)
+            bytes += s->length();
+
+         rusage ru;
+         getrusage(RUSAGE_SELF, &ru);
+
+         std::cout << std::left << std::setw(10) << "rss"
+                   << std::right
+                   << std::setw(8) << t.getNumSections() << " sections "
+                   << std::setw(10) << bytes << " bytes "
+                   << std::setw(10) << held.peak / 1024 << " KiB peak held "
+                   << std::setw(10) << ru.ru_maxrss << " KiB max RSS"
+                   << std::endl;
+      }
+      setAllocObserver(nullptr);
+   }
+
+   //
+   // the SDT and p/f EITs of a 50 TS network as carried in each of
+   // its multiplexes: Actual for its own TS, Other for the rest
+   struct Network {
+      enum { NUM_TS = 50, NUM_SERVICES = 20 };
+
+      std::vector<std::unique_ptr<STable> > actual, other;  // per TS
+
+      Network() {
+         for (ui16 ts = 0; ts < NUM_TS; ts++) {
+            SDTActual* sa = new SDTActual(ts, 0x30, 0x01);
+            SDTOther* so = new SDTOther(ts, 0x30, 0x01);
+            actual.emplace_back(sa);
+            other.emplace_back(so);
+
+            for (ui16 i = 0; i < NUM_SERVICES; i++) {
+               ui16 sid = (ts << 8) | i;
+               for (SDT* sdt : { static_cast<SDT*>(sa), static_cast<SDT*>(so) }) {
+                  sdt->addService(sid, true, true, 4, false);
+                  sdt->addServiceDesc( *new ServiceDesc(0x01, "A provider", "A service") );
+               }
+
+               PF_EITActual* ea = new PF_EITActual(sid, ts, 0x30, 1);
+               PF_EITOther* eo = new PF_EITOther(sid, ts, 0x30, 1);
+               actual.emplace_back(ea);
+               other.emplace_back(eo);
+               for (PF_EIT* eit : { static_cast<PF_EIT*>(ea), static_cast<PF_EIT*>(eo) }) {
+                  eit->addPresentEvent(0, UTC(3, 1, 2020, 9, 0, 0), BCDTime(1, 0, 0), 4, false);
+                  eit->addPresentEventDesc( *new ShortEventDesc("eng", "News", "The news") );
+                  eit->addFollowingEvent(1, UTC(3, 1, 2020, 10, 0, 0), BCDTime(1, 0, 0), 1, false);
+                  eit->addFollowingEventDesc( *new ShortEventDesc("eng", "Film", "A film") );
+               }
+            }
+         }
+      }
+
+      // the sections of one multiplex
+      void build(TStream& t, ui16 mux) const {
+         for (std::size_t i = 0; i < actual.size(); i++)
+            ((i / (NUM_SERVICES + 1) == mux) ? actual[i] : other[i])->buildSections(t);
+      }
+
+      void build(TStream& t) const {
+         for (ui16 mux = 0; mux < NUM_TS; mux++)
+            build(t, mux);
+      }
+   };
+
+   //
+   // memory released by TStream::dedup() on the sections of all the
+   // multiplexes of a Network and the cost of detecting an unchanged
+   // cycle by hash vs comparing the data
+   static void dedup()
+   {
+      Network net;
+      auto build = [&](TStream& t) { net.build(t); };
+
+      PeakBytes held;
+      setAllocObserver(&held);
+      {
+         TStream t;
+         build(t);
+
+         ui32 bytes = 0;
+         for (const auto& s : t.section_list)
+            bytes += s->length();
+         std::size_t before = held.cur;
+
+         auto t0 = clock::now();
+         std::size_t released = t.dedup();
+         double dedup_ms = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+         std::size_t after = held.cur;
+
+         std::cout << std::left << std::setw(10) << "dedup"
+                   << std::right << std::fixed << std::setprecision(1)
+                   << std::setw(8) << t.section_list.size() << " sections "
+                   << std::setw(10) << bytes << " bytes "
+                   << std::setw(10) << released << " released "
+                   << std::setw(6) << before / 1024 << " -> " << after / 1024 << " KiB held "
+                   << std::setprecision(3) << std::setw(8) << dedup_ms << " ms"
+                   << std::endl;
+
+         // a cycle rebuilt with no changes: its hash vs a byte compare
+         // with the previous one (which has to be kept for it). Best
+         // of 10
+         TStream prev;
+         build(prev);
+         ui64 prev_hash = prev.getHash();
+         bool same_hash = false, same_data = false;
+         std::chrono::nanoseconds by_hash = std::chrono::nanoseconds::max(), by_data = by_hash;
+         for (int i = 0; i < 10; i++) {
+            auto t1 = clock::now();
+            same_hash = (t.getHash() == prev_hash);
+            auto t2 = clock::now();
+            same_data = std::equal(t.section_list.begin(), t.section_list.end(),
+                                   prev.section_list.begin(), prev.section_list.end(),
+                                   [](const TStream::SectionPtr& a, const TStream::SectionPtr& b) {
+                                      return a->length() == b->length() &&
+                                         memcmp(a->getBinaryData(), b->getBinaryData(), a->length()) == 0;
+                                   });
+            auto t3 = clock::now();
+            by_hash = std::min<std::chrono::nanoseconds>(by_hash, t2 - t1);
+            by_data = std::min<std::chrono::nanoseconds>(by_data, t3 - t2);
+         }
+
+         std::cout << std::left << std::setw(10) << "unchanged"
+                   << std::right << std::fixed << std::setprecision(3)
+                   << std::setw(10) << std::chrono::duration<double, std::milli>(by_hash).count()
+                   << " ms by hash (" << (same_hash ? "same" : "changed") << ") "
+                   << std::setw(10) << std::chrono::duration<double, std::milli>(by_data).count()
+                   << " ms by compare (" << (same_data ? "same" : "changed") << ")"
+                   << std::endl;
+      }
+      setAllocObserver(nullptr);
+   }
+
+   //
+   // restarting with the sections of a Network's multiplexes: creating
+   // the tables and building them vs mapping a snapshot and copying
+   // them out of it
+   static void snapshot()
+   {
+      typedef std::chrono::duration<double, std::milli> ms;
+
+      auto t0 = clock::now();
+      std::vector<TStream> muxes(Network::NUM_TS);
+      {
+         Network net;
+         for (ui16 mux = 0; mux < Network::NUM_TS; mux++)
+            net.build(muxes[mux], mux);
+      }
+      double build_ms = ms(clock::now() - t0).count();
+
+      char name[] = "/tmp/sigen_benchXXXXXX";
+      int fd = mkstemp(name);
+      if (fd < 0) {
+         std::cerr << "snapshot: can't create a temporary file" << std::endl;
+         return;
+      }
+      close(fd);
+
+      t0 = clock::now();
+      SnapshotWriter w;
+      for (ui16 mux = 0; mux < Network::NUM_TS; mux++)
+         w.addStream(mux, muxes[mux], mux & 0x0f);
+      w.write(name);
+      double write_ms = ms(clock::now() - t0).count();
+
+      t0 = clock::now();
+      ui32 sections = 0;
+      {
+         SnapshotReader r(name);
+         std::vector<TStream> restored(r.numStreams());
+         for (std::size_t i = 0; i < r.numStreams(); i++) {
+            r.getSections(i, restored[i]);
+            sections += restored[i].section_list.size();
+         }
+      }
+      double load_ms = ms(clock::now() - t0).count();
+
+      struct stat st;
+      stat(name, &st);
+      unlink(name);
+
+      std::cout << std::left << std::setw(10) << "snapshot"
+                << std::right << std::fixed << std::setprecision(1)
+                << std::setw(8) << sections << " sections "
+                << std::setw(8) << st.st_size / 1024 << " KiB "
+                << std::setw(8) << build_ms << " ms build "
+                << std::setw(8) << write_ms << " ms write "
+                << std::setw(8) << load_ms << " ms load"
+                << std::endl;
+   }
+}
+
+int main(int argc, char* argv[])
+{
+   std::map<std::string, void (*)()> benches = {
+      { "-eit", bench::eit },
+      { "-nit", bench::nit },
+      { "-rss", bench::rss },
+      { "-write", bench::write },
+      { "-async", bench::async },
+      { "-cache", bench::cache },
+      { "-mux", bench::mux },
+      { "-dedup", bench::dedup },
+      { "-snapshot", bench::snapshot },
+      { "-parallel", bench::parallel },
+      { "-packing", bench::packing },
+      { "-churn", bench::churn },
+   };
+
+   if (argc > 1) {
+      for (int i = 1; i < argc; i++) {
+         auto b = benches.find(argv[i]);
+         if (b == benches.end()) {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+         }
+         b->second();
+      }
+      return EXIT_SUCCESS;
+   }
+
+   for (const auto& b : benches)
+      b.second();
+   return EXIT_SUCCESS;
+}
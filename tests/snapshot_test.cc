@@ -0,0 +1,144 @@
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   static bool same_sections(const TStream& a, const TStream& b)
+   {
+      BufferSink x, y;
+      x.write(a);
+      y.write(b);
+      return x.buffer == y.buffer;
+   }
+
+   int snapshot(TStream&)
+   {
+      char name[] = "/tmp/sigen_snapshotXXXXXX";
+      int fd = mkstemp(name);
+      if (fd < 0)
+         return 1;
+      close(fd);
+
+      VersionManager vm;
+      PAT pat(0x20, 3);
+      pat.addProgram(1, 0x100);
+
+      SDTActual sdt(0x20, 0x30, 9);
+      for (ui16 i = 0; i < 100; i++) {
+         sdt.addService(i, true, true, 4, false);
+         sdt.addServiceDesc( *new ServiceDesc(0x01, "provider", "service") );
+      }
+
+      TStream pat_t, sdt_t;
+      vm.build(pat, pat_t);
+      vm.build(sdt, sdt_t);
+
+      // the counters after a cycle has been sent
+      BufferSink out;
+      TsMux mux(out);
+      mux.addPid(0x00);
+      mux.addPid(0x11);
+      mux.queue(0x00, pat_t);
+      mux.queue(0x11, sdt_t);
+      mux.flush();
+
+      SnapshotWriter w;
+      w.addStream(0x00, pat_t, mux.continuityCounter(0x00));
+      w.addStream(0x11, sdt_t, mux.continuityCounter(0x11));
+      w.addVersions(vm);
+
+      int rc = 0;
+      if (!w.write(name))
+         rc = 1;
+
+      if (!rc) {
+         SnapshotReader r(name);
+         if (!r.isOpen() || r.numStreams() != 2 ||
+             r.getPid(0) != 0x00 || r.getPid(1) != 0x11 ||
+             r.getContinuityCounter(0) != mux.continuityCounter(0x00) ||
+             r.getContinuityCounter(1) != mux.continuityCounter(0x11) ||
+             r.numSections(1) != sdt_t.getNumSections())
+            rc = 2;
+
+         // the sections, in place and copied
+         ui16 len = 0;
+         const ui8* d = r.getSectionData(1, 0, len);
+         const Section& first = *sdt_t.section_list.front();
+         if (!rc && (len != first.length() || memcmp(d, first.getBinaryData(), len) != 0))
+            rc = 3;
+
+         TStream p, s;
+         r.getSections(0, p);
+         r.getSections(1, s);
+         if (!rc && (!same_sections(p, pat_t) || !same_sections(s, sdt_t)))
+            rc = 3;
+
+         // the versions: an unchanged table keeps its version
+         VersionManager restored;
+         r.restore(restored);
+         SDTActual again(0x20, 0x30, 0);
+         for (ui16 i = 0; i < 100; i++) {
+            again.addService(i, true, true, 4, false);
+            again.addServiceDesc( *new ServiceDesc(0x01, "provider", "service") );
+         }
+         TStream t;
+         if (!rc && (restored.size() != 2 || restored.build(again, t) ||
+                     again.getVersionNumber() != 9))
+            rc = 4;
+      }
+
+      // nor one with a section record pointing past the data, even if
+      // its end wraps around. The PAT's record is the first at offset 0
+      if (!rc) {
+         ui16 pat_len = pat_t.section_list.front()->length();
+         ui8 rec[16] = { 0 };
+         memcpy(rec + 8, &pat_len, sizeof(pat_len));
+
+         std::string file;
+         int f = open(name, O_RDWR);
+         char buf[4096];
+         for (ssize_t n; f >= 0 && (n = read(f, buf, sizeof(buf))) > 0; )
+            file.append(buf, n);
+
+         std::size_t at = file.find(std::string(reinterpret_cast<char*>(rec), sizeof(rec)));
+         ui64 offset = ~static_cast<ui64>(0) - pat_len + 1;
+         if (at == std::string::npos || at % 8 != 0 ||
+             pwrite(f, &offset, sizeof(offset), at) != sizeof(offset))
+            rc = 5;
+         else {
+            SnapshotReader r(name);
+            if (r.isOpen())
+               rc = 5;
+         }
+
+         // or at data that isn't the section it says, which would
+         // otherwise be handed to the packetizer
+         ui64 zero = 0;
+         ui16 longer = pat_len + 1;
+         if (!rc && (pwrite(f, &zero, sizeof(zero), at) != sizeof(zero) ||
+                     !SnapshotReader(name).isOpen() ||
+                     pwrite(f, &longer, sizeof(longer), at + 8) != sizeof(longer) ||
+                     SnapshotReader(name).isOpen()))
+            rc = 5;
+         if (f >= 0)
+            close(f);
+      }
+
+      // a damaged file isn't used
+      if (!rc && truncate(name, 100) == 0) {
+         SnapshotReader r(name);
+         if (r.isOpen() || r.numStreams() != 0)
+            rc = 6;
+      }
+
+      unlink(name);
+      return rc;
+   }
+}
@@ -0,0 +1,50 @@
+#include <numeric>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   int stats(TStream& t)
+   {
+#ifdef ENABLE_BUILD_STATS
+      // enough services to split the table into a few sections
+      SDTActual sdt(0x20, 0x30, 0x01);
+
+      const int num_services = 40;
+      for (int i = 0; i < num_services; i++) {
+         sdt.addService(100 + i, true, true, 4, false);
+         sdt.addServiceDesc( *new ServiceDesc(0x01, "provider", "service") );
+         sdt.addServiceDesc( *new StuffingDesc('s', 60) );
+      }
+
+      sdt.buildSections(t);
+
+      const BuildStats& stats = sdt.getBuildStats();
+
+      ui32 bytes = std::accumulate(t.section_list.begin(), t.section_list.end(), 0,
+                                   [](ui32 n, const TStream::SectionPtr& s) { return n + s->length(); });
+
+      if (stats.sections < 2 ||
+          stats.sections != t.getNumSections() ||
+          stats.slack.size() != stats.sections ||
+          stats.bytes != bytes ||
+          stats.items < num_services ||
+          stats.descriptors != num_services * 2 ||
+          stats.totalSlack() != stats.sections * sdt.getMaxSectionLen() - bytes)
+         return 1;
+
+      // stats are reset on each build
+      TStream t2;
+      sdt.buildSections(t2);
+      if (sdt.getBuildStats().sections != stats.sections)
+         return 1;
+
+      return 0;
+#else
+      // not compiled in - skip
+      return 77;
+#endif
+   }
+}
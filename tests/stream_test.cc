@@ -0,0 +1,152 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   // counts the bytes held from the default resource
+   struct HeldBytesResource : public std::pmr::memory_resource {
+      long bytes = 0;
+
+      void* do_allocate(std::size_t n, std::size_t align) override {
+         bytes += n;
+         return std::pmr::new_delete_resource()->allocate(n, align);
+      }
+      void do_deallocate(void* p, std::size_t n, std::size_t align) override {
+         bytes -= n;
+         std::pmr::new_delete_resource()->deallocate(p, n, align);
+      }
+      bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override {
+         return this == &o;
+      }
+   };
+
+   // builds an SDT into a stream of its own, as a worker would
+   static TStream build_sdt(ui16 tsid)
+   {
+      SDTActual sdt(0x20, tsid, 0x01);
+      for (ui16 i = 0; i < 100; i++) {
+         sdt.addService(i, true, true, 4, false);
+         sdt.addServiceDesc( *new ServiceDesc(0x01, "provider", "service") );
+      }
+
+      TStream t;
+      sdt.buildSections(t);
+      return t;
+   }
+
+   // the data buffers of the stream's sections, in order
+   static std::vector<const ui8*> buffers(const TStream& t)
+   {
+      std::vector<const ui8*> v;
+      for (const auto& s : t.section_list)
+         v.push_back(s->getBinaryData());
+      return v;
+   }
+
+   // the stream's data, as written to a file
+   static std::string contents(const TStream& t)
+   {
+      std::string d;
+      for (const auto& s : t.section_list)
+         d.append(reinterpret_cast<const char*>(s->getBinaryData()), s->length());
+      return d;
+   }
+
+   static std::string read_file(const std::string& name)
+   {
+      std::ifstream f(name, std::ios::binary);
+      return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+   }
+
+   //
+   // writes the stream to a file through each of the output paths
+   static int check_write(const TStream& t)
+   {
+      char name[] = "/tmp/sigen_streamXXXXXX";
+      int fd = mkstemp(name);
+      if (fd < 0)
+         return 77;
+
+      int rc = 0;
+      const std::string expected = contents(t);
+
+      if (!t.write(fd) || read_file(name) != expected)
+         rc = 1;
+      close(fd);
+
+      FILE* f = fopen(name, "wb");
+      if (!rc && (!f || !t.write(f) || fclose(f) || read_file(name) != expected))
+         rc = 1;
+
+      if (!rc && (!t.write(std::string(name)) || read_file(name) != expected))
+         rc = 1;
+
+      unlink(name);
+      return rc;
+   }
+
+   int stream(TStream&)
+   {
+      // combined streams hold the same section buffers, in order
+      TStream a = build_sdt(1), b = build_sdt(2);
+      std::vector<const ui8*> expected = buffers(a), bb = buffers(b);
+      expected.insert(expected.end(), bb.begin(), bb.end());
+
+      TStream all;
+      all.append(std::move(a));
+      all.append(std::move(b));
+      if (a.getNumSections() != 0 || b.getNumSections() != 0 ||
+          buffers(all) != expected)
+         return 1;
+
+      // streams with a different resource only move the handles
+      std::pmr::monotonic_buffer_resource arena;
+      TStream c = build_sdt(3);
+      TStream in_arena(&arena);
+      std::vector<const ui8*> cb = buffers(c);
+      in_arena.splice(in_arena.section_list.begin(), std::move(c));
+      in_arena.splice(in_arena.section_list.begin(), std::move(all));
+
+      expected.insert(expected.end(), cb.begin(), cb.end());
+      if (c.getNumSections() != 0 || buffers(in_arena) != expected)
+         return 1;
+
+      // sections can be taken out and handed to a consumer
+      TStream::SectionList sections = in_arena.take();
+      if (in_arena.getNumSections() != 0 || sections.size() != expected.size() ||
+          sections.front()->getBinaryData() != expected.front())
+         return 1;
+
+      // and moved between sections by value
+      Section s( std::move(*sections.front()) );
+      if (s.getBinaryData() != expected.front() ||
+          sections.front()->getBinaryData() != nullptr ||
+          sections.front()->length() != 0)
+         return 1;
+
+      // a section from a stream on another resource is shrunk by the
+      // stream it was moved to, which gives its buffer back
+      HeldBytesResource from_r, to_r;
+      {
+         TStream from(&from_r), to(&to_r);
+         Section* sec = from.getNewSection(1024);
+         sec->set08Bits(0x42);
+         to.append(std::move(from));
+         to.shrinkToFit(*sec);
+      }
+      if (from_r.bytes != 0 || to_r.bytes != 0)
+         return 1;
+
+      return check_write( build_sdt(4) );
+   }
+}
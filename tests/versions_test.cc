@@ -0,0 +1,107 @@
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include "../src/sigen.h"
+#include "dvb_builder.h"
+
+using namespace sigen;
+
+namespace tests
+{
+   static void add_services(SDT& sdt, ui16 count)
+   {
+      for (ui16 i = 0; i < count; i++) {
+         sdt.addService(i, true, true, 4, false);
+         sdt.addServiceDesc( *new ServiceDesc(0x01, "provider", "service") );
+      }
+   }
+
+   int versions(TStream&)
+   {
+      char name[] = "/tmp/sigen_versionsXXXXXX";
+      int fd = mkstemp(name);
+      if (fd < 0)
+         return 1;
+      close(fd);
+      unlink(name);
+
+      int rc = 0;
+      {
+         VersionManager vm(name);
+
+         // unchanged rebuilds keep the version
+         SDTActual sdt(0x20, 0x30, 7);
+         add_services(sdt, 10);
+
+         TStream t;
+         if (!vm.build(sdt, t) || vm.build(sdt, t) || vm.build(sdt, t) ||
+             vm.getVersion(0x42, 0x20, 0x30) != 7 || t.getNumSections() != 3)
+            rc = 1;
+
+         // a change increments it once
+         sdt.addService(100, true, true, 4, false);
+         if (!rc && (!vm.build(sdt, t) || vm.build(sdt, t) || sdt.getVersionNumber() != 8 ||
+                     vm.getVersion(0x42, 0x20, 0x30) != 8))
+            rc = 2;
+
+         // the sections carry the version, patched in as if built with it
+         if (!rc && (t.section_list.back()->getBinaryData()[5] >> 1 & 0x1f) != 8)
+            rc = 2;
+
+         TStream patched, built;
+         SDTActual stale(0x20, 0x30, 0);
+         add_services(stale, 10);
+         stale.addService(100, true, true, 4, false);
+         vm.build(stale, patched);
+         sdt.buildSections(built);
+         BufferSink a, b;
+         a.write(patched);
+         b.write(built);
+         if (!rc && (stale.getVersionNumber() != 8 || a.buffer != b.buffer ||
+                     patched.getHash() != built.getHash()))
+            rc = 2;
+
+         // other tables are kept apart: the SDT Other of the same TS,
+         // and the same table in another network
+         SDTOther other(0x20, 0x30, 3);
+         SDTActual net2(0x20, 0x31, 5);
+         add_services(other, 10);
+         add_services(net2, 10);
+         if (!rc && (!vm.build(other, t) || !vm.build(net2, t) || vm.size() != 3 ||
+                     vm.getVersion(0x46, 0x20, 0x30) != 3 ||
+                     vm.getVersion(0x42, 0x20, 0x31) != 5 ||
+                     vm.getVersion(0x42, 0x20, 0x30) != 8))
+            rc = 3;
+
+         // the version wraps at 32
+         PAT pat(0x20, 30);
+         for (ui16 i = 0; !rc && i < 3; i++) {
+            pat.addProgram(i + 1, 0x100 + i);
+            vm.build(pat, t);
+         }
+         if (!rc && vm.getVersion(0x00, 0x20) != 0)
+            rc = 4;
+
+         // nothing is written until saved
+         if (!rc && (access(name, F_OK) == 0 || !vm.save() || access(name, F_OK) != 0))
+            rc = 4;
+      }
+
+      // the versions survive a restart: a table constructed with any
+      // version is built with the saved one, if unchanged
+      if (!rc) {
+         VersionManager vm(name);
+
+         SDTActual sdt(0x20, 0x30, 0);
+         add_services(sdt, 10);
+         sdt.addService(100, true, true, 4, false);
+
+         TStream t;
+         if (vm.size() != 4 || vm.build(sdt, t) || sdt.getVersionNumber() != 8)
+            rc = 5;
+      }
+
+      unlink(name);
+      return rc;
+   }
+}